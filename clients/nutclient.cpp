@@ -27,6 +27,7 @@
 #include "nutclient.h"
 
 #include <sstream>
+#include <deque>
 
 /* TODO: Make it a run-time option like upsdebugx(),
  * probably with a verbosity level variable in each
@@ -237,12 +238,16 @@ public:
 	std::string read();
 	void write(const std::string& str);
 
+	/* Notifications read while waiting for another reply */
+	void pushNotification(const std::string& str);
+	bool popNotification(std::string& str);
 
 private:
 	SOCKET _sock;
 	bool _debugConnect;
 	struct timeval	_tv;
 	std::string _buffer; /* Received buffer, string because data should be text only. */
+	std::deque<std::string> _notifications;
 };
 
 Socket::Socket():
@@ -571,6 +576,23 @@ void Socket::disconnect()
 		_sock = INVALID_SOCKET;
 	}
 	_buffer.clear();
+	_notifications.clear();
+}
+
+void Socket::pushNotification(const std::string& str)
+{
+	_notifications.push_back(str);
+}
+
+bool Socket::popNotification(std::string& str)
+{
+	if(_notifications.empty())
+	{
+		return false;
+	}
+	str = _notifications.front();
+	_notifications.pop_front();
+	return true;
 }
 
 bool Socket::isConnected()const
@@ -963,6 +985,155 @@ std::map<std::string,std::vector<std::string> > TcpClient::getDeviceVariableValu
 	return map;
 }
 
+std::map<std::string,std::vector<std::string> > TcpClient::getDeviceVariableValues(const std::string& dev, const std::set<std::string>& names)
+{
+	std::map<std::string,std::vector<std::string> > map;
+
+	if (names.empty())
+	{
+		return map;
+	}
+
+	// "GET VARS <dev>" and the names must fit into the word limit of upsd
+	const size_t maxnames = 29;
+	std::vector<std::string> queries;
+	std::string query;
+	size_t count = 0;
+	for (std::set<std::string>::const_iterator it=names.cbegin(); it!=names.cend(); ++it)
+	{
+		if (count == 0)
+		{
+			query = "GET VARS " + dev;
+		}
+		query += " " + *it;
+		if (++count == maxnames)
+		{
+			queries.push_back(query);
+			count = 0;
+		}
+	}
+	if (count > 0)
+	{
+		queries.push_back(query);
+	}
+	sendAsyncQueries(queries);
+
+	// Read all responses, even after an error, to clear up the backlog.
+	std::string req = "VARS " + dev, err;
+	for (size_t n = 0; n < queries.size(); ++n)
+	{
+		std::string res = _socket->read();
+		if (res.substr(0, 3) == "ERR")
+		{
+			err = res.substr(4);
+			continue;
+		}
+		if (res != ("BEGIN GET " + req))
+		{
+			// The rest of the responses can not be told apart any
+			// more, so do not leave them for the next request.
+			disconnect();
+			throw NutException("Invalid response");
+		}
+
+		while (true)
+		{
+			res = _socket->read();
+			if (res == ("END GET " + req))
+			{
+				break;
+			}
+			if (res.substr(0, dev.size() + 5) != ("VAR " + dev + " "))
+			{
+				disconnect();
+				throw NutException("Invalid response");
+			}
+			std::vector<std::string> vals = explode(res, dev.size() + 4);
+			if (vals.size() < 2)
+			{
+				disconnect();
+				throw NutException("Invalid response");
+			}
+			std::string var = vals[0];
+			vals.erase(vals.begin());
+			map[var] = vals;
+		}
+	}
+
+	if (err == "INVALID-ARGUMENT" || err == "UNKNOWN-COMMAND")
+	{
+		// Server older than protocol version 1.4
+		for (std::set<std::string>::const_iterator it=names.cbegin(); it!=names.cend(); ++it)
+		{
+			try
+			{
+				map[*it] = getDeviceVariableValue(dev, *it);
+			}
+			catch (IOException&)
+			{
+				throw;
+			}
+			catch (NutException&)
+			{
+				// Not supported by this device
+			}
+		}
+	}
+	else if (!err.empty())
+	{
+		throw NutException(err);
+	}
+
+	return map;
+}
+
+void TcpClient::watchDevice(const std::string& dev, const std::set<std::string>& patterns)
+{
+	std::string query = "WATCH " + dev;
+	for (std::set<std::string>::const_iterator it=patterns.cbegin(); it!=patterns.cend(); ++it)
+	{
+		query += " " + *it;
+	}
+	detectError(sendWatchQuery(query));
+}
+
+void TcpClient::unwatchDevice(const std::string& dev)
+{
+	detectError(sendWatchQuery("UNWATCH " + dev));
+}
+
+std::vector<std::string> TcpClient::readNotification(time_t timeout)
+{
+	// Those which came before the last WATCH or UNWATCH reply first;
+	// queries wait without a timeout, so only this read gets one
+	std::string res;
+	if (!_socket->popNotification(res))
+	{
+		_socket->setTimeout(timeout);
+		try
+		{
+			res = _socket->read();
+		}
+		catch (...)
+		{
+			_socket->setTimeout(-1);
+			throw;
+		}
+		_socket->setTimeout(-1);
+	}
+	detectError(res);
+	if (res.substr(0, 7) != "NOTIFY ")
+	{
+		throw NutException("Invalid response");
+	}
+	std::vector<std::string> notif = explode(res, 7);
+	if (notif.size() < 3)
+	{
+		throw NutException("Invalid response");
+	}
+	return notif;
+}
+
 std::map<std::string,std::map<std::string,std::vector<std::string> > > TcpClient::getDevicesVariableValues(const std::set<std::string>& devs)
 {
 	std::map<std::string,std::map<std::string,std::vector<std::string> > > map;
@@ -1257,6 +1428,19 @@ std::string TcpClient::sendQuery(const std::string& req)
 	return _socket->read();
 }
 
+std::string TcpClient::sendWatchQuery(const std::string& req)
+{
+	// Notifications of other subscriptions may arrive before the reply,
+	// keep them for readNotification()
+	std::string res = sendQuery(req);
+	while (res.substr(0, 7) == "NOTIFY ")
+	{
+		_socket->pushNotification(res);
+		res = _socket->read();
+	}
+	return res;
+}
+
 void TcpClient::sendAsyncQueries(const std::vector<std::string>& req)
 {
 	for (std::vector<std::string>::const_iterator it = req.cbegin(); it != req.cend(); ++it)
@@ -457,6 +457,39 @@ public:
 	virtual std::vector<std::string> getDeviceVariableValue(const std::string& dev, const std::string& name) override;
 	virtual std::map<std::string,std::vector<std::string> > getDeviceVariableValues(const std::string& dev) override;
 	virtual std::map<std::string,std::map<std::string,std::vector<std::string> > > getDevicesVariableValues(const std::set<std::string>& devs) override;
+	/**
+	 * Retrieve values of some variables of a device in one round trip
+	 * (GET VARS, or one GET VAR per variable with servers older than
+	 * protocol version 1.4).
+	 * \param dev Device name
+	 * \param names Variable names
+	 * \return Variable values indexed by variable names; the variables
+	 * which the device does not have are left out.
+	 */
+	std::map<std::string,std::vector<std::string> > getDeviceVariableValues(const std::string& dev, const std::set<std::string>& names);
+	/**
+	 * Subscribe to the changes of variables of a device (WATCH, protocol
+	 * version 1.4). The server then pushes notifications on this
+	 * connection, starting with the current state, which are read with
+	 * readNotification(); the connection should be dedicated to this.
+	 * \param dev Device name
+	 * \param patterns Variable names, '*' is a wildcard; all if empty
+	 */
+	void watchDevice(const std::string& dev, const std::set<std::string>& patterns = std::set<std::string>());
+	/**
+	 * Cancel the subscription of watchDevice().
+	 * \param dev Device name
+	 */
+	void unwatchDevice(const std::string& dev);
+	/**
+	 * Read the next notification of a watched device.
+	 * \param timeout Seconds to wait for it (TimeoutException), or -1
+	 * to wait as long as it takes
+	 * \return {"VAR", dev, name, value}, {"DELVAR", dev, name}
+	 * or {"STATUS", dev, state} where state is "OK" or an error name
+	 * such as "DATA-STALE"
+	 */
+	std::vector<std::string> readNotification(time_t timeout = -1);
 	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::string& value) override;
 	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::vector<std::string>& values) override;
 
@@ -484,6 +517,7 @@ public:
 protected:
 	std::string sendQuery(const std::string& req);
 	void sendAsyncQueries(const std::vector<std::string>& req);
+	std::string sendWatchQuery(const std::string& req);
 	static void detectError(const std::string& req);
 	TrackingID sendTrackingQuery(const std::string& req);
 
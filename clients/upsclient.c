@@ -1002,6 +1002,67 @@ static int upscli_sslinit(UPSCONN_t *ups, int verifycert)
 
 #endif /* WITH_SSL */
 
+/* notifications which arrive while WATCH or UNWATCH wait for their
+ * reply, kept for upscli_watch_next(); they live here rather than in
+ * UPSCONN_t, whose layout is part of the library ABI */
+typedef struct watch_queued_s {
+	const UPSCONN_t	*ups;
+	char	line[UPSCLI_NETBUF_LEN];
+	struct watch_queued_s	*next;
+} watch_queued_t;
+
+static watch_queued_t	*watch_queue = NULL;
+
+static void watch_queue_add(const UPSCONN_t *ups, const char *line)
+{
+	watch_queued_t	*tmp, **last;
+
+	tmp = xcalloc(1, sizeof(*tmp));
+	tmp->ups = ups;
+	snprintf(tmp->line, sizeof(tmp->line), "%s", line);
+
+	for (last = &watch_queue; *last; last = &(*last)->next)
+		;
+
+	*last = tmp;
+}
+
+/* take the oldest queued line of ups into buf; returns 1 if there was one */
+static int watch_queue_get(const UPSCONN_t *ups, char *buf, size_t buflen)
+{
+	watch_queued_t	*tmp, **prev;
+
+	for (prev = &watch_queue; (tmp = *prev) != NULL; prev = &tmp->next) {
+		if (tmp->ups != ups) {
+			continue;
+		}
+
+		snprintf(buf, buflen, "%s", tmp->line);
+		*prev = tmp->next;
+		free(tmp);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void watch_queue_drop(const UPSCONN_t *ups)
+{
+	watch_queued_t	*tmp, **prev;
+
+	prev = &watch_queue;
+
+	while ((tmp = *prev) != NULL) {
+		if (tmp->ups != ups) {
+			prev = &tmp->next;
+			continue;
+		}
+
+		*prev = tmp->next;
+		free(tmp);
+	}
+}
+
 int upscli_tryconnect(UPSCONN_t *ups, const char *host, uint16_t port, int flags, struct timeval * timeout)
 {
 	int				sock_fd;
@@ -1027,6 +1088,7 @@ int upscli_tryconnect(UPSCONN_t *ups, const char *host, uint16_t port, int flags
 	}
 
 	/* clear out any lingering junk */
+	watch_queue_drop(ups);
 	memset(ups, 0, sizeof(*ups));
 	ups->upsclient_magic = UPSCLIENT_MAGIC;
 	ups->fd = -1;
@@ -1409,11 +1471,26 @@ int upscli_get(UPSCONN_t *ups, size_t numq, const char **query,
 		return -1;
 	}
 
-	if (upscli_errcheck(ups, tmp) != 0) {
+	return upscli_get_reply(ups, tmp, numq, query, numa, answer);
+}
+
+int upscli_get_reply(UPSCONN_t *ups, char *line, size_t numq,
+		const char **query, size_t *numa, char ***answer)
+{
+	if (!ups) {
 		return -1;
 	}
 
-	if (!pconf_line(&ups->pc_ctx, tmp)) {
+	if ((!line) || (numq < 1) || (!numa) || (!answer)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	if (upscli_errcheck(ups, line) != 0) {
+		return -1;
+	}
+
+	if (!pconf_line(&ups->pc_ctx, line)) {
 		ups->upserror = UPSCLI_ERR_PARSE;
 		return -1;
 	}
@@ -1437,6 +1514,266 @@ int upscli_get(UPSCONN_t *ups, size_t numq, const char **query,
 	return 0;
 }
 
+/* "GET VARS <ups>" and the names must fit into the word limit of upsd */
+#define GET_MULTI_MAXVARS	(PCONF_DEFAULT_ARG_LIMIT - 3)
+
+/* errors after which the connection can not be used anymore */
+static int upscli_neterror(int upserror)
+{
+	switch (upserror) {
+		case UPSCLI_ERR_WRITE:
+		case UPSCLI_ERR_READ:
+		case UPSCLI_ERR_SRVDISC:
+		case UPSCLI_ERR_SSLERR:
+		case UPSCLI_ERR_SENDFAILURE:
+		case UPSCLI_ERR_RECVFAILURE:
+		case UPSCLI_ERR_NOMEM:
+		case UPSCLI_ERR_PARSE:
+		case UPSCLI_ERR_PROTOCOL:
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+static void get_multi_clear(size_t numvars, char **values)
+{
+	size_t	i;
+
+	for (i = 0; i < numvars; i++) {
+		free(values[i]);
+		values[i] = NULL;
+	}
+}
+
+/* for servers which do not know GET VARS: one GET VAR at a time */
+static int get_multi_single(UPSCONN_t *ups, size_t numvars,
+	const char **upsnames, const char **varnames, char **values)
+{
+	const char	*query[3];
+	char	**answer;
+	size_t	i, numa;
+	int	found = 0;
+
+	for (i = 0; i < numvars; i++) {
+		query[0] = "VAR";
+		query[1] = upsnames[i];
+		query[2] = varnames[i];
+
+		if (upscli_get(ups, 3, query, &numa, &answer) < 0) {
+			if (upscli_neterror(ups->upserror)) {
+				return -1;
+			}
+			continue;
+		}
+
+		if (numa < 4) {
+			ups->upserror = UPSCLI_ERR_PROTOCOL;
+			return -1;
+		}
+
+		values[i] = xstrdup(answer[3]);
+		found++;
+	}
+
+	return found;
+}
+
+/* read the response to one GET VARS line asking for names [first, last);
+ * if upsd refused the whole line, *refused is set to the error, and if
+ * some answer did not fit in our buffer, *truncated is raised (the rest
+ * of the response is still read, to keep in sync with the server) */
+static int get_multi_block(UPSCONN_t *ups, size_t first, size_t last,
+	const char **upsnames, const char **varnames, char **values, int *refused,
+	int *truncated)
+{
+	char	tmp[UPSCLI_NETBUF_LEN];
+	size_t	i;
+	int	found = 0;
+
+	if (upscli_readline(ups, tmp, sizeof(tmp)) != 0) {
+		return -1;
+	}
+
+	/* not in upsd_errlist, but what older servers reply to GET VARS */
+	if (!strncmp(tmp, "ERR INVALID-ARGUMENT", 20)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		*refused = ups->upserror;
+		return 0;
+	}
+
+	if (upscli_errcheck(ups, tmp) != 0) {
+		*refused = ups->upserror;
+		return 0;
+	}
+
+	if ((!pconf_line(&ups->pc_ctx, tmp))
+	 || (ups->pc_ctx.numargs < 4)
+	 || (strcmp(ups->pc_ctx.arglist[0], "BEGIN") != 0)
+	 || (strcmp(ups->pc_ctx.arglist[2], "VARS") != 0)
+	 || (strcasecmp(ups->pc_ctx.arglist[3], upsnames[first]) != 0)) {
+		ups->upserror = UPSCLI_ERR_PROTOCOL;
+		return -1;
+	}
+
+	for (;;) {
+		if (upscli_readline(ups, tmp, sizeof(tmp)) != 0) {
+			return -1;
+		}
+
+		/* no newline seen: drop the rest of this line, or it would be
+		 * taken for the next answer */
+		if (strlen(tmp) == sizeof(tmp) - 1) {
+			*truncated = 1;
+			do {
+				if (upscli_readline(ups, tmp, sizeof(tmp)) != 0) {
+					return -1;
+				}
+			} while (strlen(tmp) == sizeof(tmp) - 1);
+			continue;
+		}
+
+		if (!pconf_line(&ups->pc_ctx, tmp)) {
+			ups->upserror = UPSCLI_ERR_PARSE;
+			return -1;
+		}
+
+		if ((ups->pc_ctx.numargs >= 2)
+		 && (!strcmp(ups->pc_ctx.arglist[0], "END"))) {
+			return found;
+		}
+
+		/* a: VAR <ups> <var> <val> */
+		if ((ups->pc_ctx.numargs < 4)
+		 || (strcmp(ups->pc_ctx.arglist[0], "VAR") != 0)
+		 || (strcasecmp(ups->pc_ctx.arglist[1], upsnames[first]) != 0)) {
+			ups->upserror = UPSCLI_ERR_PROTOCOL;
+			return -1;
+		}
+
+		for (i = first; i < last; i++) {
+			if ((!values[i])
+			 && (!strcasecmp(ups->pc_ctx.arglist[2], varnames[i]))) {
+				values[i] = xstrdup(ups->pc_ctx.arglist[3]);
+				found++;
+				break;
+			}
+		}
+	}
+}
+
+int upscli_get_multi(UPSCONN_t *ups, size_t numvars, const char **upsnames,
+		const char **varnames, char **values)
+{
+	char	*cmd, line[UPSCLI_NETBUF_LEN];
+	size_t	*ends, numlines = 0, cmdlen = 0, i, first;
+	int	ret, found = 0, olderr = 0, failed = 0, refused, truncated = 0;
+
+	if (!ups) {
+		return -1;
+	}
+
+	if ((numvars < 1) || (!upsnames) || (!varnames) || (!values)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	for (i = 0; i < numvars; i++) {
+		values[i] = NULL;
+	}
+
+	/* group runs of names for the same UPS into GET VARS lines, and
+	 * send all of them at once so that the whole set costs one round
+	 * trip; the line for each group ends before ends[n] */
+	cmd = xcalloc(numvars, UPSCLI_NETBUF_LEN);
+	ends = xcalloc(numvars, sizeof(*ends));
+
+	for (first = 0; first < numvars; first = ends[numlines++]) {
+		const char	*query[PCONF_DEFAULT_ARG_LIMIT];
+		size_t	numq = 0;
+
+		query[numq++] = "VARS";
+		query[numq++] = upsnames[first];
+
+		for (i = first; (i < numvars) && (numq < GET_MULTI_MAXVARS + 2); i++) {
+			if (strcasecmp(upsnames[i], upsnames[first]) != 0) {
+				break;
+			}
+
+			query[numq++] = varnames[i];
+			build_cmd(line, sizeof(line), "GET", numq, query);
+
+			/* keep the line intact, the last name goes to the next one */
+			if ((numq > 3) && (line[strlen(line) - 1] != '\n')) {
+				numq--;
+				break;
+			}
+		}
+
+		ends[numlines] = first + numq - 2;
+		build_cmd(line, sizeof(line), "GET", numq, query);
+
+		memcpy(cmd + cmdlen, line, strlen(line));
+		cmdlen += strlen(line);
+	}
+
+	ret = (int)upscli_sendline(ups, cmd, cmdlen);
+	free(cmd);
+
+	if (ret != 0) {
+		free(ends);
+		return -1;
+	}
+
+	/* read all responses, even after an error, to keep in sync */
+	for (i = 0, first = 0; i < numlines; first = ends[i++]) {
+		refused = 0;
+		ret = get_multi_block(ups, first, ends[i], upsnames, varnames, values,
+			&refused, &truncated);
+
+		if (ret < 0) {
+			free(ends);
+			get_multi_clear(numvars, values);
+			return -1;
+		}
+
+		/* servers before protocol 1.4 do not know GET VARS; otherwise
+		 * this is about one UPS (unknown, stale data...) */
+		if ((refused == UPSCLI_ERR_INVALIDARG)
+		 || (refused == UPSCLI_ERR_UNKCOMMAND)) {
+			olderr = 1;
+		} else if (refused) {
+			failed = refused;
+		}
+
+		found += ret;
+	}
+
+	free(ends);
+
+	if (truncated) {
+		get_multi_clear(numvars, values);
+		ups->upserror = UPSCLI_ERR_PROTOCOL;
+		return -1;
+	}
+
+	if (olderr) {
+		get_multi_clear(numvars, values);
+		found = get_multi_single(ups, numvars, upsnames, varnames, values);
+		if (found < 0) {
+			get_multi_clear(numvars, values);
+		}
+		return found;
+	}
+
+	if (failed) {
+		ups->upserror = failed;
+	}
+
+	return found;
+}
+
 int upscli_list_start(UPSCONN_t *ups, size_t numq, const char **query)
 {
 	char	cmd[UPSCLI_NETBUF_LEN], tmp[UPSCLI_NETBUF_LEN];
@@ -1544,6 +1881,186 @@ int upscli_list_next(UPSCONN_t *ups, size_t numq, const char **query,
 	return 1;
 }
 
+/* send WATCH or UNWATCH, wait for its OK; notifications which arrive
+ * in the meantime (for other subscriptions) are queued */
+static int watch_cmd(UPSCONN_t *ups, const char *cmdname, size_t numarg, const char **arg)
+{
+	char	cmd[UPSCLI_NETBUF_LEN], tmp[UPSCLI_NETBUF_LEN];
+
+	build_cmd(cmd, sizeof(cmd), cmdname, numarg, arg);
+
+	if (upscli_sendline(ups, cmd, strlen(cmd)) != 0) {
+		return -1;
+	}
+
+	for (;;) {
+		if (upscli_readline(ups, tmp, sizeof(tmp)) != 0) {
+			return -1;
+		}
+
+		if (strncmp(tmp, "NOTIFY ", 7) != 0) {
+			break;
+		}
+
+		watch_queue_add(ups, tmp);
+	}
+
+	if (upscli_errcheck(ups, tmp) != 0) {
+		return -1;
+	}
+
+	if (strncmp(tmp, "OK", 2) != 0) {
+		ups->upserror = UPSCLI_ERR_PROTOCOL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int upscli_watch(UPSCONN_t *ups, const char *upsname, size_t numpat,
+		const char **patterns)
+{
+	const char	**arg;
+	size_t	i;
+	int	ret;
+
+	if (!ups) {
+		return -1;
+	}
+
+	if ((!upsname) || (numpat > 0 && !patterns)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	arg = xcalloc(numpat + 1, sizeof(*arg));
+	arg[0] = upsname;
+	for (i = 0; i < numpat; i++) {
+		arg[i + 1] = patterns[i];
+	}
+
+	ret = watch_cmd(ups, "WATCH", numpat + 1, arg);
+
+	free(arg);
+	return ret;
+}
+
+int upscli_unwatch(UPSCONN_t *ups, const char *upsname)
+{
+	if (!ups) {
+		return -1;
+	}
+
+	if (!upsname) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	return watch_cmd(ups, "UNWATCH", 1, &upsname);
+}
+
+/* wait for data without taking a quiet server for a disconnected one,
+ * as upscli_readline_timeout() does; returns 1 if there is something
+ * to read, 0 on timeout, -1 on error */
+static int watch_wait(UPSCONN_t *ups, const time_t timeout)
+{
+	fd_set	fds;
+	struct timeval	tv;
+	int	ret;
+
+	if (ups->readidx < ups->readlen) {
+		return 1;
+	}
+
+#ifdef WITH_OPENSSL
+	if (ups->ssl && SSL_pending(ups->ssl) > 0) {
+		return 1;
+	}
+#elif defined(WITH_NSS) /* WITH_OPENSSL */
+	if (ups->ssl && SSL_DataPending(ups->ssl) > 0) {
+		return 1;
+	}
+#endif	/* WITH_OPENSSL | WITH_NSS */
+
+	FD_ZERO(&fds);
+	FD_SET(ups->fd, &fds);
+
+	tv.tv_sec = timeout;
+	tv.tv_usec = 0;
+
+	ret = select(ups->fd + 1, &fds, NULL, NULL, &tv);
+
+	if (ret < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+
+		ups->upserror = UPSCLI_ERR_READ;
+		ups->syserrno = errno;
+		return -1;
+	}
+
+	return (ret > 0);
+}
+
+int upscli_watch_next(UPSCONN_t *ups, const time_t timeout,
+		size_t *numa, char ***answer)
+{
+	char	tmp[UPSCLI_NETBUF_LEN];
+	int	ret;
+
+	if (!ups) {
+		return -1;
+	}
+
+	if ((!numa) || (!answer)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	if (ups->fd < 0) {
+		ups->upserror = UPSCLI_ERR_DRVNOTCONN;
+		return -1;
+	}
+
+	/* those which came before the last WATCH or UNWATCH reply first */
+	if (!watch_queue_get(ups, tmp, sizeof(tmp))) {
+		ret = watch_wait(ups, timeout);
+		if (ret < 1) {
+			return ret;
+		}
+
+		if (upscli_readline(ups, tmp, sizeof(tmp)) != 0) {
+			return -1;
+		}
+	}
+
+	if (upscli_errcheck(ups, tmp) != 0) {
+		return -1;
+	}
+
+	if (!pconf_line(&ups->pc_ctx, tmp)) {
+		ups->upserror = UPSCLI_ERR_PARSE;
+		return -1;
+	}
+
+	/* a: NOTIFY VAR <ups> <var> <val>  *
+	 *    NOTIFY DELVAR <ups> <var>     *
+	 *    NOTIFY STATUS <ups> <state>   */
+
+	if ((ups->pc_ctx.numargs < 4)
+	 || (strcmp(ups->pc_ctx.arglist[0], "NOTIFY") != 0)
+	) {
+		ups->upserror = UPSCLI_ERR_PROTOCOL;
+		return -1;
+	}
+
+	*numa = ups->pc_ctx.numargs - 1;
+	*answer = &ups->pc_ctx.arglist[1];
+
+	return 1;
+}
+
 ssize_t upscli_sendline_timeout(UPSCONN_t *ups, const char *buf, size_t buflen, const time_t timeout)
 {
 	ssize_t	ret;
@@ -1640,6 +2157,72 @@ ssize_t upscli_readline(UPSCONN_t *ups, char *buf, size_t buflen)
 	return upscli_readline_timeout(ups, buf, buflen, DEFAULT_NETWORK_TIMEOUT);
 }
 
+int upscli_tryreadline(UPSCONN_t *ups, char *buf, size_t buflen, size_t *len)
+{
+	ssize_t	ret;
+	int	ready;
+	char	ch;
+
+	if (!ups) {
+		return -1;
+	}
+
+	if (ups->fd < 0) {
+		ups->upserror = UPSCLI_ERR_DRVNOTCONN;
+		return -1;
+	}
+
+	if ((!buf) || (buflen < 1) || (!len) || (*len >= buflen)) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	if (ups->upsclient_magic != UPSCLIENT_MAGIC) {
+		ups->upserror = UPSCLI_ERR_INVALIDARG;
+		return -1;
+	}
+
+	while (*len < (buflen-1)) {
+
+		if (ups->readidx == ups->readlen) {
+
+			/* only read what is already there */
+			ready = watch_wait(ups, 0);
+
+			if (ready < 0) {
+				upscli_disconnect(ups);
+				return -1;
+			}
+
+			if (ready == 0) {
+				return 0;
+			}
+
+			ret = net_read(ups, ups->readbuf, sizeof(ups->readbuf), 0);
+
+			if (ret < 1) {
+				upscli_disconnect(ups);
+				return -1;
+			}
+
+			ups->readlen = (size_t)ret;
+			ups->readidx = 0;
+		}
+
+		ch = ups->readbuf[ups->readidx++];
+
+		if (ch == '\n') {
+			break;
+		}
+
+		buf[(*len)++] = ch;
+	}
+
+	/* a complete line, or as much of it as fits like upscli_readline() */
+	buf[*len] = '\0';
+	return 1;
+}
+
 /* split upsname[@hostname[:port]] into separate components */
 int upscli_splitname(const char *buf, char **upsname, char **hostname, uint16_t *port)
 {
@@ -1791,6 +2374,8 @@ int upscli_disconnect(UPSCONN_t *ups)
 
 	pconf_finish(&ups->pc_ctx);
 
+	watch_queue_drop(ups);
+
 	free(ups->host);
 	ups->host = NULL;
 
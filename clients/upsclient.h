@@ -114,17 +114,49 @@ void upscli_add_host_cert(const char* hostname, const char* certname, int certve
 int upscli_get(UPSCONN_t *ups, size_t numq, const char **query,
 		size_t *numa, char ***answer);
 
+/* check and split a reply to a "GET <query>" line which the caller sent
+ * and read itself (e.g. several pipelined ones), like upscli_get() does */
+int upscli_get_reply(UPSCONN_t *ups, char *line, size_t numq,
+		const char **query, size_t *numa, char ***answer);
+
+/* fetch the values of several variables (of one or several UPSes) in one
+ * round trip: values[i] gets an allocated copy of the value of varnames[i]
+ * of upsnames[i], or NULL if it is not available. Returns the number of
+ * values found, or -1 if the connection failed. */
+int upscli_get_multi(UPSCONN_t *ups, size_t numvars, const char **upsnames,
+		const char **varnames, char **values);
+
 int upscli_list_start(UPSCONN_t *ups, size_t numq, const char **query);
 
 int upscli_list_next(UPSCONN_t *ups, size_t numq, const char **query,
 		size_t *numa, char ***answer);
 
+/* Subscribe to the changes of the variables of upsname which match any
+ * of the patterns ('*' is a wildcard; all variables if numpat is 0),
+ * and unsubscribe again. The connection should be dedicated to this:
+ * upsd pushes notifications on it at any time after WATCH. */
+int upscli_watch(UPSCONN_t *ups, const char *upsname, size_t numpat,
+		const char **patterns);
+int upscli_unwatch(UPSCONN_t *ups, const char *upsname);
+
+/* Wait up to timeout seconds for the next notification. Returns 1 with
+ * answer[0..numa-1] holding it ("VAR <ups> <var> <value>", "DELVAR <ups>
+ * <var>" or "STATUS <ups> <state>"), 0 on timeout and -1 on error. */
+int upscli_watch_next(UPSCONN_t *ups, const time_t timeout,
+		size_t *numa, char ***answer);
+
 ssize_t upscli_sendline_timeout(UPSCONN_t *ups, const char *buf, size_t buflen, const time_t timeout);
 ssize_t upscli_sendline(UPSCONN_t *ups, const char *buf, size_t buflen);
 
 ssize_t upscli_readline_timeout(UPSCONN_t *ups, char *buf, size_t buflen, const time_t timeout);
 ssize_t upscli_readline(UPSCONN_t *ups, char *buf, size_t buflen);
 
+/* Non-blocking upscli_readline(): append whatever has arrived to buf,
+ * which already holds *len bytes of the line. Returns 1 when the line
+ * is complete (reset *len before reading the next one), 0 if more data
+ * is needed, and -1 on error. */
+int upscli_tryreadline(UPSCONN_t *ups, char *buf, size_t buflen, size_t *len);
+
 int upscli_splitname(const char *buf, char **upsname, char **hostname,
 			uint16_t *port);
 
@@ -61,6 +61,12 @@
 
 	static	flist_t	*fhead = NULL;
 
+	/* values of all %VAR ...% of the format, fetched in one round trip
+	 * before each line is printed (see prefetch_vars) */
+	static	size_t	prefetch_count = 0;
+	static	const	char	**prefetch_names = NULL;
+	static	char	**prefetch_values = NULL;
+
 	/* FIXME: To be valgrind-clean, free these at exit */
 	static	struct	logtarget_t *logfile_anchor = NULL;
 	static	struct	monhost_ups_t *monhost_ups_anchor = NULL;
@@ -299,10 +305,18 @@ static void do_time(const char *arg, const struct monhost_ups_t *monhost_ups_pri
 static void getvar(const char *var, const struct monhost_ups_t *monhost_ups_print)
 {
 	int	ret;
-	size_t	numq, numa;
+	size_t	numq, numa, i;
 	const	char	*query[4];
 	char	**answer;
 
+	for (i = 0; i < prefetch_count; i++) {
+		if (!strcmp(prefetch_names[i], var)) {
+			snprintfcat(logbuffer, sizeof(logbuffer), "%s",
+				prefetch_values[i] ? prefetch_values[i] : "NA");
+			return;
+		}
+	}
+
 	query[0] = "VAR";
 	query[1] = monhost_ups_print->upsname;
 	query[2] = var;
@@ -474,6 +488,71 @@ static void compile_format(void)
 }
 
 /* go through the list of functions and call them in order */
+static void prefetch_free(void)
+{
+	size_t	i;
+
+	for (i = 0; i < prefetch_count; i++) {
+		free(prefetch_values[i]);
+	}
+
+	free(prefetch_names);
+	free(prefetch_values);
+
+	prefetch_names = NULL;
+	prefetch_values = NULL;
+	prefetch_count = 0;
+}
+
+/* ask for all variables of the line at once instead of one GET VAR each;
+ * if that fails, getvar() queries them one by one as before */
+static void prefetch_vars(const struct monhost_ups_t *monhost_ups_print)
+{
+	flist_t	*tmp;
+	const	char	**upsnames;
+	size_t	count = 0, i;
+
+	if (!monhost_ups_print->upsname) {
+		return;
+	}
+
+	for (tmp = fhead; tmp; tmp = tmp->next) {
+		if ((tmp->fptr == do_var) && (tmp->arg) && (strchr(tmp->arg, '.'))) {
+			count++;
+		}
+	}
+
+	if (count < 2) {
+		return;
+	}
+
+	prefetch_names = xcalloc(count, sizeof(*prefetch_names));
+	prefetch_values = xcalloc(count, sizeof(*prefetch_values));
+	upsnames = xcalloc(count, sizeof(*upsnames));
+
+	for (tmp = fhead, i = 0; tmp; tmp = tmp->next) {
+		if ((tmp->fptr == do_var) && (tmp->arg) && (strchr(tmp->arg, '.'))) {
+			upsnames[i] = monhost_ups_print->upsname;
+			prefetch_names[i++] = tmp->arg;
+		}
+	}
+
+	if (upscli_get_multi(monhost_ups_print->ups, count, upsnames,
+		prefetch_names, prefetch_values) < 0
+	) {
+		upsdebugx(1, "%s: %s", __func__, upscli_strerror(monhost_ups_print->ups));
+		/* the values are all NULL then */
+		free(prefetch_names);
+		free(prefetch_values);
+		prefetch_names = NULL;
+		prefetch_values = NULL;
+		count = 0;
+	}
+
+	prefetch_count = count;
+	free(upsnames);
+}
+
 static void run_flist(const struct monhost_ups_t *monhost_ups_print)
 {
 	flist_t	*tmp;
@@ -482,12 +561,16 @@ static void run_flist(const struct monhost_ups_t *monhost_ups_print)
 
 	memset(logbuffer, 0, sizeof(logbuffer));
 
+	prefetch_vars(monhost_ups_print);
+
 	while (tmp) {
 		tmp->fptr(tmp->arg, monhost_ups_print);
 
 		tmp = tmp->next;
 	}
 
+	prefetch_free();
+
 	fprintf(monhost_ups_print->logtarget->logfile, "%s\n", logbuffer);
 	fflush(monhost_ups_print->logtarget->logfile);
 }
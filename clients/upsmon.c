@@ -1123,27 +1123,6 @@ static int get_var(utype_t *ups, const char *var, char *buf, size_t bufsize)
 		numq = 2;
 	}
 	else
-	if (!strcmp(var, "status")) {
-		query[0] = "VAR";
-		query[1] = ups->upsname;
-		query[2] = "ups.status";
-		numq = 3;
-	}
-	else
-	if (!strcmp(var, "buzzword")) {
-		query[0] = "VAR";
-		query[1] = ups->upsname;
-		query[2] = "ups.mode.buzzwords";
-		numq = 3;
-	}
-	else
-	if (!strcmp(var, "X-buzzword")) {
-		query[0] = "VAR";
-		query[1] = ups->upsname;
-		query[2] = "experimental.ups.mode.buzzwords";
-		numq = 3;
-	}
-	else
 	if (!strcmp(var, "alarm")) {
 		/* Opaque string */
 		query[0] = "VAR";
@@ -2725,6 +2704,26 @@ static int try_connect(utype_t *ups)
 	return 0;
 }
 
+/* find the alphanumerically first status token not refreshed since cutoff */
+static st_tree_t *find_stale_status_token(st_tree_t *node, const st_tree_timespec_t *cutoff)
+{
+	st_tree_t	*found;
+
+	if (!node) {
+		return NULL;
+	}
+
+	if ((found = find_stale_status_token(node->left, cutoff)) != NULL) {
+		return found;
+	}
+
+	if (st_tree_node_compare_timestamp(node, cutoff) < 0) {
+		return node;
+	}
+
+	return find_stale_status_token(node->right, cutoff);
+}
+
 /* deal with the contents of STATUS or ups.status for this ups */
 static void parse_status(utype_t *ups, char *status, char *buzzword, char *buzzwordX)
 {
@@ -2925,43 +2924,16 @@ static void parse_status(utype_t *ups, char *status, char *buzzword, char *buzzw
 	}
 
 	if (ups->status_tokens) {
-		st_tree_t	*node = ups->status_tokens, *sttmp = node;
-
-		/* Scroll to the leftmost entry for alphanumeric sorted processing */
-		while (sttmp) {
-			node = sttmp;
-			sttmp = sttmp->left;
-		}
-
-		/* Go from left to right, on a freeing spree if need be */
-		while (node) {
-			sttmp = node->right;
-			if (st_tree_node_compare_timestamp(node, &st_start) < 0) {
-				upsdebugx(5, "Unexpected status token: [%s]: disappeared",
-					NUT_STRARG(node->var));
-				changed_other_stat_words++;
-
-				/* whatever is on the left, hang it off current right */
-				if (node->right) {
-					node->right->left = node->left;	/* May be NULL*/
-				}
-				/* whatever is on the right, hang it off current left */
-				if (node->left) {
-					node->left->right = node->right;	/* May be NULL*/
-				}
-
-				if (node == ups->status_tokens) {
-					ups->status_tokens = node->left ? node->left : node->right;
-				}
+		st_tree_t	*node;
 
-				/* forget the neighbors before dropping the remaining
-				 * "tree" of one node */
-				node->right = NULL;
-				node->left = NULL;
+		/* Evict tokens not seen this time, in alphanumeric order;
+		 * the tree rebalances on removal, so look up afresh each time */
+		while ((node = find_stale_status_token(ups->status_tokens, &st_start)) != NULL) {
+			upsdebugx(5, "Unexpected status token: [%s]: disappeared",
+				NUT_STRARG(node->var));
+			changed_other_stat_words++;
 
-				state_infofree(node);
-			}
-			node = sttmp;
+			state_delinfo(&ups->status_tokens, node->var);
 		}
 	}
 
@@ -2982,36 +2954,36 @@ static void parse_status(utype_t *ups, char *status, char *buzzword, char *buzzw
 	upsdebugx(3, "Handled %d status tokens", handled_stat_words);
 }
 
-/* see what the status of the UPS is and handle any changes */
-static void pollups(utype_t *ups)
-{
-	char	status[SMALLBUF], buzzmode[SMALLBUF], buzzmodeX[SMALLBUF];
-	int	pollfail_log = 0;	/* if we throttle, only upsdebugx() but not upslogx() the failures */
-	int	upserror, got_status, got_buzzmode, got_buzzmodeX;
-
-	/* try a reconnect here */
-	if (!flag_isset(ups->status, ST_CLICONNECTED)) {
-		if (try_connect(ups) != 1) {
-			return;
-		}
-	}
-
-	if (upscli_ssl(&ups->conn) == 1)
-		upsdebugx(2, "%s: %s [SSL]", __func__, ups->sys);
-	else
-		upsdebugx(2, "%s: %s", __func__, ups->sys);
+/* the variables asked for in each poll (status and buzzwords for
+ * parse_status()); the replies come back in this order */
+static const char	*pollvars[] = {
+	"ups.status",
+	"ups.mode.buzzwords",
+	"experimental.ups.mode.buzzwords"
+};
 
-	set_alarm();
+#define POLLVARS_NUM	SIZEOF_ARRAY(pollvars)
 
-	if ((got_status = get_var(ups, "status", status, sizeof(status))))
-		status[0] = '\0';
-	if ((got_buzzmode = get_var(ups, "buzzword", buzzmode, sizeof(buzzmode))))
-		buzzmode[0] = '\0';
-	if ((got_buzzmodeX = get_var(ups, "X-buzzword", buzzmodeX, sizeof(buzzmodeX))))
-		buzzmodeX[0] = '\0';
+/* one UPS being polled by pollups_batch() */
+typedef struct {
+	utype_t	*ups;
+	char	value[POLLVARS_NUM][SMALLBUF];
+	int	got[POLLVARS_NUM];	/* 0 once the value arrived, like get_var() */
+	size_t	replies;		/* replies read so far */
+	char	line[UPSCLI_NETBUF_LEN];	/* partially received reply */
+	size_t	linelen;
+	struct timeval	deadline;
+	int	done;
+} pollstate_t;
+
+/* handle the outcome of polling one UPS */
+static void pollups_result(pollstate_t *ps)
+{
+	utype_t	*ups = ps->ups;
+	int	pollfail_log = 0;	/* if we throttle, only upsdebugx() but not upslogx() the failures */
+	int	upserror;
 
-	if (got_status == 0 || got_buzzmode == 0 || got_buzzmodeX == 0) {
-		clear_alarm();
+	if (ps->got[0] == 0 || ps->got[1] == 0 || ps->got[2] == 0) {
 
 		/* reset pollfail log throttling */
 #if 0
@@ -3033,12 +3005,11 @@ static void pollups(utype_t *ups)
 		ups->pollfail_log_throttle_state = upserror;
 		ups->pollfail_log_throttle_count = -1;
 
-		parse_status(ups, status, buzzmode, buzzmodeX);
+		parse_status(ups, ps->value[0], ps->value[1], ps->value[2]);
 		return;
 	}
 
 	/* fallthrough: no communications */
-	clear_alarm();
 
 	/* try to make some of these a little friendlier */
 	upserror = upscli_upserror(&ups->conn);
@@ -3126,6 +3097,239 @@ static void pollups(utype_t *ups)
 	}
 }
 
+/* send all the queries of a poll in one write, without waiting */
+static int pollups_send(pollstate_t *ps)
+{
+	utype_t	*ups = ps->ups;
+	char	buf[UPSCLI_NETBUF_LEN];
+	size_t	i, len;
+	struct timeval	tv;
+
+	for (i = 0; i < POLLVARS_NUM; i++) {
+		ps->got[i] = -1;
+		ps->value[i][0] = '\0';
+	}
+
+	/* this shouldn't happen */
+	if (!ups->upsname) {
+		upslogx(LOG_ERR, "%s: programming error: no UPS name set [%s]",
+			__func__, ups->sys);
+		return 0;
+	}
+
+	if (upscli_ssl(&ups->conn) == 1)
+		upsdebugx(2, "%s: %s [SSL]", __func__, ups->sys);
+	else
+		upsdebugx(2, "%s: %s", __func__, ups->sys);
+
+	buf[0] = '\0';
+	for (i = 0; i < POLLVARS_NUM; i++) {
+		snprintfcat(buf, sizeof(buf), "GET VAR %s %s\n",
+			ups->upsname, pollvars[i]);
+	}
+	len = strlen(buf);
+
+	if (upscli_sendline(&ups->conn, buf, len) != 0) {
+		return 0;
+	}
+
+	/* a dead or stuck upsd only holds up its own UPS this long */
+	upscli_get_default_connect_timeout(&tv);
+	if (tv.tv_sec == 0 && tv.tv_usec == 0) {
+		tv.tv_sec = DEFAULT_NETWORK_TIMEOUT;
+	}
+
+	gettimeofday(&ps->deadline, NULL);
+	ps->deadline.tv_sec += tv.tv_sec;
+	ps->deadline.tv_usec += tv.tv_usec;
+	if (ps->deadline.tv_usec >= 1000000) {
+		ps->deadline.tv_sec++;
+		ps->deadline.tv_usec -= 1000000;
+	}
+
+	return 1;
+}
+
+/* take whatever replies have arrived for this UPS, without blocking */
+static void pollups_read(pollstate_t *ps)
+{
+	utype_t	*ups = ps->ups;
+	const char	*query[3];
+	size_t	numa;
+	char	**answer;
+	int	ret;
+
+	while (!ps->done) {
+		ret = upscli_tryreadline(&ups->conn, ps->line, sizeof(ps->line), &ps->linelen);
+
+		if (ret == 0) {
+			return;
+		}
+
+		if (ret < 0) {
+			/* connection lost: the remaining values stay missing */
+			ps->done = 1;
+			return;
+		}
+
+		ps->linelen = 0;
+
+		query[0] = "VAR";
+		query[1] = ups->upsname;
+		query[2] = pollvars[ps->replies];
+
+		upsdebugx(3, "%s: %s / %s", __func__, ups->sys, query[2]);
+
+		if (upscli_get_reply(&ups->conn, ps->line, 3, query, &numa, &answer) < 0) {
+			/* detect old upsd */
+			if (upscli_upserror(&ups->conn) == UPSCLI_ERR_UNKCOMMAND) {
+				upslogx(LOG_ERR, "UPS [%s]: Too old to monitor",
+					ups->sys);
+			}
+		} else if (numa < 4) {
+			upslogx(LOG_ERR, "%s: Error: insufficient data "
+				"(got %" PRIuSIZE " args, need at least 4)",
+				query[2], numa);
+		} else {
+			snprintf(ps->value[ps->replies], sizeof(ps->value[ps->replies]),
+				"%s", answer[3]);
+			ps->got[ps->replies] = 0;
+		}
+
+		if (++ps->replies == POLLVARS_NUM) {
+			ps->done = 1;
+		}
+	}
+}
+
+/* Poll several UPSes at once: the queries go out to all of them first,
+ * then the replies are handled as they arrive, so a slow or stuck upsd
+ * only delays its own UPSes (up to the network timeout), not the rest */
+static void pollups_batch(pollstate_t *ps, size_t count)
+{
+	size_t	i;
+
+	for (i = 0; i < count; i++) {
+		if (!pollups_send(&ps[i])) {
+			ps[i].done = 1;
+			pollups_result(&ps[i]);
+		}
+	}
+
+	for (;;) {
+		struct timeval	now, tv, *first = NULL;
+		double	wait;
+		fd_set	rfds;
+		int	maxfd = -1, fd;
+
+		FD_ZERO(&rfds);
+		gettimeofday(&now, NULL);
+
+		for (i = 0; i < count; i++) {
+			if (ps[i].done) {
+				continue;
+			}
+
+			pollups_read(&ps[i]);
+
+			if (!ps[i].done && difftimeval(ps[i].deadline, now) <= 0) {
+				upsdebugx(1, "%s: UPS [%s] did not answer in time",
+					__func__, ps[i].ups->sys);
+				ps[i].ups->conn.upserror = UPSCLI_ERR_READ;
+				ps[i].ups->conn.syserrno = ETIMEDOUT;
+				upscli_disconnect(&ps[i].ups->conn);
+				ps[i].done = 1;
+			}
+
+			if (ps[i].done) {
+				pollups_result(&ps[i]);
+				continue;
+			}
+
+			fd = upscli_fd(&ps[i].ups->conn);
+			FD_SET(fd, &rfds);
+			if (fd > maxfd) {
+				maxfd = fd;
+			}
+
+			if (!first || difftimeval(ps[i].deadline, *first) < 0) {
+				first = &ps[i].deadline;
+			}
+		}
+
+		if (maxfd < 0) {
+			break;
+		}
+
+		wait = difftimeval(*first, now);
+		tv.tv_sec = (time_t)wait;
+		tv.tv_usec = (suseconds_t)((wait - (double)tv.tv_sec) * 1000000);
+
+		if (select(maxfd + 1, &rfds, NULL, NULL, &tv) < 0 && errno != EINTR) {
+			upslog_with_errno(LOG_ERR, "%s: select", __func__);
+			break;
+		}
+	}
+}
+
+/* see what the status of each UPS is and handle any changes */
+static void pollups_all(void)
+{
+	utype_t	*ups;
+	pollstate_t	*ps;
+	size_t	count = 0, n, polled, i;
+
+	for (ups = firstups; ups != NULL; ups = ups->next) {
+		count++;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	ps = xcalloc(count, sizeof(*ps));
+
+	/* connected UPSes first, so that reconnecting to some that went
+	 * away does not delay the status of the others */
+	n = 0;
+	for (ups = firstups; ups != NULL; ups = ups->next) {
+		if (flag_isset(ups->status, ST_CLICONNECTED)) {
+			ps[n++].ups = ups;
+		}
+	}
+
+	pollups_batch(ps, n);
+	polled = n;
+
+	/* then try a reconnect to the rest, and poll those which came back;
+	 * the ones which were just dropped above are left for the next cycle,
+	 * as the (blocking) connect to an upsd which did not answer in time
+	 * would likely stall this cycle again */
+	for (ups = firstups; ups != NULL; ups = ups->next) {
+		if (flag_isset(ups->status, ST_CLICONNECTED)) {
+			continue;
+		}
+
+		for (i = 0; i < polled && ps[i].ups != ups; i++)
+			;
+
+		if (i < polled) {
+			upsdebugx(2, "%s: UPS [%s] dropped in this cycle, "
+				"reconnecting in the next one",
+				__func__, ups->sys);
+			continue;
+		}
+
+		if (try_connect(ups) == 1) {
+			ps[n++].ups = ups;
+		}
+	}
+
+	pollups_batch(ps + polled, n - polled);
+
+	free(ps);
+}
+
 /* see if the powerdownflag file is there and proper */
 static int pdflag_status(void)
 {
@@ -4015,13 +4219,11 @@ int main(int argc, char *argv[])
 		/* Reset the value, regardless of support */
 		sleep_inhibitor_status = -2;
 
-		for (ups = firstups; ups != NULL; ups = ups->next) {
-			if (isPreparingForSleepSupported() && (sleep_inhibitor_status = isPreparingForSleep()) >= 0) {
-				upsdebugx(2, "Aborting UPS polling sub-loop because OS is preparing for sleep or just woke up");
-				goto end_loop_cycle;
-			}
-			pollups(ups);
+		if (isPreparingForSleepSupported() && (sleep_inhibitor_status = isPreparingForSleep()) >= 0) {
+			upsdebugx(2, "Aborting UPS polling because OS is preparing for sleep or just woke up");
+			goto end_loop_cycle;
 		}
+		pollups_all();
 
 		recalc();
 
@@ -52,6 +52,13 @@ static ulist_t	*ulhead = NULL, *currups = NULL;
 
 static int	skip_clause = 0, skip_block = 0;
 
+	/* variables used by the template, fetched in one round trip for
+	 * each UPS instead of one GET VAR per use (see get_var) */
+static char	**tvars = NULL, **tvals = NULL;
+static size_t	tvarcount = 0;
+static const ulist_t	*tvals_ups = NULL;
+static int	tvals_found = -1;
+
 void parsearg(char *var, char *value)
 {
 	/* avoid bogus junk from evil people */
@@ -104,10 +111,40 @@ static int check_ups_fd(int do_report)
 	return 1;
 }
 
+static void tvars_fetch(void)
+{
+	const	char	**upsnames;
+	size_t	i;
+
+	if (tvals_ups == currups)
+		return;
+
+	for (i = 0; i < tvarcount; i++) {
+		free(tvals[i]);
+		tvals[i] = NULL;
+	}
+
+	tvals_ups = currups;
+	tvals_found = -1;
+
+	if (tvarcount < 2)
+		return;
+
+	upsnames = xcalloc(tvarcount, sizeof(*upsnames));
+
+	for (i = 0; i < tvarcount; i++)
+		upsnames[i] = upsname;
+
+	tvals_found = upscli_get_multi(&ups, tvarcount, upsnames,
+		(const char **)tvars, tvals);
+
+	free(upsnames);
+}
+
 static int get_var(const char *var, char *buf, size_t buflen, int verbose)
 {
 	int	ret;
-	size_t	numq, numa;
+	size_t	numq, numa, i;
 	const	char	*query[4];
 	char	**answer;
 
@@ -121,6 +158,29 @@ static int get_var(const char *var, char *buf, size_t buflen, int verbose)
 		return 0;
 	}
 
+	tvars_fetch();
+
+	for (i = 0; i < tvarcount; i++) {
+		if (strcmp(tvars[i], var) != 0)
+			continue;
+
+		if (tvals[i]) {
+			snprintf(buf, buflen, "%s", tvals[i]);
+			return 1;
+		}
+
+		/* the UPS answered, but does not have this one */
+		if (tvals_found > 0) {
+			if (verbose)
+				printf("Not supported\n");
+
+			return 0;
+		}
+
+		/* otherwise ask again to report the error */
+		break;
+	}
+
 	query[0] = "VAR";
 	query[1] = upsname;
 	query[2] = var;
@@ -847,6 +907,69 @@ static void parse_line(const char *buf)
 	}
 }
 
+static void tvars_add(const char *name, size_t len)
+{
+	size_t	i;
+
+	for (i = 0; i < tvarcount; i++) {
+		if ((strlen(tvars[i]) == len) && (!strncmp(tvars[i], name, len)))
+			return;
+	}
+
+	tvars = xrealloc(tvars, (tvarcount + 1) * sizeof(*tvars));
+	tvars[tvarcount] = xcalloc(1, len + 1);
+	memcpy(tvars[tvarcount], name, len);
+	tvarcount++;
+}
+
+/* collect what looks like a variable name from one @...@ command */
+static void tvars_scan_cmd(const char *cmd, size_t cmdlen)
+{
+	size_t	i, len;
+
+	if ((cmdlen == 6 && !strncmp(cmd, "STATUS", 6))
+	 || (cmdlen == 11 && !strncmp(cmd, "STATUSCOLOR", 11)))
+		tvars_add("ups.status", 10);
+
+	if (cmdlen == 7 && !strncmp(cmd, "RUNTIME", 7))
+		tvars_add("battery.runtime", 15);
+
+	if (cmdlen == 7 && !strncmp(cmd, "UPSTEMP", 7))
+		tvars_add("ups.temperature", 15);
+
+	if (cmdlen == 8 && !strncmp(cmd, "BATTTEMP", 8))
+		tvars_add("battery.temperature", 19);
+
+	if (cmdlen == 7 && !strncmp(cmd, "AMBTEMP", 7))
+		tvars_add("ambient.temperature", 19);
+
+	for (i = 0; i < cmdlen; i += len + 1) {
+		len = strcspn(&cmd[i], " @\r\n");
+		if (i + len > cmdlen)
+			len = cmdlen - i;
+
+		if ((len > 2) && (cmd[i] >= 'a') && (cmd[i] <= 'z')
+		 && (memchr(&cmd[i], '.', len))
+		 && (strspn(&cmd[i], "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-") >= len))
+			tvars_add(&cmd[i], len);
+	}
+}
+
+static void tvars_scan(void)
+{
+	char	buf[LARGEBUF], *cmd, *end;
+
+	while (fgets(buf, sizeof(buf), tf)) {
+		for (cmd = strchr(buf, '@'); cmd && (end = strchr(cmd + 1, '@')); cmd = strchr(end + 1, '@'))
+			tvars_scan_cmd(cmd + 1, (size_t)(end - cmd - 1));
+	}
+
+	rewind(tf);
+
+	if (tvarcount > 0)
+		tvals = xcalloc(tvarcount, sizeof(*tvals));
+}
+
 static void display_template(const char *tfn)
 {
 	char	fn[NUT_PATH_MAX + 1], buf[LARGEBUF];
@@ -863,6 +986,8 @@ static void display_template(const char *tfn)
 		exit(EXIT_FAILURE);
 	}
 
+	tvars_scan();
+
 	while (fgets(buf, sizeof(buf), tf)) {
 		parse_line(buf);
 	}
@@ -0,0 +1,72 @@
+/* dsproto.c - binary framing for the driver/server socket protocol
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "config.h"	/* must be first */
+
+#include <string.h>
+
+#include "dsproto.h"
+
+size_t dsproto_encode(char *buf, size_t bufsize, int op, unsigned int id,
+	const char *payload, size_t len)
+{
+	unsigned char	*hdr = (unsigned char *)buf;
+
+	if (id > DSPROTO_MAX_ID || len > DSPROTO_MAX_PAYLOAD
+	 || bufsize < DSPROTO_HEADER_LEN + len
+	) {
+		return 0;
+	}
+
+	hdr[0] = (unsigned char)op;
+	hdr[1] = (unsigned char)((id >> 8) & 0xFF);
+	hdr[2] = (unsigned char)(id & 0xFF);
+	hdr[3] = (unsigned char)((len >> 8) & 0xFF);
+	hdr[4] = (unsigned char)(len & 0xFF);
+
+	if (len) {
+		memcpy(buf + DSPROTO_HEADER_LEN, payload, len);
+	}
+
+	return DSPROTO_HEADER_LEN + len;
+}
+
+size_t dsproto_decode(const char *buf, size_t len, dsproto_frame_t *frame)
+{
+	const unsigned char	*hdr = (const unsigned char *)buf;
+	size_t	plen;
+
+	if (len < DSPROTO_HEADER_LEN) {
+		return 0;
+	}
+
+	plen = ((size_t)hdr[3] << 8) | (size_t)hdr[4];
+
+	if (len < DSPROTO_HEADER_LEN + plen) {
+		return 0;
+	}
+
+	frame->op = hdr[0];
+	frame->id = ((unsigned int)hdr[1] << 8) | (unsigned int)hdr[2];
+	frame->payload = buf + DSPROTO_HEADER_LEN;
+	frame->len = plen;
+
+	return DSPROTO_HEADER_LEN + plen;
+}
@@ -0,0 +1,578 @@
+/* evloop.c - persistent descriptor event loop for NUT daemons
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "config.h"	/* must be first */
+
+#include <stdio.h>
+#include <errno.h>
+
+#include "common.h"
+#include "nut_stdint.h"
+#include "evloop.h"
+
+#ifndef WIN32
+
+#include <fcntl.h>
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+
+/* how many ready descriptors to fetch from the kernel in one epoll_wait() */
+#define EVLOOP_EPOLL_BATCH	256
+
+/* registration of one descriptor, the table is indexed by fd */
+typedef struct {
+	int	active;
+	int	events;	/* EVLOOP_READ | EVLOOP_WRITE */
+	int	type;
+	void	*data;
+	size_t	pidx;	/* index in the pollfd array (poll backend) */
+	unsigned int	gen;	/* bumped on evloop_del() to invalidate pending events */
+} evloop_reg_t;
+
+/* a ready descriptor in the current batch */
+typedef struct {
+	int	fd;
+	int	events;
+	unsigned int	gen;
+} evloop_ready_t;
+
+struct evloop_s {
+	evloop_backend_t	backend;
+
+	evloop_reg_t	*reg;
+	size_t	reg_len;
+	size_t	count;
+
+	/* poll backend: dense array of registered descriptors */
+	struct pollfd	*pfds;
+	size_t	pfds_len;
+
+#ifdef HAVE_SYS_EPOLL_H
+	/* epoll backend */
+	int	epfd;
+	struct epoll_event	*evs;
+#endif
+
+	/* last batch returned by evloop_wait() */
+	evloop_ready_t	*ready;
+	size_t	ready_len;
+	size_t	nready;
+	size_t	cursor;
+};
+
+static int evloop_reg_grow(evloop_t *loop, int fd)
+{
+	size_t	newlen;
+
+	if ((size_t)fd < loop->reg_len) {
+		return 0;
+	}
+
+	newlen = loop->reg_len ? loop->reg_len : 64;
+	while (newlen <= (size_t)fd) {
+		newlen *= 2;
+	}
+
+	loop->reg = xrealloc(loop->reg, newlen * sizeof(*loop->reg));
+	memset(loop->reg + loop->reg_len, 0,
+		(newlen - loop->reg_len) * sizeof(*loop->reg));
+	loop->reg_len = newlen;
+
+	return 0;
+}
+
+static void evloop_ready_reserve(evloop_t *loop, size_t len)
+{
+	if (loop->ready_len >= len) {
+		return;
+	}
+
+	loop->ready = xrealloc(loop->ready, len * sizeof(*loop->ready));
+	loop->ready_len = len;
+}
+
+static short evloop_to_poll(int events)
+{
+	short	ret = 0;
+
+	if (events & EVLOOP_READ) {
+		ret |= POLLIN;
+	}
+
+	if (events & EVLOOP_WRITE) {
+		ret |= POLLOUT;
+	}
+
+	return ret;
+}
+
+static int evloop_from_poll(short revents)
+{
+	int	ret = 0;
+
+	if (revents & POLLIN) {
+		ret |= EVLOOP_READ;
+	}
+
+	if (revents & POLLOUT) {
+		ret |= EVLOOP_WRITE;
+	}
+
+	if (revents & (POLLHUP|POLLERR|POLLNVAL)) {
+		ret |= EVLOOP_ERROR;
+	}
+
+	return ret;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static uint32_t evloop_to_epoll(int events)
+{
+	uint32_t	ret = 0;
+
+	if (events & EVLOOP_READ) {
+		ret |= EPOLLIN;
+	}
+
+	if (events & EVLOOP_WRITE) {
+		ret |= EPOLLOUT;
+	}
+
+	return ret;
+}
+
+static int evloop_from_epoll(uint32_t revents)
+{
+	int	ret = 0;
+
+	if (revents & EPOLLIN) {
+		ret |= EVLOOP_READ;
+	}
+
+	if (revents & EPOLLOUT) {
+		ret |= EVLOOP_WRITE;
+	}
+
+	if (revents & (EPOLLHUP|EPOLLERR)) {
+		ret |= EVLOOP_ERROR;
+	}
+
+	return ret;
+}
+#endif	/* HAVE_SYS_EPOLL_H */
+
+evloop_t *evloop_create(evloop_backend_t backend)
+{
+	evloop_t	*loop;
+
+	if (backend == EVLOOP_BACKEND_DEFAULT) {
+#ifdef HAVE_SYS_EPOLL_H
+		backend = EVLOOP_BACKEND_EPOLL;
+#else
+		backend = EVLOOP_BACKEND_POLL;
+#endif
+	}
+
+#ifndef HAVE_SYS_EPOLL_H
+	if (backend == EVLOOP_BACKEND_EPOLL) {
+		upsdebugx(1, "%s: epoll backend is not available in this build", __func__);
+		errno = ENOSYS;
+		return NULL;
+	}
+#endif
+
+	loop = xcalloc(1, sizeof(*loop));
+	loop->backend = backend;
+
+#ifdef HAVE_SYS_EPOLL_H
+	loop->epfd = -1;
+
+	if (backend == EVLOOP_BACKEND_EPOLL) {
+# ifdef HAVE_EPOLL_CREATE1
+		loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+# else
+		loop->epfd = epoll_create(EVLOOP_EPOLL_BATCH);
+		if (loop->epfd >= 0) {
+			fcntl(loop->epfd, F_SETFD, FD_CLOEXEC);
+		}
+# endif
+
+		if (loop->epfd < 0) {
+			upsdebug_with_errno(1, "%s: epoll_create", __func__);
+			free(loop);
+			return NULL;
+		}
+
+		loop->evs = xcalloc(EVLOOP_EPOLL_BATCH, sizeof(*loop->evs));
+		evloop_ready_reserve(loop, EVLOOP_EPOLL_BATCH);
+	}
+#endif	/* HAVE_SYS_EPOLL_H */
+
+	upsdebugx(3, "%s: using %s backend", __func__, evloop_backend_name(loop));
+
+	return loop;
+}
+
+void evloop_destroy(evloop_t *loop)
+{
+	if (!loop) {
+		return;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (loop->epfd >= 0) {
+		close(loop->epfd);
+	}
+	free(loop->evs);
+#endif
+
+	free(loop->reg);
+	free(loop->pfds);
+	free(loop->ready);
+	free(loop);
+}
+
+const char *evloop_backend_name(const evloop_t *loop)
+{
+	if (!loop) {
+		return "none";
+	}
+
+	switch (loop->backend) {
+	case EVLOOP_BACKEND_EPOLL:
+		return "epoll";
+	case EVLOOP_BACKEND_POLL:
+		return "poll";
+	case EVLOOP_BACKEND_DEFAULT:
+		break;
+	}
+
+	return "unknown";
+}
+
+size_t evloop_count(const evloop_t *loop)
+{
+	return loop ? loop->count : 0;
+}
+
+int evloop_add(evloop_t *loop, int fd, int events, int type, void *data)
+{
+	evloop_reg_t	*reg;
+
+	if (!loop || fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	evloop_reg_grow(loop, fd);
+	reg = &loop->reg[fd];
+
+	if (reg->active) {
+		errno = EEXIST;
+		return -1;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (loop->backend == EVLOOP_BACKEND_EPOLL) {
+		struct epoll_event	ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = evloop_to_epoll(events);
+		ev.data.fd = fd;
+
+		if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			upsdebug_with_errno(1, "%s: epoll_ctl(ADD, %d)", __func__, fd);
+			return -1;
+		}
+	} else
+#endif	/* HAVE_SYS_EPOLL_H */
+	{
+		if (loop->count >= loop->pfds_len) {
+			loop->pfds_len = loop->pfds_len ? loop->pfds_len * 2 : 64;
+			loop->pfds = xrealloc(loop->pfds, loop->pfds_len * sizeof(*loop->pfds));
+		}
+
+		reg->pidx = loop->count;
+		loop->pfds[reg->pidx].fd = fd;
+		loop->pfds[reg->pidx].events = evloop_to_poll(events);
+		loop->pfds[reg->pidx].revents = 0;
+	}
+
+	reg->active = 1;
+	reg->events = events;
+	reg->type = type;
+	reg->data = data;
+	loop->count++;
+
+	upsdebugx(5, "%s: fd %d (type %d), %" PRIuSIZE " registered",
+		__func__, fd, type, loop->count);
+
+	return 0;
+}
+
+int evloop_mod(evloop_t *loop, int fd, int events)
+{
+	evloop_reg_t	*reg;
+
+	if (!loop || fd < 0 || (size_t)fd >= loop->reg_len || !loop->reg[fd].active) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	reg = &loop->reg[fd];
+	if (reg->events == events) {
+		return 0;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (loop->backend == EVLOOP_BACKEND_EPOLL) {
+		struct epoll_event	ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = evloop_to_epoll(events);
+		ev.data.fd = fd;
+
+		if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+			upsdebug_with_errno(1, "%s: epoll_ctl(MOD, %d)", __func__, fd);
+			return -1;
+		}
+	} else
+#endif	/* HAVE_SYS_EPOLL_H */
+	{
+		loop->pfds[reg->pidx].events = evloop_to_poll(events);
+	}
+
+	reg->events = events;
+
+	return 0;
+}
+
+int evloop_del(evloop_t *loop, int fd)
+{
+	evloop_reg_t	*reg;
+
+	if (!loop || fd < 0 || (size_t)fd >= loop->reg_len || !loop->reg[fd].active) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	reg = &loop->reg[fd];
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (loop->backend == EVLOOP_BACKEND_EPOLL) {
+		struct epoll_event	ev;
+
+		/* pre-2.6.9 kernels require a non-NULL event for DEL;
+		 * the fd may already be closed (and so auto-removed) */
+		memset(&ev, 0, sizeof(ev));
+		if (epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, &ev) < 0
+		 && errno != EBADF && errno != ENOENT
+		) {
+			upsdebug_with_errno(1, "%s: epoll_ctl(DEL, %d)", __func__, fd);
+		}
+	} else
+#endif	/* HAVE_SYS_EPOLL_H */
+	{
+		/* move the last entry into the freed slot */
+		size_t	last = loop->count - 1;
+
+		if (reg->pidx != last) {
+			loop->pfds[reg->pidx] = loop->pfds[last];
+			loop->reg[loop->pfds[reg->pidx].fd].pidx = reg->pidx;
+		}
+	}
+
+	reg->active = 0;
+	reg->data = NULL;
+	reg->gen++;
+	loop->count--;
+
+	upsdebugx(5, "%s: fd %d, %" PRIuSIZE " registered",
+		__func__, fd, loop->count);
+
+	return 0;
+}
+
+int evloop_wait(evloop_t *loop, int timeout_ms)
+{
+	int	ret, i;
+
+	if (!loop) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	loop->nready = 0;
+	loop->cursor = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (loop->backend == EVLOOP_BACKEND_EPOLL) {
+		ret = epoll_wait(loop->epfd, loop->evs, EVLOOP_EPOLL_BATCH, timeout_ms);
+
+		if (ret <= 0) {
+			return ret;
+		}
+
+		for (i = 0; i < ret; i++) {
+			int	fd = loop->evs[i].data.fd;
+
+			loop->ready[i].fd = fd;
+			loop->ready[i].events = evloop_from_epoll(loop->evs[i].events);
+			loop->ready[i].gen = loop->reg[fd].gen;
+		}
+
+		loop->nready = (size_t)ret;
+		return ret;
+	}
+#endif	/* HAVE_SYS_EPOLL_H */
+
+	ret = poll(loop->pfds, (nfds_t)loop->count, timeout_ms);
+
+	if (ret <= 0) {
+		return ret;
+	}
+
+	evloop_ready_reserve(loop, (size_t)ret);
+
+	/* poll(2) has no way around scanning the whole array */
+	for (i = 0; (size_t)i < loop->count && loop->nready < (size_t)ret; i++) {
+		int	fd;
+
+		if (!loop->pfds[i].revents) {
+			continue;
+		}
+
+		fd = loop->pfds[i].fd;
+		loop->ready[loop->nready].fd = fd;
+		loop->ready[loop->nready].events = evloop_from_poll(loop->pfds[i].revents);
+		loop->ready[loop->nready].gen = loop->reg[fd].gen;
+		loop->nready++;
+	}
+
+	return (int)loop->nready;
+}
+
+int evloop_next(evloop_t *loop, evloop_event_t *ev)
+{
+	if (!loop || !ev) {
+		return 0;
+	}
+
+	while (loop->cursor < loop->nready) {
+		evloop_ready_t	*r = &loop->ready[loop->cursor++];
+		evloop_reg_t	*reg = &loop->reg[r->fd];
+
+		/* removed (and maybe re-added) since the wait */
+		if (!reg->active || reg->gen != r->gen) {
+			continue;
+		}
+
+		/* only report what the caller is still interested in */
+		ev->events = r->events & (reg->events | EVLOOP_ERROR);
+		if (!ev->events) {
+			continue;
+		}
+
+		ev->fd = r->fd;
+		ev->type = reg->type;
+		ev->data = reg->data;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+#else	/* WIN32 */
+
+/* upsd on WIN32 waits on event handles with WaitForMultipleObjects() */
+
+evloop_t *evloop_create(evloop_backend_t backend)
+{
+	NUT_UNUSED_VARIABLE(backend);
+	errno = ENOSYS;
+	return NULL;
+}
+
+void evloop_destroy(evloop_t *loop)
+{
+	NUT_UNUSED_VARIABLE(loop);
+}
+
+const char *evloop_backend_name(const evloop_t *loop)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	return "none";
+}
+
+size_t evloop_count(const evloop_t *loop)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	return 0;
+}
+
+int evloop_add(evloop_t *loop, int fd, int events, int type, void *data)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	NUT_UNUSED_VARIABLE(fd);
+	NUT_UNUSED_VARIABLE(events);
+	NUT_UNUSED_VARIABLE(type);
+	NUT_UNUSED_VARIABLE(data);
+	errno = ENOSYS;
+	return -1;
+}
+
+int evloop_mod(evloop_t *loop, int fd, int events)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	NUT_UNUSED_VARIABLE(fd);
+	NUT_UNUSED_VARIABLE(events);
+	errno = ENOSYS;
+	return -1;
+}
+
+int evloop_del(evloop_t *loop, int fd)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	NUT_UNUSED_VARIABLE(fd);
+	errno = ENOSYS;
+	return -1;
+}
+
+int evloop_wait(evloop_t *loop, int timeout_ms)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	NUT_UNUSED_VARIABLE(timeout_ms);
+	errno = ENOSYS;
+	return -1;
+}
+
+int evloop_next(evloop_t *loop, evloop_event_t *ev)
+{
+	NUT_UNUSED_VARIABLE(loop);
+	NUT_UNUSED_VARIABLE(ev);
+	return 0;
+}
+
+#endif	/* WIN32 */
@@ -27,7 +27,8 @@
  * All subsequent calls must have it as the first argument.  There are
  * two entry points for parsing lines.  You can have it read a file
  * (pconf_file_begin and pconf_file_next), take lines directly from
- * the caller (pconf_line), or go along a character at a time (pconf_char).
+ * the caller (pconf_line), go along a character at a time (pconf_char),
+ * or hand over whatever was just read from a socket (pconf_feed).
  * The parsing is identical no matter how you feed it.
  *
  * Since there are no more callbacks, you take the successful return
@@ -71,6 +72,12 @@
  * result, you can parse extremely long words and lines with an insane
  * number of elements.
  *
+ * pconf_feed skips the state machine for the runs of characters which
+ * cannot change the state (spaces between words, ordinary characters
+ * inside a word or quotes, comments) using a character class table and
+ * memchr, and copies such runs into the word at once.  Everything else
+ * (quotes, backslashes, word and line ends) goes through parse_char.
+ *
  * Finally, there is argsize, which remembers how long each of the
  * arglist elements are.  This is how we know when to expand them.
  *
@@ -104,6 +111,36 @@
 #define STATE_ENDOFLINE		7
 #define STATE_PARSEERR		8
 
+/* character classes for the pconf_feed fast paths */
+#define CC_SPACE	0x01	/* skipped before a word (isspace, but not newline) */
+#define CC_WORD		0x02	/* kept inside a word, no state change */
+#define CC_QUOTED	0x04	/* kept inside "quotes", no state change */
+
+static unsigned char	pconf_class[256];
+static int	pconf_class_ready = 0;
+
+static void pconf_class_init(void)
+{
+	int	c;
+
+	for (c = 0x20; c <= 0x7f; c++) {
+		pconf_class[c] = CC_WORD | CC_QUOTED;
+	}
+
+	pconf_class[' '] = CC_SPACE | CC_QUOTED;
+	pconf_class['\t'] = CC_SPACE;
+	pconf_class['\v'] = CC_SPACE;
+	pconf_class['\f'] = CC_SPACE;
+	pconf_class['\r'] = CC_SPACE;
+
+	pconf_class['#'] = 0;
+	pconf_class['\\'] = 0;
+	pconf_class['='] = CC_QUOTED;
+	pconf_class['"'] = CC_WORD;
+
+	pconf_class_ready = 1;
+}
+
 static void pconf_fatal(PCONF_CTX_t *ctx, const char *errtxt)
 	__attribute__((noreturn));
 
@@ -149,7 +186,7 @@ static void add_arg_word(PCONF_CTX_t *ctx)
 		ctx->argsize[argpos] = 0;
 	}
 
-	wbuflen = strlen(ctx->wordbuf);
+	wbuflen = (size_t)(ctx->wordptr - ctx->wordbuf);
 
 	/* now see if the string itself grew compared to last time */
 	if (wbuflen >= ctx->argsize[argpos]) {
@@ -168,18 +205,56 @@ static void add_arg_word(PCONF_CTX_t *ctx)
 		ctx->argsize[argpos] = newlen;
 	}
 
-	/* strncpy doesn't give us a trailing NULL, so prep the space */
-	memset(ctx->arglist[argpos], '\0', ctx->argsize[argpos]);
+	/* finally copy the new value (and its trailing NULL) into the provided space */
+	memcpy(ctx->arglist[argpos], ctx->wordbuf, wbuflen + 1);
+}
 
-	/* finally copy the new value into the provided space */
-	strncpy(ctx->arglist[argpos], ctx->wordbuf, wbuflen);
+/* make room for len more characters (and the null) in wordbuf */
+static void growword(PCONF_CTX_t *ctx, size_t len)
+{
+	size_t	wbuflen = (size_t)(ctx->wordptr - ctx->wordbuf);
+
+	if (wbuflen + len < ctx->wordbufsize)
+		return;
+
+	while (wbuflen + len >= ctx->wordbufsize)
+		ctx->wordbufsize *= 2;
+
+	ctx->wordbuf = realloc(ctx->wordbuf, ctx->wordbufsize);
+
+	if (!ctx->wordbuf)
+		pconf_fatal(ctx, "realloc wordbuf failed");
+
+	/* repoint as wordbuf may have moved */
+	ctx->wordptr = &ctx->wordbuf[wbuflen];
+}
+
+/* append a run of characters which addchar() would accept one by one */
+static void addchars(PCONF_CTX_t *ctx, const char *src, size_t len)
+{
+	size_t	wbuflen = (size_t)(ctx->wordptr - ctx->wordbuf);
+
+	if (ctx->wordlen_limit != 0) {
+		if (wbuflen >= ctx->wordlen_limit)
+			return;
+
+		if (len > ctx->wordlen_limit - wbuflen)
+			len = ctx->wordlen_limit - wbuflen;
+	}
+
+	growword(ctx, len);
+
+	memcpy(ctx->wordptr, src, len);
+	ctx->wordptr += len;
+	*ctx->wordptr = '\0';
 }
 
 static void addchar(PCONF_CTX_t *ctx)
 {
 	size_t	wbuflen;
 
-	wbuflen = strlen(ctx->wordbuf);
+	/* no embedded nulls get here, so this is strlen(ctx->wordbuf) */
+	wbuflen = (size_t)(ctx->wordptr - ctx->wordbuf);
 
 	/* CVE-2012-2944: only allow the subset of ASCII charset from Space to ~ */
 	if ((ctx->ch < 0x20) || (ctx->ch > 0x7f)) {
@@ -197,17 +272,7 @@ static void addchar(PCONF_CTX_t *ctx)
 	}
 
 	/* allow for the null */
-	if (wbuflen >= (ctx->wordbufsize - 1)) {
-		ctx->wordbufsize += 8;
-
-		ctx->wordbuf = realloc(ctx->wordbuf, ctx->wordbufsize);
-
-		if (!ctx->wordbuf)
-			pconf_fatal(ctx, "realloc wordbuf failed");
-
-		/* repoint as wordbuf may have moved */
-		ctx->wordptr = &ctx->wordbuf[wbuflen];
-	}
+	growword(ctx, 1);
 
 	*ctx->wordptr++ = (char)ctx->ch;
 	*ctx->wordptr = '\0';
@@ -424,6 +489,9 @@ int pconf_init(PCONF_CTX_t *ctx, void errhandler(const char *))
 	ctx->errhandler = errhandler;
 	ctx->magic = PCONF_CTX_t_MAGIC;
 
+	if (!pconf_class_ready)
+		pconf_class_init();
+
 	return 1;
 }
 
@@ -572,17 +640,8 @@ int pconf_line(PCONF_CTX_t *ctx, const char *line)
 
 	linelen = strlen(line);
 
-	for (i = 0; i < linelen; i++) {
-		ctx->ch = line[i];
-
-		parse_char(ctx);
-
-		if (ctx->state == STATE_PARSEERR)
-			return 1;
-
-		if (ctx->state == STATE_ENDOFLINE)
-			return 1;
-	}
+	if (pconf_feed(ctx, line, linelen, &i) != 0)
+		return 1;
 
 	/* deal with any lingering characters */
 
@@ -593,8 +652,6 @@ int pconf_line(PCONF_CTX_t *ctx, const char *line)
 	return 1;
 }
 
-#define PCONF_ESCAPE "#\\\""
-
 char *pconf_encode(const char *src, char *dest, size_t destsize)
 {
 	size_t	i, srclen, destlen, maxlen;
@@ -652,3 +709,75 @@ int pconf_char(PCONF_CTX_t *ctx, char ch)
 
 	return 0;
 }
+
+/* parse input a buffer at a time: returns like pconf_char for the
+ * character where it stopped, and *used tells how many were eaten */
+int pconf_feed(PCONF_CTX_t *ctx, const char *buf, size_t len, size_t *used)
+{
+	const unsigned char	*ubuf = (const unsigned char *)buf;
+	const char	*eol;
+	size_t	i = 0, start;
+
+	*used = 0;
+
+	if (!check_magic(ctx))
+		return -1;
+
+	/* if the last call finished a line, clean stuff up for another */
+	if ((ctx->state == STATE_ENDOFLINE) || (ctx->state == STATE_PARSEERR)) {
+		ctx->numargs = 0;
+		ctx->state = STATE_FINDWORDSTART;
+	}
+
+	while (i < len) {
+		/* skip over what would not change the state anyway */
+		switch (ctx->state) {
+			case STATE_FINDWORDSTART:
+				while (i < len && (pconf_class[ubuf[i]] & CC_SPACE))
+					i++;
+				break;
+
+			case STATE_FINDEOL:
+				eol = memchr(buf + i, '\n', len - i);
+				i = eol ? (size_t)(eol - buf) : len;
+				break;
+
+			case STATE_COLLECT:
+				start = i;
+				while (i < len && (pconf_class[ubuf[i]] & CC_WORD))
+					i++;
+				addchars(ctx, buf + start, i - start);
+				break;
+
+			case STATE_QUOTECOLLECT:
+				start = i;
+				while (i < len && (pconf_class[ubuf[i]] & CC_QUOTED))
+					i++;
+				addchars(ctx, buf + start, i - start);
+				break;
+
+			default:
+				break;
+		}
+
+		if (i >= len)
+			break;
+
+		/* and let the state machine handle the rest */
+		ctx->ch = buf[i++];
+		parse_char(ctx);
+
+		if (ctx->state == STATE_ENDOFLINE) {
+			*used = i;
+			return 1;
+		}
+
+		if (ctx->state == STATE_PARSEERR) {
+			*used = i;
+			return -1;
+		}
+	}
+
+	*used = len;
+	return 0;
+}
@@ -36,23 +36,153 @@
 #include "state.h"
 #include "parseconf.h"
 
+#include <stddef.h>
+
+/* memory accounting, see state_get_memstats() */
+static st_tree_memstats_t	st_memstats;
+
+/* Variable names are interned: all nodes with the same name, in any
+ * tree of the process (e.g. one per UPS in upsd), share one copy.
+ * Names are kept in a chained hash table with reference counts.
+ */
+typedef struct st_name_s {
+	struct st_name_s	*next;
+	size_t	hash;
+	size_t	refcount;
+	char	name[1];	/* allocated to fit */
+} st_name_t;
+
+static st_name_t	**st_names = NULL;
+static size_t	st_names_buckets = 0;
+
 /* internal helpers */
 
-static void val_escape(st_tree_t *node)
+static size_t st_name_hash(const char *name)
 {
-	char	etmp[ST_MAX_VALUE_LEN];
+	return str_hash(STR_HASH_INIT, name, strlen(name), 0);
+}
 
-	/* escape any tricky stuff like \ and " */
-	pconf_encode(node->raw, etmp, sizeof(etmp));
+static void st_names_grow(void)
+{
+	size_t	i, newsize = st_names_buckets ? st_names_buckets * 2 : 256;
+	st_name_t	**newtab = xcalloc(newsize, sizeof(*newtab));
+
+	for (i = 0; i < st_names_buckets; i++) {
+		while (st_names[i]) {
+			st_name_t	*entry = st_names[i];
+
+			st_names[i] = entry->next;
+			entry->next = newtab[entry->hash % newsize];
+			newtab[entry->hash % newsize] = entry;
+		}
+	}
+
+	free(st_names);
+	st_memstats.bytes += (newsize - st_names_buckets) * sizeof(*newtab);
+	st_names = newtab;
+	st_names_buckets = newsize;
+}
+
+static char *st_name_intern(const char *name)
+{
+	size_t	hash = st_name_hash(name), len;
+	st_name_t	*entry;
+
+	if (st_names_buckets) {
+		for (entry = st_names[hash % st_names_buckets]; entry; entry = entry->next) {
+			if (entry->hash == hash && !strcmp(entry->name, name)) {
+				entry->refcount++;
+				return entry->name;
+			}
+		}
+	}
+
+	if (st_memstats.names >= st_names_buckets) {
+		st_names_grow();
+	}
+
+	len = strlen(name);
+	entry = xmalloc(sizeof(*entry) + len);
+	memcpy(entry->name, name, len + 1);
+	entry->hash = hash;
+	entry->refcount = 1;
+	entry->next = st_names[hash % st_names_buckets];
+	st_names[hash % st_names_buckets] = entry;
+
+	st_memstats.names++;
+	st_memstats.bytes += sizeof(*entry) + len;
+
+	return entry->name;
+}
+
+static void st_name_release(char *name)
+{
+	st_name_t	*entry = (st_name_t *)(void *)(name - offsetof(st_name_t, name));
+	st_name_t	**eptr;
+
+	if (--entry->refcount) {
+		return;
+	}
+
+	for (eptr = &st_names[entry->hash % st_names_buckets]; *eptr; eptr = &(*eptr)->next) {
+		if (*eptr == entry) {
+			*eptr = entry->next;
+			break;
+		}
+	}
+
+	st_memstats.names--;
+	st_memstats.bytes -= sizeof(*entry) + strlen(entry->name);
+	free(entry);
+
+	/* do not leave the table behind once all trees are gone */
+	if (!st_memstats.names) {
+		st_memstats.bytes -= st_names_buckets * sizeof(*st_names);
+		free(st_names);
+		st_names = NULL;
+		st_names_buckets = 0;
+	}
+}
+
+/* store a new raw value of <len> characters, in rawbuf if it fits */
+static void st_tree_node_set_raw(st_tree_t *node, const char *val, size_t len)
+{
+	if (node->rawsize < (len + 1)) {
+		if (node->raw == node->rawbuf) {
+			node->raw = NULL;
+			st_memstats.heap_values++;
+		} else {
+			st_memstats.bytes -= node->rawsize;
+		}
 
-	/* if nothing was escaped, we don't need to do anything else */
-	if (!strcmp(node->raw, etmp)) {
+		node->rawsize = len + 1;
+		node->raw = xrealloc(node->raw, node->rawsize);
+		st_memstats.bytes += node->rawsize;
+	}
+
+	memcpy(node->raw, val, len + 1);
+}
+
+static void val_escape(st_tree_t *node, size_t len)
+{
+	char	etmp[ST_MAX_VALUE_LEN];
+
+	/* most values have nothing to escape (and are not truncated) */
+	if (len < sizeof(etmp) && !strpbrk(node->raw, PCONF_ESCAPE)) {
 		node->val = node->raw;
 		return;
 	}
 
+	/* escape any tricky stuff like \ and " */
+	pconf_encode(node->raw, etmp, sizeof(etmp));
+
 	/* if the escaped value grew, deal with it */
 	if (node->safesize < (strlen(etmp) + 1)) {
+		if (!node->safe) {
+			st_memstats.heap_values++;
+		}
+		st_memstats.bytes += strlen(etmp) + 1 - node->safesize;
+
 		node->safesize = strlen(etmp) + 1;
 		node->safe = xrealloc(node->safe, node->safesize);
 	}
@@ -69,6 +199,7 @@ static void st_tree_enum_free(enum_t *list)
 
 	st_tree_enum_free(list->next);
 
+	st_memstats.bytes -= sizeof(*list) + strlen(list->val) + 1;
 	free(list->val);
 	free(list);
 }
@@ -81,15 +212,26 @@ static void st_tree_range_free(range_t *list)
 
 	st_tree_range_free(list->next);
 
+	st_memstats.bytes -= sizeof(*list);
 	free(list);
 }
 
 /* free all memory associated with a node */
 static void st_tree_node_free(st_tree_t *node)
 {
-	free(node->var);
-	free(node->raw);
-	free(node->safe);
+	st_name_release(node->var);
+
+	if (node->raw != node->rawbuf) {
+		st_memstats.heap_values--;
+		st_memstats.bytes -= node->rawsize;
+		free(node->raw);
+	}
+
+	if (node->safe) {
+		st_memstats.heap_values--;
+		st_memstats.bytes -= node->safesize;
+		free(node->safe);
+	}
 
 	/* never free node->val, since it's just a pointer to raw or safe */
 
@@ -100,35 +242,144 @@ static void st_tree_node_free(st_tree_t *node)
 	st_tree_range_free(node->range_list);
 
 	/* now finally kill the node itself */
+	st_memstats.nodes--;
+	st_memstats.bytes -= sizeof(*node);
 	free(node);
 }
 
-/* add a subtree to another subtree */
-static void st_tree_node_add(st_tree_t **nptr, st_tree_t *sptr)
+/* The tree is kept height-balanced (AVL), so that lookups stay
+ * logarithmic even when variables arrive in sorted order, as they
+ * do e.g. when upsd replays a DUMPALL from the driver. The in-order
+ * walk over left/right is unchanged for the tree dumping code.
+ */
+static int st_tree_height(const st_tree_t *node)
 {
-	if (!sptr) {
-		return;
-	}
+	return node ? node->height : 0;
+}
+
+static void st_tree_update_height(st_tree_t *node)
+{
+	int	lh = st_tree_height(node->left), rh = st_tree_height(node->right);
+
+	node->height = 1 + (lh > rh ? lh : rh);
+}
 
-	while (*nptr) {
+static st_tree_t *st_tree_rotate_right(st_tree_t *node)
+{
+	st_tree_t	*top = node->left;
 
-		st_tree_t	*node = *nptr;
+	node->left = top->right;
+	top->right = node;
 
-		if (strcasecmp(node->var, sptr->var) > 0) {
-			nptr = &node->left;
-			continue;
+	st_tree_update_height(node);
+	st_tree_update_height(top);
+
+	return top;
+}
+
+static st_tree_t *st_tree_rotate_left(st_tree_t *node)
+{
+	st_tree_t	*top = node->right;
+
+	node->right = top->left;
+	top->left = node;
+
+	st_tree_update_height(node);
+	st_tree_update_height(top);
+
+	return top;
+}
+
+/* restore the balance of a subtree after one of its children changed,
+ * returns the new root of this subtree */
+static st_tree_t *st_tree_rebalance(st_tree_t *node)
+{
+	int	balance;
+
+	st_tree_update_height(node);
+	balance = st_tree_height(node->left) - st_tree_height(node->right);
+
+	if (balance > 1) {
+		if (st_tree_height(node->left->left) < st_tree_height(node->left->right)) {
+			node->left = st_tree_rotate_left(node->left);
 		}
+		return st_tree_rotate_right(node);
+	}
 
-		if (strcasecmp(node->var, sptr->var) < 0) {
-			nptr = &node->right;
-			continue;
+	if (balance < -1) {
+		if (st_tree_height(node->right->right) < st_tree_height(node->right->left)) {
+			node->right = st_tree_rotate_right(node->right);
 		}
+		return st_tree_rotate_left(node);
+	}
 
-		upsdebugx(1, "%s: duplicate value (shouldn't happen)", __func__);
-		return;
+	return node;
+}
+
+/* add a new node (which must not be in the tree yet) to a subtree,
+ * returns the new root of this subtree */
+static st_tree_t *st_tree_node_insert(st_tree_t *node, st_tree_t *sptr)
+{
+	if (!node) {
+		sptr->height = 1;
+		return sptr;
+	}
+
+	if (strcasecmp(node->var, sptr->var) > 0) {
+		node->left = st_tree_node_insert(node->left, sptr);
+	} else {
+		node->right = st_tree_node_insert(node->right, sptr);
+	}
+
+	return st_tree_rebalance(node);
+}
+
+/* take the leftmost node out of a subtree into *min,
+ * returns the new root of this subtree */
+static st_tree_t *st_tree_node_detach_min(st_tree_t *node, st_tree_t **min)
+{
+	if (!node->left) {
+		*min = node;
+		return node->right;
+	}
+
+	node->left = st_tree_node_detach_min(node->left, min);
+
+	return st_tree_rebalance(node);
+}
+
+/* take a node (which must be in the tree) out of a subtree without
+ * freeing it, returns the new root of this subtree */
+static st_tree_t *st_tree_node_unlink(st_tree_t *node, const st_tree_t *target)
+{
+	if (node != target) {
+		if (strcasecmp(node->var, target->var) > 0) {
+			node->left = st_tree_node_unlink(node->left, target);
+		} else {
+			node->right = st_tree_node_unlink(node->right, target);
+		}
+
+		return st_tree_rebalance(node);
+	}
+
+	if (!node->left) {
+		return node->right;
+	}
+
+	if (!node->right) {
+		return node->left;
 	}
 
-	*nptr = sptr;
+	/* replace it with its in-order successor */
+	{
+		st_tree_t	*succ = NULL, *right;
+
+		right = st_tree_node_detach_min(node->right, &succ);
+		succ->left = node->left;
+		succ->right = right;
+
+		return st_tree_rebalance(succ);
+	}
 }
 
 static int st_tree_node_refresh_timestamp(const st_tree_t *node)
@@ -196,96 +447,56 @@ int st_tree_node_compare_timestamp(
  */
 int state_delinfo(st_tree_t **nptr, const char *var)
 {
-	while (*nptr) {
+	st_tree_t	*node = state_tree_find(*nptr, var);
 
-		st_tree_t	*node = *nptr;
-
-		if (strcasecmp(node->var, var) > 0) {
-			nptr = &node->left;
-			continue;
-		}
-
-		if (strcasecmp(node->var, var) < 0) {
-			nptr = &node->right;
-			continue;
-		}
-
-		if (node->flags & ST_FLAG_IMMUTABLE) {
-			upsdebugx(6, "%s: not deleting immutable variable [%s]", __func__, var);
-			return 0;
-		}
-
-		/* whatever is on the left, hang it off current right */
-		st_tree_node_add(&node->right, node->left);
+	if (!node) {
+		return 0;	/* not found */
+	}
 
-		/* now point the parent at the old right child */
-		*nptr = node->right;
+	if (node->flags & ST_FLAG_IMMUTABLE) {
+		upsdebugx(6, "%s: not deleting immutable variable [%s]", __func__, var);
+		return 0;
+	}
 
-		st_tree_node_free(node);
+	*nptr = st_tree_node_unlink(*nptr, node);
 
-		return 1;
-	}
+	st_tree_node_free(node);
 
-	return 0;	/* not found */
+	return 1;
 }
 
 int state_delinfo_olderthan(st_tree_t **nptr, const char *var, const st_tree_timespec_t *cutoff)
 {
-	while (*nptr) {
-
-		st_tree_t	*node = *nptr;
-
-		if (strcasecmp(node->var, var) > 0) {
-			nptr = &node->left;
-			continue;
-		}
-
-		if (strcasecmp(node->var, var) < 0) {
-			nptr = &node->right;
-			continue;
-		}
+	st_tree_t	*node = state_tree_find(*nptr, var);
 
-		if (node->flags & ST_FLAG_IMMUTABLE) {
-			upsdebugx(6, "%s: not deleting immutable variable [%s]", __func__, var);
-			return 0;
-		}
-
-		if (st_tree_node_compare_timestamp(node, cutoff) >= 0) {
-			upsdebugx(6, "%s: not deleting recently updated variable [%s]", __func__, var);
-			return 0;
-		}
-		upsdebugx(6, "%s: deleting variable [%s] last updated too long ago", __func__, var);
+	if (!node) {
+		return 0;	/* not found */
+	}
 
-		/* whatever is on the left, hang it off current right */
-		st_tree_node_add(&node->right, node->left);
+	if (node->flags & ST_FLAG_IMMUTABLE) {
+		upsdebugx(6, "%s: not deleting immutable variable [%s]", __func__, var);
+		return 0;
+	}
 
-		/* now point the parent at the old right child */
-		*nptr = node->right;
+	if (st_tree_node_compare_timestamp(node, cutoff) >= 0) {
+		upsdebugx(6, "%s: not deleting recently updated variable [%s]", __func__, var);
+		return 0;
+	}
+	upsdebugx(6, "%s: deleting variable [%s] last updated too long ago", __func__, var);
 
-		st_tree_node_free(node);
+	*nptr = st_tree_node_unlink(*nptr, node);
 
-		return 1;
-	}
+	st_tree_node_free(node);
 
-	return 0;	/* not found */
+	return 1;
 }
 
 int state_setinfo(st_tree_t **nptr, const char *var, const char *val)
 {
-	while (*nptr) {
-
-		st_tree_t	*node = *nptr;
-
-		if (strcasecmp(node->var, var) > 0) {
-			nptr = &node->left;
-			continue;
-		}
-
-		if (strcasecmp(node->var, var) < 0) {
-			nptr = &node->right;
-			continue;
-		}
+	st_tree_t	*node = state_tree_find(*nptr, var);
+	size_t	len = strlen(val);
 
+	if (node) {
 		/* refresh even if "skip-writing" same info value */
 		st_tree_node_refresh_timestamp(node);
 
@@ -300,28 +511,27 @@ int state_setinfo(st_tree_t **nptr, const char *var, const char *val)
 			return 0;	/* no change */
 		}
 
-		/* expand the buffer if the value grows */
-		if (node->rawsize < (strlen(val) + 1)) {
-			node->rawsize = strlen(val) + 1;
-			node->raw = xrealloc(node->raw, node->rawsize);
-		}
-
 		/* store the literal value for later comparisons */
-		snprintf(node->raw, node->rawsize, "%s", val);
+		st_tree_node_set_raw(node, val, len);
 
-		val_escape(node);
+		val_escape(node, len);
 
 		return 1;	/* changed */
 	}
 
-	*nptr = xcalloc(1, sizeof(**nptr));
+	node = xcalloc(1, sizeof(*node));
+	st_memstats.nodes++;
+	st_memstats.bytes += sizeof(*node);
+
+	node->var = st_name_intern(var);
+	node->raw = node->rawbuf;
+	node->rawsize = sizeof(node->rawbuf);
+	st_tree_node_set_raw(node, val, len);
+	st_tree_node_refresh_timestamp(node);
 
-	(*nptr)->var = xstrdup(var);
-	(*nptr)->raw = xstrdup(val);
-	(*nptr)->rawsize = strlen(val) + 1;
-	st_tree_node_refresh_timestamp(*nptr);
+	val_escape(node, len);
 
-	val_escape(*nptr);
+	*nptr = st_tree_node_insert(*nptr, node);
 
 	return 1;	/* added */
 }
@@ -343,6 +553,7 @@ static int st_tree_enum_add(enum_t **list, const char *enc)
 	item = xcalloc(1, sizeof(*item));
 	item->val = xstrdup(enc);
 	item->next = *list;
+	st_memstats.bytes += sizeof(*item) + strlen(enc) + 1;
 
 	/* now we're done creating it, add it to the list */
 	*list = item;
@@ -389,6 +600,7 @@ static int st_tree_range_add(range_t **list, const int min, const int max)
 	item->min = min;
 	item->max = max;
 	item->next = *list;
+	st_memstats.bytes += sizeof(*item);
 
 	/* now we're done creating it, add it to the list */
 	*list = item;
@@ -652,6 +864,7 @@ static int st_tree_del_enum(enum_t **list, const char *val)
 		/* we found it! */
 		*list = item->next;
 
+		st_memstats.bytes -= sizeof(*item) + strlen(item->val) + 1;
 		free(item->val);
 		free(item);
 
@@ -691,6 +904,7 @@ static int st_tree_del_range(range_t **list, const int min, const int max)
 		/* we found it! */
 		*list = item->next;
 
+		st_memstats.bytes -= sizeof(*item);
 		free(item);
 
 		return 1;	/* deleted */
@@ -718,12 +932,14 @@ st_tree_t *state_tree_find(st_tree_t *node, const char *var)
 {
 	while (node) {
 
-		if (strcasecmp(node->var, var) > 0) {
+		int	cmp = strcasecmp(node->var, var);
+
+		if (cmp > 0) {
 			node = node->left;
 			continue;
 		}
 
-		if (strcasecmp(node->var, var) < 0) {
+		if (cmp < 0) {
 			node = node->right;
 			continue;
 		}
@@ -733,3 +949,10 @@ st_tree_t *state_tree_find(st_tree_t *node, const char *var)
 
 	return node;
 }
+
+void state_get_memstats(st_tree_memstats_t *stats)
+{
+	if (stats) {
+		*stats = st_memstats;
+	}
+}
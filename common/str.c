@@ -628,6 +628,24 @@ int str_ends_with(const char *s, const char *suff) {
 	return (slen >= sufflen) && (!memcmp(s + slen - sufflen, suff, sufflen));
 }
 
+uint32_t str_hash(uint32_t hash, const void *data, size_t len, int nocase)
+{
+	const unsigned char	*p = (const unsigned char *)data;
+	size_t	i;
+
+	if (nocase) {
+		for (i = 0; i < len; i++) {
+			hash = (hash ^ (uint32_t)tolower(p[i])) * 16777619U;
+		}
+	} else {
+		for (i = 0; i < len; i++) {
+			hash = (hash ^ p[i]) * 16777619U;
+		}
+	}
+
+	return hash;
+}
+
 #ifndef HAVE_STRTOF
 # include <errno.h>
 # include <stdio.h>
@@ -0,0 +1,191 @@
+/* strmap.c - string keyed hash index for NUT daemons
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "config.h"	/* must be first */
+
+#include <string.h>
+
+#include "common.h"
+#include "strmap.h"
+
+typedef struct strmap_entry_s {
+	char	*key;
+	void	*value;
+	size_t	hash;
+	struct strmap_entry_s	*next;
+} strmap_entry_t;
+
+struct strmap_s {
+	int	flags;
+	size_t	count;
+	size_t	buckets;	/* always a power of two */
+	strmap_entry_t	**table;
+};
+
+/* folded to lower case for STRMAP_NOCASE maps */
+static size_t strmap_hash(const strmap_t *map, const char *key)
+{
+	return str_hash(STR_HASH_INIT, key, strlen(key), map->flags & STRMAP_NOCASE);
+}
+
+static int strmap_keyeq(const strmap_t *map, const char *a, const char *b)
+{
+	return (map->flags & STRMAP_NOCASE) ? !strcasecmp(a, b) : !strcmp(a, b);
+}
+
+static strmap_entry_t **strmap_find(const strmap_t *map, const char *key, size_t hash)
+{
+	strmap_entry_t	**eptr;
+
+	for (eptr = &map->table[hash & (map->buckets - 1)]; *eptr; eptr = &(*eptr)->next) {
+		if ((*eptr)->hash == hash && strmap_keyeq(map, (*eptr)->key, key)) {
+			break;
+		}
+	}
+
+	return eptr;
+}
+
+/* keep chains short: double the table once it is full on average */
+static void strmap_grow(strmap_t *map)
+{
+	strmap_entry_t	**newtab, *entry, *next;
+	size_t	newsize = map->buckets * 2, i;
+
+	newtab = xcalloc(newsize, sizeof(*newtab));
+
+	for (i = 0; i < map->buckets; i++) {
+		for (entry = map->table[i]; entry; entry = next) {
+			next = entry->next;
+			entry->next = newtab[entry->hash & (newsize - 1)];
+			newtab[entry->hash & (newsize - 1)] = entry;
+		}
+	}
+
+	free(map->table);
+	map->table = newtab;
+	map->buckets = newsize;
+}
+
+strmap_t *strmap_create(int flags)
+{
+	strmap_t	*map = xcalloc(1, sizeof(*map));
+
+	map->flags = flags;
+	map->buckets = 16;
+	map->table = xcalloc(map->buckets, sizeof(*map->table));
+
+	return map;
+}
+
+void strmap_destroy(strmap_t *map, void (*freeval)(void *value))
+{
+	strmap_entry_t	*entry, *next;
+	size_t	i;
+
+	if (!map) {
+		return;
+	}
+
+	for (i = 0; i < map->buckets; i++) {
+		for (entry = map->table[i]; entry; entry = next) {
+			next = entry->next;
+
+			if (freeval) {
+				freeval(entry->value);
+			}
+
+			free(entry->key);
+			free(entry);
+		}
+	}
+
+	free(map->table);
+	free(map);
+}
+
+void *strmap_put(strmap_t *map, const char *key, void *value)
+{
+	size_t	hash = strmap_hash(map, key);
+	strmap_entry_t	**eptr = strmap_find(map, key, hash), *entry;
+	void	*old;
+
+	if (*eptr) {
+		old = (*eptr)->value;
+		(*eptr)->value = value;
+		return old;
+	}
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->key = xstrdup(key);
+	entry->value = value;
+	entry->hash = hash;
+	*eptr = entry;
+
+	if (++map->count > map->buckets) {
+		strmap_grow(map);
+	}
+
+	return NULL;
+}
+
+void *strmap_get(const strmap_t *map, const char *key)
+{
+	strmap_entry_t	*entry;
+
+	if (!map || !key) {
+		return NULL;
+	}
+
+	entry = *strmap_find(map, key, strmap_hash(map, key));
+
+	return entry ? entry->value : NULL;
+}
+
+void *strmap_del(strmap_t *map, const char *key)
+{
+	strmap_entry_t	**eptr, *entry;
+	void	*value;
+
+	if (!map || !key) {
+		return NULL;
+	}
+
+	eptr = strmap_find(map, key, strmap_hash(map, key));
+	entry = *eptr;
+
+	if (!entry) {
+		return NULL;
+	}
+
+	*eptr = entry->next;
+	value = entry->value;
+
+	free(entry->key);
+	free(entry);
+	map->count--;
+
+	return value;
+}
+
+size_t strmap_count(const strmap_t *map)
+{
+	return map ? map->count : 0;
+}
@@ -174,12 +174,16 @@ main() {
     
     local current_fingerprint=""
     local previous_fingerprint="__initial__"
+    local configured_driver="none"
+    local configured_fingerprint="none"
     
     # Initial setup
     current_fingerprint=$(get_ups_fingerprint)
     log "Initial device fingerprint: $current_fingerprint"
     
     if create_ups_conf "$current_fingerprint"; then
+        configured_driver="usbhid-ups"
+        configured_fingerprint="$current_fingerprint"
         start_nut_services
     else
         log "No UPS detected initially - waiting for device"
@@ -198,14 +202,31 @@ main() {
             log "Previous: $previous_fingerprint"
             log "Current:  $current_fingerprint"
             
+            # A running usbhid-ups driver gets libusb hotplug notifications:
+            # it marks the data stale when its UPS is unplugged, and picks it
+            # up again as soon as the same UPS is plugged back in. It only
+            # reconnects to the device it was started with, so restart when
+            # a different set of devices shows up
+            if [[ "$configured_driver" == "usbhid-ups" ]] \
+            && [[ "$current_fingerprint" == "none" || "$current_fingerprint" == "$configured_fingerprint" ]] \
+            && pgrep -f "usbhid-ups" > /dev/null 2>&1; then
+                log "usbhid-ups driver is running and follows the change itself"
+                previous_fingerprint="$current_fingerprint"
+                continue
+            fi
+            
             # Stop everything
             stop_all_services
             
             # Reconfigure and restart
             if create_ups_conf "$current_fingerprint"; then
+                configured_driver="usbhid-ups"
+                configured_fingerprint="$current_fingerprint"
                 start_nut_services
                 log "System reconfigured successfully"
             else
+                configured_driver="none"
+                configured_fingerprint="none"
                 log "No UPS detected - waiting for connection"
             fi
             
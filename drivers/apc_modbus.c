@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include <modbus.h>
+#include "modbus_bus.h"
 
 #if defined NUT_MODBUS_HAS_USB
 # define DRIVER_NAME_NUT_MODBUS_HAS_USB_WITH_STR	"with"
@@ -44,7 +45,7 @@
 #endif
 
 #define DRIVER_NAME	"NUT APC Modbus driver " DRIVER_NAME_NUT_MODBUS_HAS_USB_WITH_STR " USB support (libmodbus link type: " NUT_MODBUS_LINKTYPE_STR ")"
-#define DRIVER_VERSION	"0.16"
+#define DRIVER_VERSION	"0.17"
 
 #if defined NUT_MODBUS_HAS_USB
 
@@ -86,6 +87,7 @@ static USBDeviceMatcher_t *best_matcher = NULL;
 static int is_usb = 0;
 #endif /* defined NUT_MODBUS_HAS_USB */
 static int is_open = 0;
+static int serial_baudrate = 0;	/* of a "serial" port, whose line may be shared */
 static double power_nominal;
 static double realpower_nominal;
 static int64_t last_send_time = 0;
@@ -947,6 +949,10 @@ static int _apc_modbus_reopen(void)
 	_apc_modbus_create_reopen_matcher();
 #endif /* defined NUT_MODBUS_HAS_USB */
 
+	if (serial_baudrate > 0) {
+		modbus_bus_init(modbus_ctx, device_path, serial_baudrate);
+	}
+
 	usleep(1000000);
 	modbus_flush(modbus_ctx);
 
@@ -1034,9 +1040,14 @@ static void _apc_modbus_handle_error(modbus_t *ctx)
 
 static int _apc_modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
 {
+	int r;
+
+	modbus_bus_lock(ctx);
 	_apc_modbus_interframe_delay();
+	r = modbus_read_registers(ctx, addr, nb, dest);
+	modbus_bus_unlock(ctx);
 
-	if (modbus_read_registers(ctx, addr, nb, dest) > 0) {
+	if (r > 0) {
 		_apc_modbus_interframe_delay_reset();
 		return 1;
 	} else {
@@ -1307,7 +1318,10 @@ static int _apc_modbus_setvar(const char *nut_varname, const char *str_value)
 
 	addr = apc_value->modbus_addr;
 	nb = apc_value->modbus_len;
-	if (modbus_write_registers(modbus_ctx, addr, nb, reg_value) < 0) {
+	modbus_bus_lock(modbus_ctx);
+	r = modbus_write_registers(modbus_ctx, addr, nb, reg_value);
+	modbus_bus_unlock(modbus_ctx);
+	if (r < 0) {
 		upslogx(LOG_ERR, "%s: Write of %d:%d failed: %s (%s)", __func__, addr, addr + nb, modbus_strerror(errno), device_path);
 		_apc_modbus_handle_error(modbus_ctx);
 		return STAT_SET_FAILED;
@@ -1397,7 +1411,7 @@ static apc_modbus_command_t apc_modbus_command_map[] = {
 static int _apc_modbus_instcmd(const char *nut_cmdname, const char *extra)
 {
 	size_t i;
-	int addr, nb;
+	int addr, nb, r;
 	apc_modbus_command_t *apc_command = NULL;
 	uint16_t value[4]; /* Max 64-bit */
 
@@ -1427,7 +1441,10 @@ static int _apc_modbus_instcmd(const char *nut_cmdname, const char *extra)
 	addr = apc_command->modbus_addr;
 	nb = apc_command->modbus_len;
 	upslog_INSTCMD_POWERSTATE_CHECKED(nut_cmdname, extra);
-	if (modbus_write_registers(modbus_ctx, addr, nb, value) < 0) {
+	modbus_bus_lock(modbus_ctx);
+	r = modbus_write_registers(modbus_ctx, addr, nb, value);
+	modbus_bus_unlock(modbus_ctx);
+	if (r < 0) {
 		upslogx(LOG_INSTCMD_FAILED, "%s: Write of %d:%d failed: %s (%s)", __func__, addr, addr + nb, modbus_strerror(errno), device_path);
 		_apc_modbus_handle_error(modbus_ctx);
 		return STAT_INSTCMD_FAILED;
@@ -1917,6 +1934,7 @@ void upsdrv_initups(void)
 		val = getval("stopbits");
 		rtu_stopbits = val ? atoi(val) : modbus_rtu_default_stopbits;
 
+		serial_baudrate = rtu_baudrate;
 		modbus_ctx = modbus_new_rtu(device_path, rtu_baudrate, rtu_parity, rtu_databits, rtu_stopbits);
 	}
 
@@ -1963,6 +1981,11 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 	}
 
+	/* share a serial RS-485 line with drivers of other slaves */
+	if (serial_baudrate > 0) {
+		modbus_bus_init(modbus_ctx, device_path, serial_baudrate);
+	}
+
 #if defined NUT_MODBUS_HAS_USB
 	/* This creates an exact matcher after the first connection so that on
 	 * reconnect we are more likely to match the exact device we connected to
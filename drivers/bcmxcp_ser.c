@@ -98,7 +98,7 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 
 		do {
 			/* Read PW_COMMAND_START_BYTE byte */
-			res = ser_get_char(upsfd, my_buf, 1, 0);
+			res = ser_rbuf_get_char(upsfd, my_buf, 1, 0);
 
 			if (res != 1) {
 				upsdebugx(1,
@@ -117,7 +117,7 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 		}
 
 		/* Read block number byte */
-		res = ser_get_char(upsfd, my_buf + 1, 1, 0);
+		res = ser_rbuf_get_char(upsfd, my_buf + 1, 1, 0);
 
 		if (res != 1) {
 			ser_comm_fail("Receive error (Block number): %" PRIiSIZE "!!!\n", res);
@@ -146,7 +146,7 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 		}
 
 		/* Read data length byte */
-		res = ser_get_char(upsfd, my_buf + 2, 1, 0);
+		res = ser_rbuf_get_char(upsfd, my_buf + 2, 1, 0);
 
 		if (res != 1) {
 			ser_comm_fail("Receive error (length): %" PRIiSIZE "!!!\n", res);
@@ -161,7 +161,7 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 		}
 
 		/* Read sequence byte */
-		res = ser_get_char(upsfd, my_buf + 3, 1, 0);
+		res = ser_rbuf_get_char(upsfd, my_buf + 3, 1, 0);
 
 		if (res != 1) {
 			ser_comm_fail("Receive error (sequence): %" PRIiSIZE "!!!\n", res);
@@ -182,9 +182,9 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 		pre_sequence = sequence;
 
 		/* Try to read all the remaining bytes */
-		res = ser_get_buf_len(upsfd, my_buf + 4, length, 1, 0);
+		res = ser_rbuf_get_buf_len(upsfd, my_buf + 4, length, 1, 0);
 		if (res < 0) {
-			ser_comm_fail("%s(): ser_get_buf_len() returned error code %" PRIiSIZE, __func__, res);
+			ser_comm_fail("%s(): ser_rbuf_get_buf_len() returned error code %" PRIiSIZE, __func__, res);
 			return res;
 		}
 
@@ -194,7 +194,7 @@ ssize_t get_answer(unsigned char *data, unsigned char command)
 		}
 
 		/* Get the checksum byte */
-		res = ser_get_char(upsfd, my_buf + (4 + length), 1, 0);
+		res = ser_rbuf_get_char(upsfd, my_buf + (4 + length), 1, 0);
 
 		if (res != 1) {
 			ser_comm_fail("Receive error (checksum): %" PRIiSIZE "!!!\n", res);
@@ -43,6 +43,7 @@
 #include "parseconf.h"
 #include "attribute.h"
 #include "nut_stdint.h"
+#include "dsproto.h"
 
 	static TYPE_FD	sockfd = ERROR_FD;
 #ifndef WIN32
@@ -59,6 +60,34 @@
 	static st_tree_t	*dtree_root = NULL;
 	static cmdlist_t	*cmdhead = NULL;
 
+	/* broadcasts collected between dstate_batch_begin() and _commit() */
+	static int	batch_depth = 0;
+	static char	*batch_buf = NULL, *batch_bin = NULL;
+	static size_t	batch_len = 0, batch_size = 0,
+			batch_binlen = 0, batch_binsize = 0,
+			batch_polled = 0, batch_changed = 0;
+
+	/* driver.stats.* counters are published at most every stats_interval
+	 * seconds (0 = never), all of them during the same poll cycle */
+	static time_t	stats_interval = 0, stats_last = 0;
+	static int	stats_open = 0;
+
+	/* binary protocol (see dsproto.h): connections which asked for
+	 * it, and the next variable id to hand out */
+	static size_t	binary_conns = 0;
+	static unsigned int	next_var_id = 1;
+
+#ifndef WIN32
+	/* more descriptors for dstate_poll_fds() to watch for the driver */
+	static struct {
+		int	fd;
+		int	for_write;
+		dstate_fd_handler_t	handler;
+		void	*arg;
+	}	watched_fds[DSTATE_MAX_WATCHED_FDS];
+	static size_t	watched_count = 0;
+#endif	/* !WIN32 */
+
 	struct ups_handler	upsh;
 
 #ifndef WIN32
@@ -245,6 +274,9 @@ static void sock_disconnect(conn_t *conn)
 	upsdebugx(5, "%s: finishing parsing context", __func__);
 	pconf_finish(&conn->ctx);
 
+	if (conn->binary)
+		binary_conns--;
+
 	upsdebugx(5, "%s: relinking the chain of connections", __func__);
 	if (conn->prev) {
 		conn->prev->next = conn->next;
@@ -262,83 +294,57 @@ static void sock_disconnect(conn_t *conn)
 	free(conn);
 }
 
-static void send_to_all(const char *fmt, ...)
+/* write buf to all connections which did not opt out of broadcasts
+ * and which use the text (binary == 0) or binary protocol;
+ * a batch may exceed the socket buffer, so partial writes are resumed
+ * after a short throttle-down for upsd to read the data */
+static void send_buf_to_all(const char *buf, size_t buflen, int binary)
 {
-	ssize_t	ret;
-	char	buf[ST_SOCK_BUF_LEN];
-	size_t	buflen;
-	va_list	ap;
+	ssize_t	ret = 0;
 	conn_t	*conn, *cnext;
 
-	va_start(ap, fmt);
-#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
-#pragma GCC diagnostic push
-#endif
-#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
-#pragma GCC diagnostic ignored "-Wformat-nonliteral"
-#endif
-#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_SECURITY
-#pragma GCC diagnostic ignored "-Wformat-security"
-#endif
-	/* Note: this code intentionally uses a caller-provided
-	 * format string (we should not get it from configs etc.
-	 * or the calling methods should check it against their
-	 * "fmt_dynamic" expectations). */
-	ret = vsnprintf(buf, sizeof(buf), fmt, ap);
-#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
-#pragma GCC diagnostic pop
-#endif
-	va_end(ap);
-
-	if (ret < 1) {
-		upsdebugx(2, "%s: nothing to write", __func__);
-		return;
-	}
-
-	if (ret <= INT_MAX)
-		upsdebugx(5, "%s: %.*s", __func__, (int)(ret-1), buf);
-
-	buflen = strlen(buf);
-	if (buflen >= SSIZE_MAX) {
-		/* Can't compare buflen to ret... though should not happen with ST_SOCK_BUF_LEN */
-		upslog_with_errno(LOG_NOTICE, "%s failed: buffered message too large", __func__);
-		return;
-	}
-
 	for (conn = connhead; conn; conn = cnext) {
+		size_t	sent = 0;
+		int	retries = 0;
+
 		cnext = conn->next;
-		if (conn->nobroadcast)
+		if (conn->nobroadcast || conn->binary != binary)
 			continue;
 
+		while (sent < buflen) {
 #ifndef WIN32
-		ret = write(conn->fd, buf, buflen);
+			ret = write(conn->fd, buf + sent, buflen - sent);
 #else	/* WIN32 */
-		DWORD bytesWritten = 0;
-		BOOL  result = FALSE;
+			DWORD bytesWritten = 0;
+			BOOL  result = FALSE;
 
-		result = WriteFile (conn->fd, buf, buflen, &bytesWritten, NULL);
-		if( result == 0 ) {
-			upsdebugx(2, "%s: write failed on handle %p, disconnecting", __func__, conn->fd);
-			sock_disconnect(conn);
-			continue;
-		}
-		else  {
-			ret = (ssize_t)bytesWritten;
-		}
+			result = WriteFile (conn->fd, buf + sent, buflen - sent, &bytesWritten, NULL);
+			ret = result ? (ssize_t)bytesWritten : -1;
 #endif	/* WIN32 */
 
-		if ((ret < 1) || (ret != (ssize_t)buflen)) {
+			if (ret > 0) {
+				sent += (size_t)ret;
+				continue;
+			}
+
+			if (ret < 0 && errno == EAGAIN && retries++ < DSTATE_WRITE_RETRIES) {
+				usleep(200);
+				continue;
+			}
+
+			break;
+		}
+
+		if (sent != buflen) {
 #ifndef WIN32
 			upsdebug_with_errno(0, "WARNING: %s: write %" PRIuSIZE " bytes to "
 				"socket %d failed (ret=%" PRIiSIZE "), disconnecting.",
-				__func__, buflen, (int)conn->fd, ret);
+				__func__, buflen - sent, (int)conn->fd, ret);
 #else	/* WIN32 */
 			upsdebug_with_errno(0, "WARNING: %s: write %" PRIuSIZE " bytes to "
 				"handle %p failed (ret=%" PRIiSIZE "), disconnecting.",
-				__func__, buflen, conn->fd, ret);
+				__func__, buflen - sent, conn->fd, ret);
 #endif	/* WIN32 */
-			upsdebugx(6, "%s: failed write: %s", __func__, buf);
-
 			sock_disconnect(conn);
 
 			/* TOTHINK: Maybe fallback elsewhere in other cases? */
@@ -352,23 +358,48 @@ static void send_to_all(const char *fmt, ...)
 			dstate_setinfo("driver.parameter.synchronous", "%s",
 				(do_synchronous==1)?"yes":((do_synchronous==0)?"no":"auto"));
 		} else {
-			upsdebugx(6, "%s: write %" PRIuSIZE " bytes to socket %d succeeded "
-				"(ret=%" PRIiSIZE "): %s",
-				__func__, buflen, conn->fd, ret, buf);
+			upsdebugx(6, "%s: write %" PRIuSIZE " bytes to socket %d succeeded",
+				__func__, buflen, (int)conn->fd);
 		}
 	}
 }
 
-static int send_to_one(conn_t *conn, const char *fmt, ...)
+static void buf_append(char **buf, size_t *len, size_t *size, const char *data, size_t datalen)
+{
+	if (*len + datalen + 1 > *size) {
+		while (*len + datalen + 1 > *size) {
+			*size = *size ? *size * 2 : LARGEBUF;
+		}
+		*buf = xrealloc(*buf, *size);
+	}
+
+	memcpy(*buf + *len, data, datalen);
+	*len += datalen;
+	(*buf)[*len] = '\0';
+}
+
+/* send the same update in the text and in the binary protocol (if
+ * binlen > 0), or collect it for a single write in dstate_batch_commit() */
+static void broadcast(const char *text, size_t textlen, const char *bin, size_t binlen)
+{
+	if (batch_depth > 0) {
+		buf_append(&batch_buf, &batch_len, &batch_size, text, textlen);
+		if (binlen > 0)
+			buf_append(&batch_bin, &batch_binlen, &batch_binsize, bin, binlen);
+		return;
+	}
+
+	send_buf_to_all(text, textlen, 0);
+	if (binlen > 0)
+		send_buf_to_all(bin, binlen, 1);
+}
+
+static void send_to_all(const char *fmt, ...)
 {
 	ssize_t	ret;
-	va_list	ap;
 	char	buf[ST_SOCK_BUF_LEN];
 	size_t	buflen;
-#ifdef WIN32
-	DWORD bytesWritten = 0;
-	BOOL  result = FALSE;
-#endif	/* WIN32 */
+	va_list	ap;
 
 	va_start(ap, fmt);
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
@@ -390,26 +421,43 @@ static int send_to_one(conn_t *conn, const char *fmt, ...)
 #endif
 	va_end(ap);
 
-	upsdebugx(2, "%s: sending %.*s", __func__, (int)strcspn(buf, "\n"), buf);
 	if (ret < 1) {
 		upsdebugx(2, "%s: nothing to write", __func__);
-		return 1;
+		return;
 	}
 
+	if (ret <= INT_MAX)
+		upsdebugx(5, "%s: %.*s", __func__, (int)(ret-1), buf);
+
 	buflen = strlen(buf);
 	if (buflen >= SSIZE_MAX) {
 		/* Can't compare buflen to ret... though should not happen with ST_SOCK_BUF_LEN */
 		upslog_with_errno(LOG_NOTICE, "%s failed: buffered message too large", __func__);
-		return 0;	/* failed */
+		return;
 	}
 
-	if (ret <= INT_MAX)
-		upsdebugx(5, "%s: %.*s", __func__, (int)(ret-1), buf);
+	/* binary connections get the line as is inside a record */
+	if (binary_conns > 0) {
+		char	frame[DSPROTO_HEADER_LEN + ST_SOCK_BUF_LEN];
+		size_t	framelen = dsproto_encode(frame, sizeof(frame), DSPROTO_OP_TEXT, 0,
+			buf, (buf[buflen - 1] == '\n') ? buflen - 1 : buflen);
 
-/*
-	upsdebugx(0, "%s: writing %" PRIiSIZE " bytes to socket %d: %s",
-		__func__, buflen, conn->fd, buf);
-*/
+		broadcast(buf, buflen, frame, framelen);
+		return;
+	}
+
+	broadcast(buf, buflen, NULL, 0);
+}
+
+/* write buf to one connection, with a throttle-down and retry if the
+ * socket is full; disconnects it on failure */
+static int send_buf_to_one(conn_t *conn, const char *buf, size_t buflen)
+{
+	ssize_t	ret;
+#ifdef WIN32
+	DWORD bytesWritten = 0;
+	BOOL  result = FALSE;
+#endif	/* WIN32 */
 
 #ifndef WIN32
 	ret = write(conn->fd, buf, buflen);
@@ -427,12 +475,12 @@ static int send_to_one(conn_t *conn, const char *fmt, ...)
 		/* Hacky bugfix: throttle down for upsd to read that */
 #ifndef WIN32
 		upsdebug_with_errno(1, "%s: had to throttle down to retry "
-			"writing %" PRIuSIZE " bytes to socket %d (ret=%" PRIiSIZE ") : %s",
-			__func__, buflen, (int)conn->fd, ret, buf);
+			"writing %" PRIuSIZE " bytes to socket %d (ret=%" PRIiSIZE ")",
+			__func__, buflen, (int)conn->fd, ret);
 #else	/* WIN32 */
 		upsdebug_with_errno(1, "%s: had to throttle down to retry "
-			"writing %" PRIuSIZE " bytes to handle %p (ret=%" PRIiSIZE ") : %s",
-			__func__, buflen, conn->fd, ret, buf);
+			"writing %" PRIuSIZE " bytes to handle %p (ret=%" PRIiSIZE ")",
+			__func__, buflen, conn->fd, ret);
 #endif	/* WIN32 */
 
 		usleep(200);
@@ -463,7 +511,6 @@ static int send_to_one(conn_t *conn, const char *fmt, ...)
 			"handle %p failed (ret=%" PRIiSIZE "), disconnecting.",
 			__func__, buflen, conn->fd, ret);
 #endif	/* WIN32 */
-		upsdebugx(6, "%s: failed write: %s", __func__, buf);
 		sock_disconnect(conn);
 
 		/* TOTHINK: Maybe fallback elsewhere in other cases? */
@@ -481,18 +528,162 @@ static int send_to_one(conn_t *conn, const char *fmt, ...)
 	} else {
 #ifndef WIN32
 		upsdebugx(6, "%s: write %" PRIuSIZE " bytes to socket %d succeeded "
-			"(ret=%" PRIiSIZE "): %s",
-			__func__, buflen, conn->fd, ret, buf);
+			"(ret=%" PRIiSIZE ")",
+			__func__, buflen, (int)conn->fd, ret);
 #else	/* WIN32 */
 		upsdebugx(6, "%s: write %" PRIuSIZE " bytes to handle %p succeeded "
-			"(ret=%" PRIiSIZE "): %s",
-			__func__, buflen, conn->fd, ret, buf);
+			"(ret=%" PRIiSIZE ")",
+			__func__, buflen, conn->fd, ret);
 #endif	/* WIN32 */
 	}
 
 	return 1;	/* OK */
 }
 
+static int send_to_one(conn_t *conn, const char *fmt, ...)
+{
+	ssize_t	ret;
+	va_list	ap;
+	char	buf[ST_SOCK_BUF_LEN];
+	size_t	buflen;
+
+	va_start(ap, fmt);
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic push
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_SECURITY
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+	/* Note: this code intentionally uses a caller-provided
+	 * format string (we should not get it from configs etc.
+	 * or the calling methods should check it against their
+	 * "fmt_dynamic" expectations). */
+	ret = vsnprintf(buf, sizeof(buf), fmt, ap);
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic pop
+#endif
+	va_end(ap);
+
+	upsdebugx(2, "%s: sending %.*s", __func__, (int)strcspn(buf, "\n"), buf);
+	if (ret < 1) {
+		upsdebugx(2, "%s: nothing to write", __func__);
+		return 1;
+	}
+
+	buflen = strlen(buf);
+	if (buflen >= SSIZE_MAX) {
+		/* Can't compare buflen to ret... though should not happen with ST_SOCK_BUF_LEN */
+		upslog_with_errno(LOG_NOTICE, "%s failed: buffered message too large", __func__);
+		return 0;	/* failed */
+	}
+
+	if (ret <= INT_MAX)
+		upsdebugx(5, "%s: %.*s", __func__, (int)(ret-1), buf);
+
+	/* the line goes as is inside a record on binary connections */
+	if (conn->binary) {
+		char	frame[DSPROTO_HEADER_LEN + ST_SOCK_BUF_LEN];
+		size_t	framelen = dsproto_encode(frame, sizeof(frame), DSPROTO_OP_TEXT, 0,
+			buf, (buf[buflen - 1] == '\n') ? buflen - 1 : buflen);
+
+		return send_buf_to_one(conn, frame, framelen);
+	}
+
+	return send_buf_to_one(conn, buf, buflen);
+}
+
+/* assign a variable id for the binary protocol, if not done yet;
+ * returns 0 when the ids are exhausted (use text records then) */
+static unsigned int dstate_var_id(st_tree_t *node, int *is_new)
+{
+	*is_new = 0;
+
+	if (!node->id && next_var_id <= DSPROTO_MAX_ID) {
+		node->id = next_var_id++;
+		*is_new = 1;
+	}
+
+	return node->id;
+}
+
+/* binary records for the current value of node, preceded by the
+ * definition of its id if requested; returns 0 if it does not fit */
+static size_t encode_setinfo(char *buf, size_t bufsize, const st_tree_t *node, int define)
+{
+	size_t	len = 0, ret;
+
+	if (define) {
+		len = dsproto_encode(buf, bufsize, DSPROTO_OP_DEFINE, node->id,
+			node->var, strlen(node->var));
+		if (!len)
+			return 0;
+	}
+
+	ret = dsproto_encode(buf + len, bufsize - len, DSPROTO_OP_SETINFO, node->id,
+		node->raw, strlen(node->raw));
+	if (!ret)
+		return 0;
+
+	return len + ret;
+}
+
+/* report the value of node to one connection, e.g. during DUMPALL */
+static int send_setinfo_to_one(conn_t *conn, st_tree_t *node)
+{
+	if (conn->binary) {
+		char	frame[2 * DSPROTO_HEADER_LEN + ST_SOCK_BUF_LEN + ST_MAX_VALUE_LEN];
+		size_t	framelen;
+		int	is_new;
+
+		/* always (re)define ids in dumps: this connection may have
+		 * missed the broadcast definition, e.g. with NOBROADCAST */
+		if (dstate_var_id(node, &is_new)
+		 && (framelen = encode_setinfo(frame, sizeof(frame), node, 1)) > 0
+		) {
+			upsdebugx(5, "%s: SETINFO %s [id %u]", __func__, node->var, node->id);
+			return send_buf_to_one(conn, frame, framelen);
+		}
+	}
+
+	return send_to_one(conn, "SETINFO %s \"%s\"\n", node->var, node->val);
+}
+
+/* broadcast a changed value of var; binary connections get it as
+ * a SETINFO record, preceded by the definition of a newly assigned id */
+static void send_setinfo_to_all(const char *var, const char *value)
+{
+	char	buf[ST_SOCK_BUF_LEN], frame[2 * DSPROTO_HEADER_LEN + ST_SOCK_BUF_LEN + ST_MAX_VALUE_LEN];
+	size_t	framelen = 0;
+	int	ret, is_new;
+	st_tree_t	*node;
+
+	if (binary_conns == 0) {
+		send_to_all("SETINFO %s \"%s\"\n", var, value);
+		return;
+	}
+
+	node = state_tree_find(dtree_root, var);
+	if (!node || !dstate_var_id(node, &is_new)
+	 || !(framelen = encode_setinfo(frame, sizeof(frame), node, is_new))
+	) {
+		/* no id to use: fall back to a text record */
+		send_to_all("SETINFO %s \"%s\"\n", var, value);
+		return;
+	}
+
+	ret = snprintf(buf, sizeof(buf), "SETINFO %s \"%s\"\n", var, value);
+	if (ret < 1 || (size_t)ret >= sizeof(buf)) {
+		upslogx(LOG_NOTICE, "%s failed: buffered message too large", __func__);
+		return;
+	}
+
+	upsdebugx(5, "%s: %.*s [id %u]", __func__, ret - 1, buf, node->id);
+	broadcast(buf, (size_t)ret, frame, framelen);
+}
+
 static void sock_connect(TYPE_FD sock)
 {
 	conn_t	*conn;
@@ -630,7 +821,7 @@ static int st_tree_dump_conn_one_node(st_tree_t *node, conn_t *conn)
 	enum_t	*etmp;
 	range_t	*rtmp;
 
-	if (!send_to_one(conn, "SETINFO %s \"%s\"\n", node->var, node->val)) {
+	if (!send_setinfo_to_one(conn, node)) {
 		return 0;	/* write failed, bail out */
 	}
 
@@ -754,6 +945,23 @@ static int sock_arg(conn_t *conn, size_t numarg, char **arg)
 		return 2;
 	}
 
+	/* switch this connection to binary records (see dsproto.h):
+	 * the reply is the last text line it gets */
+	if (!strcasecmp(arg[0], "PROTOCOL") && numarg > 1) {
+		if (strcasecmp(arg[1], "BINARY")) {
+			upsdebugx(1, "%s: unsupported protocol %s", __func__, arg[1]);
+			return 0;
+		}
+
+		if (!conn->binary) {
+			if (!send_to_one(conn, DSPROTO_HANDSHAKE "\n"))
+				return 1;	/* conn is gone */
+			conn->binary = 1;
+			binary_conns++;
+		}
+		return 1;
+	}
+
 	if (!strcasecmp(arg[0], "GETPID")) {
 		send_to_one(conn, "PID %" PRIiMAX "\n", (intmax_t)getpid());
 		return 1;
@@ -1155,7 +1363,8 @@ char * dstate_init(const char *prog, const char *devname)
 	return xstrdup(sockname);
 }
 
-/* returns 1 if timeout expired or data is available on UPS fd, 0 otherwise */
+/* returns 1 if timeout expired, data is available on UPS fd or the
+ * handler of a watched fd asked to wake up the caller, 0 otherwise */
 int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 {
 	int	maxfd = 0; /* Unidiomatic use vs. "sockfd" below, which is "int" on non-WIN32 */
@@ -1164,13 +1373,27 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 	struct timeval	now;
 
 #ifndef WIN32
-	int	ret;
-	fd_set	rfds;
+	int	ret, wake = 0;
+	fd_set	rfds, wfds;
+
+	size_t	i;
 
 	FD_ZERO(&rfds);
-	FD_SET(sockfd, &rfds);
+	FD_ZERO(&wfds);
+
+	if (VALID_FD(sockfd)) {
+		FD_SET(sockfd, &rfds);
+		maxfd = sockfd;
+	}
 
-	maxfd = sockfd;
+	for (i = 0; i < watched_count; i++) {
+		FD_SET(watched_fds[i].fd,
+			watched_fds[i].for_write ? &wfds : &rfds);
+
+		if (watched_fds[i].fd > maxfd) {
+			maxfd = watched_fds[i].fd;
+		}
+	}
 
 	if (VALID_FD(arg_extrafd)) {
 		FD_SET(arg_extrafd, &rfds);
@@ -1205,7 +1428,7 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		timeout.tv_usec -= now.tv_usec;
 	}
 
-	ret = select(maxfd + 1, &rfds, NULL, NULL, &timeout);
+	ret = select(maxfd + 1, &rfds, watched_count ? &wfds : NULL, NULL, &timeout);
 
 	if (ret == 0) {
 		return 1;	/* timer expired */
@@ -1226,10 +1449,25 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		return overrun;
 	}
 
-	if (FD_ISSET(sockfd, &rfds)) {
+	if (VALID_FD(sockfd) && FD_ISSET(sockfd, &rfds)) {
 		sock_connect(sockfd);
 	}
 
+	/* handlers may unwatch descriptors, so look each one up again */
+	for (i = 0; i < watched_count; i++) {
+		fd_set	*set = watched_fds[i].for_write ? &wfds : &rfds;
+
+		if (FD_ISSET(watched_fds[i].fd, set)) {
+			int	fd = watched_fds[i].fd;
+
+			FD_CLR(fd, set);
+			if (watched_fds[i].handler(fd, watched_fds[i].arg)) {
+				wake = 1;
+			}
+			i = (size_t)-1;	/* restart: the list may have changed */
+		}
+	}
+
 	for (conn = connhead; conn; conn = cnext) {
 		cnext = conn->next;
 
@@ -1246,7 +1484,11 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
 		}
 	}
 
-	/* tell the caller if that fd woke up */
+	/* tell the caller if a handler or that fd woke up */
+	if (wake) {
+		return 1;
+	}
+
 	if (VALID_FD(arg_extrafd) && (FD_ISSET(arg_extrafd, &rfds))) {
 		return 1;
 	}
@@ -1350,6 +1592,65 @@ int dstate_poll_fds(struct timeval timeout, TYPE_FD arg_extrafd)
  * COMMON
  ******************************************************************/
 
+int dstate_watch_fd(TYPE_FD fd, int for_write, dstate_fd_handler_t handler, void *arg)
+{
+#ifndef WIN32
+	size_t	i;
+
+	if (INVALID_FD(fd) || !handler) {
+		return -1;
+	}
+
+	for (i = 0; i < watched_count; i++) {
+		if (watched_fds[i].fd == fd) {
+			break;
+		}
+	}
+
+	if (i == watched_count) {
+		if (watched_count >= DSTATE_MAX_WATCHED_FDS) {
+			upslogx(LOG_ERR, "%s: too many descriptors to watch", __func__);
+			return -1;
+		}
+		watched_count++;
+	}
+
+	watched_fds[i].fd = fd;
+	watched_fds[i].for_write = for_write;
+	watched_fds[i].handler = handler;
+	watched_fds[i].arg = arg;
+
+	upsdebugx(3, "%s: watching fd %d (for %s)", __func__, fd,
+		for_write ? "writing" : "reading");
+	return 0;
+#else	/* WIN32 */
+	NUT_UNUSED_VARIABLE(fd);
+	NUT_UNUSED_VARIABLE(for_write);
+	NUT_UNUSED_VARIABLE(handler);
+	NUT_UNUSED_VARIABLE(arg);
+
+	/* FIXME: WaitForMultipleObjects() wants HANDLEs, not descriptors */
+	return -1;
+#endif	/* WIN32 */
+}
+
+void dstate_unwatch_fd(TYPE_FD fd)
+{
+#ifndef WIN32
+	size_t	i;
+
+	for (i = 0; i < watched_count; i++) {
+		if (watched_fds[i].fd == fd) {
+			watched_fds[i] = watched_fds[--watched_count];
+			upsdebugx(3, "%s: no longer watching fd %d", __func__, fd);
+			return;
+		}
+	}
+#else	/* WIN32 */
+	NUT_UNUSED_VARIABLE(fd);
+#endif	/* WIN32 */
+}
+
 int vdstate_setinfo(const char *var, const char *fmt, va_list ap)
 {
 	int	ret;
@@ -1377,9 +1678,74 @@ int vdstate_setinfo(const char *var, const char *fmt, va_list ap)
 	ret = state_setinfo(&dtree_root, var, value);
 
 	if (ret == 1) {
-		send_to_all("SETINFO %s \"%s\"\n", var, value);
+		send_setinfo_to_all(var, value);
+	}
+
+	if (batch_depth > 0) {
+		batch_polled++;
+		if (ret == 1)
+			batch_changed++;
+	}
+
+	return ret;
+}
+
+void dstate_setstatsinterval(time_t interval)
+{
+	if (interval != stats_interval) {
+		upsdebugx(1, "%s: driver.stats.* %s", __func__,
+			interval > 0 ? "published" : "not published");
 	}
 
+	stats_interval = interval;
+	stats_last = 0;
+}
+
+int dstate_stats_due(void)
+{
+	time_t	now;
+
+	if (stats_interval <= 0)
+		return 0;
+
+	if (stats_open)
+		return 1;
+
+	time(&now);
+	if (stats_last && now >= stats_last && now - stats_last < stats_interval)
+		return 0;
+
+	/* open until the end of this poll cycle (dstate_batch_commit()) */
+	stats_last = now;
+	stats_open = 1;
+
+	return 1;
+}
+
+int dstate_setstat(const char *var, const char *fmt, ...)
+{
+	int	ret;
+	va_list	ap;
+
+	if (!dstate_stats_due())
+		return 0;
+
+	va_start(ap, fmt);
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic push
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_SECURITY
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+	ret = vdstate_setinfo(var, fmt, ap);
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic pop
+#endif
+	va_end(ap);
+
 	return ret;
 }
 
@@ -1735,14 +2101,77 @@ int dstate_delcmd(const char *cmd)
 	return ret;
 }
 
+void dstate_batch_begin(void)
+{
+	if (batch_depth++ > 0)
+		return;
+
+	batch_len = 0;
+	batch_binlen = 0;
+	batch_polled = 0;
+	batch_changed = 0;
+}
+
+void dstate_batch_commit(void)
+{
+	size_t	polled = batch_polled, changed = batch_changed,
+		bytes = batch_len + batch_binlen;
+
+	if (batch_depth < 1) {
+		upsdebugx(1, "%s: no batch was started", __func__);
+		return;
+	}
+
+	if (batch_depth > 1) {
+		batch_depth--;
+		return;
+	}
+
+	upsdebugx(5, "%s: %" PRIuSIZE " of %" PRIuSIZE " variables changed, "
+		"broadcasting %" PRIuSIZE " bytes",
+		__func__, changed, polled, bytes);
+
+	/* these go out with this batch, but are not counted in it */
+	dstate_setstat("driver.stats.vars.polled", "%" PRIuSIZE, polled);
+	dstate_setstat("driver.stats.vars.changed", "%" PRIuSIZE, changed);
+	dstate_setstat("driver.stats.bytes.broadcast", "%" PRIuSIZE, bytes);
+	stats_open = 0;
+
+	batch_depth = 0;
+
+	if (batch_len > 0) {
+		send_buf_to_all(batch_buf, batch_len, 0);
+		batch_len = 0;
+	}
+
+	if (batch_binlen > 0) {
+		send_buf_to_all(batch_bin, batch_binlen, 1);
+		batch_binlen = 0;
+	}
+}
+
 void dstate_free(void)
 {
 	state_infofree(dtree_root);
 	dtree_root = NULL;
 
+	free(batch_buf);
+	batch_buf = NULL;
+	batch_len = 0;
+	batch_size = 0;
+	free(batch_bin);
+	batch_bin = NULL;
+	batch_binlen = 0;
+	batch_binsize = 0;
+	batch_depth = 0;
+
 	state_cmdfree(cmdhead);
 	cmdhead = NULL;
 
+#ifndef WIN32
+	watched_count = 0;
+#endif	/* !WIN32 */
+
 	sock_close();
 }
 
@@ -55,6 +55,7 @@ typedef struct conn_s {
 	int	nobroadcast;	/* connections can request to ignore send_to_all() updates */
 	int	readzero;	/* how many times in a row we had zero bytes read; see DSTATE_CONN_READZERO_THROTTLE_USEC and DSTATE_CONN_READZERO_THROTTLE_MAX */
 	int	closing;	/* raised during LOGOUT processing, to close the socket when time is right */
+	int	binary;		/* negotiated binary framing of our output, see dsproto.h */
 } conn_t;
 
 /* sleep after read()ing zero bytes */
@@ -63,6 +64,10 @@ typedef struct conn_s {
 /* close socket after read()ing zero bytes this many times in a row */
 #define DSTATE_CONN_READZERO_THROTTLE_MAX	5
 
+/* retry a broadcast write this many times (sleeping 200 usec in between)
+ * while the socket is full, before giving up on the connection */
+#define DSTATE_WRITE_RETRIES	50
+
 #include "main.h"	/* for set_exit_flag(); uses conn_t itself */
 
 	extern	struct	ups_handler	upsh;
@@ -73,6 +78,17 @@ typedef struct conn_s {
 
 char * dstate_init(const char *prog, const char *devname);
 int dstate_poll_fds(struct timeval timeout, TYPE_FD extrafd);
+
+/* Have dstate_poll_fds() also watch this descriptor, and call the
+ * handler as soon as it is readable (or writable, if for_write; e.g.
+ * for asynchronous device I/O handled by a library), while it keeps
+ * waiting for the end of the poll interval unless the handler returns
+ * non-zero. Watching an fd again replaces its handler. Returns 0 on
+ * success, or -1 if not possible (too many fds, or on WIN32). */
+#define DSTATE_MAX_WATCHED_FDS	16
+typedef int (*dstate_fd_handler_t)(TYPE_FD fd, void *arg);
+int dstate_watch_fd(TYPE_FD fd, int for_write, dstate_fd_handler_t handler, void *arg);
+void dstate_unwatch_fd(TYPE_FD fd);
 int vdstate_setinfo(const char *var, const char *fmt, va_list ap);
 int dstate_setinfo(const char *var, const char *fmt, ...)
 	__attribute__ ((__format__ (__printf__, 2, 3)));
@@ -97,6 +113,25 @@ int dstate_delrange(const char *var, const int min, const int max);
 int dstate_delcmd(const char *cmd);
 void dstate_free(void);
 const st_tree_t *dstate_getroot(void);
+
+/* The driver.stats.* counters change on almost every poll, so they are
+ * only published in poll cycles at least "statsinterval" seconds apart
+ * (see ups.conf, by default never). Drivers set them with dstate_setstat(),
+ * which does nothing (and returns 0) in other cycles; dstate_stats_due()
+ * tells whether this cycle publishes them, to skip collecting them. */
+void dstate_setstatsinterval(time_t interval);
+int dstate_stats_due(void);
+int dstate_setstat(const char *var, const char *fmt, ...)
+	__attribute__ ((__format__ (__printf__, 2, 3)));
+
+/* Collect the updates broadcast to upsd between these calls (typically
+ * around upsdrv_updateinfo()) and send them in a single write to each
+ * connection. The commit also publishes driver.stats.vars.polled,
+ * driver.stats.vars.changed and driver.stats.bytes.broadcast for the
+ * batch (if due, see above). Calls may be nested; only the outermost
+ * commit sends data. */
+void dstate_batch_begin(void);
+void dstate_batch_commit(void);
 const cmdlist_t *dstate_getcmdlist(void);
 
 void dstate_dataok(void);
@@ -23,6 +23,7 @@
 #include "main.h"
 #include "generic_modbus.h"
 #include <modbus.h>
+#include "modbus_bus.h"
 #include "timehead.h"
 #include "nut_stdint.h"
 
@@ -31,7 +32,7 @@
 #endif
 
 #define DRIVER_NAME	"NUT Generic Modbus driver (libmodbus link type: " NUT_MODBUS_LINKTYPE_STR ")"
-#define DRIVER_VERSION	"0.07"
+#define DRIVER_VERSION	"0.09"
 
 /* variables */
 static modbus_t *mbctx = NULL;                             /* modbus memory context */
@@ -50,6 +51,12 @@ static uint32_t mod_resp_to_s = MODRESP_TIMEOUT_s;         /* set the modbus res
 static uint32_t mod_resp_to_us = MODRESP_TIMEOUT_us;       /* set the modbus response time out (us) */
 static uint32_t mod_byte_to_s = MODBYTE_TIMEOUT_s;         /* set the modbus byte time out (us) */
 static uint32_t mod_byte_to_us = MODBYTE_TIMEOUT_us;       /* set the modbus byte time out (us) */
+static int mod_read_gap = MOD_READ_GAP;                    /* max unused addresses within a ranged read */
+
+static readblk_t rdplan[NUMOF_SIG_STATES];                 /* ranged reads of the polled signals */
+static int rdplan_cnt = 0;                                 /* count of ranged reads per poll */
+static int sigblk[NUMOF_SIG_STATES];                       /* ranged read of each signal, or NOTUSED */
+static int sigval[NUMOF_SIG_STATES];                       /* signal values read in this poll cycle */
 
 /* get config vars set by -x or defined in ups.conf driver section */
 void get_config_vars(void);
@@ -60,8 +67,14 @@ modbus_t *modbus_new(const char *port);
 /* reconnect upon communication error */
 void modbus_reconnect(void);
 
-/* modbus register read function */
-int register_read(modbus_t *mb, int addr, regtype_t type, void *data);
+/* modbus register read function, nb registers (or bits) from addr */
+int register_read(modbus_t *mb, int addr, int nb, regtype_t type, void *data);
+
+/* merge the addresses of the polled signals into ranged reads */
+void build_read_plan(void);
+
+/* perform the ranged reads, keeping signal values for this poll cycle */
+void read_plan_update(void);
 
 /* instant command triggered by upsd */
 int upscmd(const char *cmd, const char *arg);
@@ -116,6 +129,7 @@ void upsdrv_initups(void)
 	upsdebugx(2, "upsdrv_initups");
 
 	get_config_vars();
+	build_read_plan();
 
 	/* open communication port */
 	mbctx = modbus_new(device_path);
@@ -136,6 +150,11 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: error(%s)", modbus_strerror(errno));
 	}
 
+	/* share the serial line with the drivers of other slaves */
+	if (strstr(device_path, "/dev/tty") != NULL) {
+		modbus_bus_init(mbctx, device_path, ser_baud_rate);
+	}
+
 	/* set modbus response timeout */
 #if (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32) || (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32_cast_timeval_fields)
 	rval = modbus_set_response_timeout(mbctx, mod_resp_to_s, mod_resp_to_us);
@@ -192,6 +211,7 @@ void upsdrv_updateinfo(void)
 	upsdebugx(2, "upsdrv_updateinfo");
 	status_init();      /* initialize ups.status update */
 	alarm_init();       /* initialize ups.alarm update */
+	read_plan_update(); /* read the signals evaluated below */
 
 	/*
 	 * update UPS status regarding MAINS state either via OL | OB.
@@ -364,6 +384,7 @@ void upsdrv_makevartable(void)
 	addvar(VAR_VALUE, "mod_resp_to_us", "modbus response timeout (us)");
 	addvar(VAR_VALUE, "mod_byte_to_s", "modbus byte timeout (s)");
 	addvar(VAR_VALUE, "mod_byte_to_us", "modbus byte timeout (us)");
+	addvar(VAR_VALUE, "mod_read_gap", "max unused addresses within a ranged modbus read");
 	addvar(VAR_VALUE, "OL_addr", "modbus address for OL state");
 	addvar(VAR_VALUE, "OB_addr", "modbus address for OB state");
 	addvar(VAR_VALUE, "LB_addr", "modbus address for LB state");
@@ -404,31 +425,24 @@ void upsdrv_cleanup(void)
  * driver support functions
  */
 
-/* Read a modbus register */
-int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
+/* Read nb modbus registers (into uint16_t data[]) or bits (into uint8_t data[]) */
+int register_read(modbus_t *mb, int addr, int nb, regtype_t type, void *data)
 {
 	int rval = -1;
 
-	/* register bit masks */
-	uint16_t mask8 = 0x000F;
-	uint16_t mask16 = 0x00FF;
-
+	modbus_bus_lock(mb);
 	switch (type) {
 		case COIL:
-			rval = modbus_read_bits(mb, addr, 1, (uint8_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask8;
+			rval = modbus_read_bits(mb, addr, nb, (uint8_t *)data);
 			break;
 		case INPUT_B:
-			rval = modbus_read_input_bits(mb, addr, 1, (uint8_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask8;
+			rval = modbus_read_input_bits(mb, addr, nb, (uint8_t *)data);
 			break;
 		case INPUT_R:
-			rval = modbus_read_input_registers(mb, addr, 1, (uint16_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask16;
+			rval = modbus_read_input_registers(mb, addr, nb, (uint16_t *)data);
 			break;
 		case HOLDING:
-			rval = modbus_read_registers(mb, addr, 1, (uint16_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask16;
+			rval = modbus_read_registers(mb, addr, nb, (uint16_t *)data);
 			break;
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
@@ -460,10 +474,13 @@ int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 # pragma GCC diagnostic pop
 #endif
 	}
+	modbus_bus_unlock(mb);
+
 	if (rval == -1) {
-		upslogx(LOG_ERR, "ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s",
+		upslogx(LOG_ERR, "ERROR:(%s) modbus_read: addr:0x%x, nb:%d, type:%8s, path:%s",
 			modbus_strerror(errno),
 			(unsigned int)addr,
+			nb,
 			(type == COIL) ? "COIL" :
 			(type == INPUT_B) ? "INPUT_B" :
 			(type == INPUT_R) ? "INPUT_R" : "HOLDING",
@@ -476,11 +493,132 @@ int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 			modbus_reconnect();
 		}
 	}
-	upsdebugx(3, "register addr: 0x%x, register type: %u read: %u",
-		(unsigned int)addr, type, *(unsigned int *)data);
+	upsdebugx(3, "register addr: 0x%x, nb: %d, register type: %u rval: %d",
+		(unsigned int)addr, nb, type, rval);
 	return rval;
 }
 
+/* returns 1 if upsdrv_updateinfo() evaluates the signal, see there */
+static int signal_polled(int sig)
+{
+	if (sigar[sig].addr == NOTUSED) {
+		return 0;
+	}
+
+	switch (sig) {
+		case OL_T:
+		case LB_T:
+		case HB_T:
+		case RB_T:
+		case CHRG_T:
+			return 1;
+		case OB_T:
+			return (sigar[OL_T].addr == NOTUSED);
+		case DISCHRG_T:
+			return (sigar[CHRG_T].addr == NOTUSED);
+		default:
+			return 0;
+	}
+}
+
+/*
+ * merge the addresses of the polled signals into ranged reads: signals
+ * of the same register type at most mod_read_gap unused addresses apart
+ * are read in one modbus transaction instead of one transaction each
+ */
+void build_read_plan(void)
+{
+	int polled[NUMOF_SIG_STATES];
+	int i, j, n = 0, sig, maxnb;
+	readblk_t *blk = NULL;
+
+	/* sort the polled signals by register type and address */
+	for (i = 0; i < NUMOF_SIG_STATES; i++) {
+		sigblk[i] = NOTUSED;
+		sigval[i] = -1;
+
+		if (!signal_polled(i)) {
+			continue;
+		}
+
+		for (j = n; j > 0; j--) {
+			sig = polled[j - 1];
+			if (sigar[sig].type < sigar[i].type
+			 || (sigar[sig].type == sigar[i].type && sigar[sig].addr <= sigar[i].addr)
+			) {
+				break;
+			}
+			polled[j] = sig;
+		}
+		polled[j] = i;
+		n++;
+	}
+
+	rdplan_cnt = 0;
+	for (i = 0; i < n; i++) {
+		sig = polled[i];
+		maxnb = (sigar[sig].type == COIL || sigar[sig].type == INPUT_B)
+			? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS;
+
+		if (blk == NULL || mod_read_gap < 0
+		 || blk->type != sigar[sig].type
+		 || sigar[sig].addr - (blk->addr + blk->nb) > mod_read_gap
+		 || sigar[sig].addr - blk->addr >= maxnb
+		) {
+			blk = &rdplan[rdplan_cnt++];
+			blk->addr = sigar[sig].addr;
+			blk->nb = 1;
+			blk->type = sigar[sig].type;
+		} else if (sigar[sig].addr >= blk->addr + blk->nb) {
+			blk->nb = sigar[sig].addr - blk->addr + 1;
+		}
+		sigblk[sig] = (int)(blk - rdplan);
+	}
+
+	upsdebugx(2, "read plan: %d signals in %d modbus reads", n, rdplan_cnt);
+	for (i = 0; i < rdplan_cnt; i++) {
+		upsdebugx(2, "read plan: addr:0x%x, nb:%d, type:%u",
+			(unsigned int)(rdplan[i].addr), rdplan[i].nb, rdplan[i].type);
+	}
+}
+
+/* perform the ranged reads, keeping signal values for this poll cycle */
+void read_plan_update(void)
+{
+	static uint8_t bits[MODBUS_MAX_READ_BITS];
+	static uint16_t regs[MODBUS_MAX_READ_REGISTERS];
+	int b, i, rval, isbit;
+
+	/* register bit masks */
+	uint16_t mask8 = 0x000F;
+	uint16_t mask16 = 0x00FF;
+
+	for (b = 0; b < rdplan_cnt; b++) {
+		isbit = (rdplan[b].type == COIL || rdplan[b].type == INPUT_B);
+		rval = register_read(mbctx, rdplan[b].addr, rdplan[b].nb, rdplan[b].type,
+			isbit ? (void *)bits : (void *)regs);
+
+		for (i = 0; i < NUMOF_SIG_STATES; i++) {
+			if (sigblk[i] != b) {
+				continue;
+			}
+
+			if (rval == -1) {
+				sigval[i] = -1;
+			} else if (isbit) {
+				sigval[i] = bits[sigar[i].addr - rdplan[b].addr] & mask8;
+			} else {
+				sigval[i] = regs[sigar[i].addr - rdplan[b].addr] & mask16;
+			}
+
+			upsdebugx(3, "register addr: 0x%x, register type: %u read: %d",
+				(unsigned int)(sigar[i].addr), sigar[i].type, sigval[i]);
+		}
+	}
+
+	upsdebugx(2, "read_plan_update: %d modbus reads", rdplan_cnt);
+}
+
 /* write a modbus register */
 int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 {
@@ -490,6 +628,7 @@ int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 	uint16_t mask8 = 0x000F;
 	uint16_t mask16 = 0x00FF;
 
+	modbus_bus_lock(mb);
 	switch (type) {
 		case COIL:
 			*(uint16_t *)data = *(uint16_t *)data & mask8;
@@ -517,6 +656,8 @@ int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 			upsdebugx(2, "ERROR: register_write: invalid register type %u", type);
 			break;
 	}
+	modbus_bus_unlock(mb);
+
 	if (rval == -1) {
 		upslogx(LOG_ERR, "ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s",
 			modbus_strerror(errno),
@@ -682,68 +823,12 @@ int upscmd(const char *cmd, const char *arg)
 int get_signal_state(devstate_t state)
 {
 	int rval = -1;
-	int reg_val;
-	regtype_t rtype = 0;    /* register type */
-	int addr = -1;          /* register address */
-
-	/* assign register address and type  */
-	switch (state) {
-		case OL_T:
-			addr = sigar[OL_T].addr;
-			rtype = sigar[OL_T].type;
-			break;
-		case OB_T:
-			addr = sigar[OB_T].addr;
-			rtype = sigar[OB_T].type;
-			break;
-		case LB_T:
-			addr = sigar[LB_T].addr;
-			rtype = sigar[LB_T].type;
-			break;
-		case HB_T:
-			addr = sigar[HB_T].addr;
-			rtype = sigar[HB_T].type;
-			break;
-		case RB_T:
-			addr = sigar[RB_T].addr;
-			rtype = sigar[RB_T].type;
-			break;
-		case CHRG_T:
-			addr = sigar[CHRG_T].addr;
-			rtype = sigar[CHRG_T].type;
-			break;
-		case DISCHRG_T:
-			addr = sigar[DISCHRG_T].addr;
-			rtype = sigar[DISCHRG_T].type;
-			break;
-
-		case BYPASS_T:
-		case CAL_T:
-		case FSD_T:
-		case OFF_T:
-		case OVER_T:
-		case TRIM_T:
-		case BOOST_T:
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT)
-# pragma GCC diagnostic push
-# pragma GCC diagnostic ignored "-Wcovered-switch-default"
-#endif
-		/* All enum cases defined as of the time of coding
-		 * have been covered above. Handle later definitions,
-		 * memory corruptions and buggy inputs below...
-		 */
-		default:
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT)
-# pragma GCC diagnostic pop
-#endif
-			break;
-	}
 
-	rval = register_read(mbctx, addr, rtype, &reg_val);
-	if (rval > -1) {
-		rval = reg_val;
+	/* take the value of this poll cycle's ranged read */
+	if ((int)state >= 0 && (int)state < NUMOF_SIG_STATES && sigblk[state] != NOTUSED) {
+		rval = sigval[state];
 	}
-	upsdebugx(3, "get_signal_state: state: %d", reg_val);
+	upsdebugx(3, "get_signal_state: state: %d", rval);
 	return rval;
 }
 
@@ -837,6 +922,12 @@ void get_config_vars(void)
 	}
 	upsdebugx(2, "mod_byte_to_us %u", mod_byte_to_us);
 
+	/* check if the ranged read gap is set and get the value */
+	if (testvar("mod_read_gap")) {
+		mod_read_gap = (int)strtol(getval("mod_read_gap"), NULL, 10);
+	}
+	upsdebugx(2, "mod_read_gap %d", mod_read_gap);
+
 	/* check if OL address is set and get the value */
 	if (testvar("OL_addr")) {
 		sigar[OL_T].addr = (int)strtol(getval("OL_addr"), NULL, 0);
@@ -1111,6 +1202,11 @@ void modbus_reconnect(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 	}
 
+	/* share the serial line with the drivers of other slaves */
+	if (strstr(device_path, "/dev/tty") != NULL) {
+		modbus_bus_init(mbctx, device_path, ser_baud_rate);
+	}
+
 	/* set modbus response timeout */
 #if (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32) || (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32_cast_timeval_fields)
 	rval = modbus_set_response_timeout(mbctx, mod_resp_to_s, mod_resp_to_us);
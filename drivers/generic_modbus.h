@@ -46,6 +46,12 @@
 /* modbus access parameters */
 #define MODBUS_SLAVE_ID 5
 
+/*
+ * maximum count of unused addresses that a ranged read may span between
+ * two signals of the same register type (-1: read each signal by itself)
+ */
+#define MOD_READ_GAP 0
+
 /* shutdown repeat on error */
 #define FSD_REPEAT_CNT 3
 
@@ -91,6 +97,14 @@ struct sigattr {
 };
 typedef struct sigattr sigattr_t;
 
+/* ranged read of contiguous registers, covering one or more signals */
+struct readblk {
+	int addr;           /* first register address */
+	int nb;             /* count of registers */
+	regtype_t type;     /* register type */
+};
+typedef struct readblk readblk_t;
+
 #define NUMOF_SIG_STATES 14
 #define NOTUSED -1
 
@@ -461,6 +461,184 @@ static int HIDParse(HIDParser_t *pParser, HIDData_t *pData)
 	return Found;
 }
 
+/*
+ * Item indexes
+ * Hash lookups for the FindObject*() methods, which run for each report
+ * of interrupt events, instead of scanning up to MAX_REPORT items. Each
+ * key is filed under the first item (in descriptor order) answering it,
+ * as the scans did; for the Path index, that is under every prefix of
+ * the item Path, since FindObject_with_Path() matches those too.
+ * -------------------------------------------------------------------------- */
+typedef struct {
+	uint8_t		ReportID;
+	uint8_t		Type;
+	uint8_t		Offset;
+	uint8_t		Size;				/* of Path prefix			*/
+	const HIDNode_t	*Node;
+} HIDKey_t;
+
+#define INDEX_ITEM(entry)	((size_t)((entry) & 0xFFFF) - 1)
+#define INDEX_SIZE(entry)	((uint8_t)((entry) >> 16))
+
+static uint32_t index_hash(uint32_t hash, uint32_t word)
+{
+	return str_hash(hash, &word, sizeof(word), 0);
+}
+
+static uint32_t path_hash(const HIDKey_t *key)
+{
+	uint32_t	hash = index_hash(STR_HASH_INIT, ((uint32_t)key->Type << 8) | key->Size);
+	uint8_t	i;
+
+	for (i = 0; i < key->Size; i++) {
+		hash = index_hash(hash, key->Node[i]);
+	}
+
+	return hash;
+}
+
+static uint32_t id_hash(const HIDKey_t *key)
+{
+	return index_hash(STR_HASH_INIT, ((uint32_t)key->ReportID << 16)
+		| ((uint32_t)key->Type << 8) | key->Offset);
+}
+
+static uint32_t node_hash(const HIDKey_t *key)
+{
+	return index_hash(index_hash(STR_HASH_INIT, key->ReportID), key->Node[0]);
+}
+
+static int path_match(const HIDDesc_t *pDesc_arg, uint32_t entry, const HIDKey_t *key)
+{
+	const HIDData_t	*pData = &pDesc_arg->item[INDEX_ITEM(entry)];
+
+	return (INDEX_SIZE(entry) == key->Size && pData->Type == key->Type
+		&& !memcmp(pData->Path.Node, key->Node, key->Size * sizeof(HIDNode_t)));
+}
+
+static int id_match(const HIDDesc_t *pDesc_arg, uint32_t entry, const HIDKey_t *key)
+{
+	const HIDData_t	*pData = &pDesc_arg->item[INDEX_ITEM(entry)];
+
+	return (pData->ReportID == key->ReportID && pData->Type == key->Type
+		&& pData->Offset == key->Offset);
+}
+
+static int node_match(const HIDDesc_t *pDesc_arg, uint32_t entry, const HIDKey_t *key)
+{
+	const HIDData_t	*pData = &pDesc_arg->item[INDEX_ITEM(entry)];
+
+	return (pData->ReportID == key->ReportID
+		&& pData->Path.Node[pData->Path.Size - 1] == key->Node[0]);
+}
+
+/* Return the slot where the key is filed, or the free one where it
+ * would be (the tables are never more than half full) */
+static uint32_t *index_slot(const HIDDesc_t *pDesc_arg, const HIDIndex_t *idx,
+	uint32_t hash, int (*match)(const HIDDesc_t *, uint32_t, const HIDKey_t *),
+	const HIDKey_t *key)
+{
+	size_t	i;
+
+	for (i = hash & idx->mask; idx->slot[i]; i = (i + 1) & idx->mask) {
+		if (match(pDesc_arg, idx->slot[i], key)) {
+			break;
+		}
+	}
+
+	return &idx->slot[i];
+}
+
+static int index_alloc(HIDIndex_t *idx, size_t nkeys)
+{
+	size_t	size = 16;
+
+	while (size < 2 * nkeys) {
+		size <<= 1;
+	}
+
+	idx->slot = calloc(size, sizeof(*idx->slot));
+	idx->mask = size - 1;
+
+	return idx->slot ? 0 : -1;
+}
+
+static void index_free(HIDIndex_t *idx)
+{
+	free(idx->slot);
+	idx->slot = NULL;
+	idx->mask = 0;
+}
+
+/* Build the indexes of the parsed items; returns 0, or -1 (errno set) */
+static int index_items(HIDDesc_t *pDesc_arg)
+{
+	size_t	i, nprefixes = 0, next[256];
+	HIDKey_t	key;
+	uint32_t	*slot;
+
+	for (i = 0; i < pDesc_arg->nitems; i++) {
+		nprefixes += pDesc_arg->item[i].Path.Size;
+	}
+
+	if (index_alloc(&pDesc_arg->path_index, nprefixes) < 0
+	 || index_alloc(&pDesc_arg->id_index, pDesc_arg->nitems) < 0
+	 || index_alloc(&pDesc_arg->node_index, pDesc_arg->nitems) < 0
+	 || !(pDesc_arg->report_items = calloc(pDesc_arg->nitems, sizeof(*pDesc_arg->report_items)))
+	) {
+		return -1;
+	}
+
+	memset(pDesc_arg->report_start, 0, sizeof(pDesc_arg->report_start));
+
+	for (i = 0; i < pDesc_arg->nitems; i++) {
+		HIDData_t	*pData = &pDesc_arg->item[i];
+		uint32_t	entry = (uint32_t)(i + 1);
+
+		key.ReportID = pData->ReportID;
+		key.Type = pData->Type;
+		key.Offset = pData->Offset;
+		key.Node = pData->Path.Node;
+
+		for (key.Size = 1; key.Size <= pData->Path.Size && key.Size <= PATH_SIZE; key.Size++) {
+			slot = index_slot(pDesc_arg, &pDesc_arg->path_index,
+				path_hash(&key), path_match, &key);
+			if (!*slot) {
+				*slot = entry | ((uint32_t)key.Size << 16);
+			}
+		}
+
+		slot = index_slot(pDesc_arg, &pDesc_arg->id_index,
+			id_hash(&key), id_match, &key);
+		if (!*slot) {
+			*slot = entry;
+		}
+
+		if (pData->Path.Size > 0) {
+			key.Node = &pData->Path.Node[pData->Path.Size - 1];
+			slot = index_slot(pDesc_arg, &pDesc_arg->node_index,
+				node_hash(&key), node_match, &key);
+			if (!*slot) {
+				*slot = entry;
+			}
+		}
+
+		pDesc_arg->report_start[pData->ReportID + 1]++;
+	}
+
+	/* counting sort of the items by ReportID, keeping their order */
+	for (i = 1; i < 257; i++) {
+		pDesc_arg->report_start[i] += pDesc_arg->report_start[i - 1];
+	}
+
+	memcpy(next, pDesc_arg->report_start, sizeof(next));
+	for (i = 0; i < pDesc_arg->nitems; i++) {
+		pDesc_arg->report_items[next[pDesc_arg->item[i].ReportID]++] = &pDesc_arg->item[i];
+	}
+
+	return 0;
+}
+
 /*
  * FindObject
  * Get pData characteristics from pData->Path
@@ -486,6 +664,20 @@ HIDData_t *FindObject_with_Path(HIDDesc_t *pDesc_arg, HIDPath_t *Path, uint8_t T
 {
 	size_t	i;
 
+	if (pDesc_arg->path_index.slot && Path->Size > 0 && Path->Size <= PATH_SIZE) {
+		HIDKey_t	key;
+		uint32_t	*slot;
+
+		key.Type = Type;
+		key.Size = Path->Size;
+		key.Node = Path->Node;
+
+		slot = index_slot(pDesc_arg, &pDesc_arg->path_index,
+			path_hash(&key), path_match, &key);
+
+		return *slot ? &pDesc_arg->item[INDEX_ITEM(*slot)] : NULL;
+	}
+
 	for (i = 0; i < pDesc_arg->nitems; i++) {
 		HIDData_t *pData = &pDesc_arg->item[i];
 
@@ -512,6 +704,20 @@ HIDData_t *FindObject_with_ID(HIDDesc_t *pDesc_arg, uint8_t ReportID, uint8_t Of
 {
 	size_t	i;
 
+	if (pDesc_arg->id_index.slot) {
+		HIDKey_t	key;
+		uint32_t	*slot;
+
+		key.ReportID = ReportID;
+		key.Type = Type;
+		key.Offset = Offset;
+
+		slot = index_slot(pDesc_arg, &pDesc_arg->id_index,
+			id_hash(&key), id_match, &key);
+
+		return *slot ? &pDesc_arg->item[INDEX_ITEM(*slot)] : NULL;
+	}
+
 	for (i = 0; i < pDesc_arg->nitems; i++) {
 		HIDData_t *pData = &pDesc_arg->item[i];
 
@@ -541,6 +747,19 @@ HIDData_t *FindObject_with_ID_Node(HIDDesc_t *pDesc_arg, uint8_t ReportID, HIDNo
 {
 	size_t	i;
 
+	if (pDesc_arg->node_index.slot) {
+		HIDKey_t	key;
+		uint32_t	*slot;
+
+		key.ReportID = ReportID;
+		key.Node = &Node;
+
+		slot = index_slot(pDesc_arg, &pDesc_arg->node_index,
+			node_hash(&key), node_match, &key);
+
+		return *slot ? &pDesc_arg->item[INDEX_ITEM(*slot)] : NULL;
+	}
+
 	for (i = 0; i < pDesc_arg->nitems; i++) {
 		HIDData_t	*pData = &pDesc_arg->item[i];
 		HIDPath_t	*pPath;
@@ -562,6 +781,22 @@ HIDData_t *FindObject_with_ID_Node(HIDDesc_t *pDesc_arg, uint8_t ReportID, HIDNo
 	return NULL;
 }
 
+/*
+ * FindObjects_with_ID
+ * Get the items of the given ReportID, in descriptor order, and set
+ * *count to their number.
+ * -------------------------------------------------------------------------- */
+HIDData_t **FindObjects_with_ID(HIDDesc_t *pDesc_arg, uint8_t ReportID, size_t *count)
+{
+	if (!pDesc_arg->report_items) {
+		*count = 0;
+		return NULL;
+	}
+
+	*count = pDesc_arg->report_start[ReportID + 1] - pDesc_arg->report_start[ReportID];
+	return &pDesc_arg->report_items[pDesc_arg->report_start[ReportID]];
+}
+
 /*
  * GetValue
  * Extract data from a report stored in Buf.
@@ -764,6 +999,11 @@ HIDDesc_t *Parse_ReportDesc(const usb_ctrl_charbuf ReportDesc, const usb_ctrl_ch
 
 	pDesc_var->item = realloc(pDesc_var->item, pDesc_var->nitems * sizeof(*pDesc_var->item));
 
+	if (index_items(pDesc_var) < 0) {
+		Free_ReportDesc(pDesc_var);
+		return NULL;
+	}
+
 	return pDesc_var;
 }
 
@@ -774,6 +1014,10 @@ void Free_ReportDesc(HIDDesc_t *pDesc_arg)
 		return;
 	}
 
+	index_free(&pDesc_arg->path_index);
+	index_free(&pDesc_arg->id_index);
+	index_free(&pDesc_arg->node_index);
+	free(pDesc_arg->report_items);
 	free(pDesc_arg->item);
 	free(pDesc_arg);
 }
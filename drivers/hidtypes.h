@@ -317,6 +317,18 @@ typedef struct {
 	int8_t		have_PhyMax;			/* Physical Max defined?		*/
 } HIDData_t;
 
+/*
+ * HIDIndex struct
+ *
+ * Hash index of the items of a HIDDesc (open addressing): a used slot
+ * holds the item number + 1 in bits 0..15, and for the Path index, the
+ * size of the Path prefix it was filed under in bits 16..23
+ * -------------------------------------------------------------------------- */
+typedef struct {
+	size_t		mask;				/* number of slots - 1		*/
+	uint32_t	*slot;				/* slots, 0 when free		*/
+} HIDIndex_t;
+
 /*
  * HIDDesc struct
  *
@@ -326,6 +338,13 @@ typedef struct {
 	size_t		nitems;				/* number of items in descriptor */
 	HIDData_t	*item;				/* list of items			*/
 	size_t		replen[256];		/* list of report lengths, in byte */
+
+	/* Indexes built by Parse_ReportDesc() for the FindObject*() methods */
+	HIDIndex_t	path_index;			/* by Type and Path (and prefixes) */
+	HIDIndex_t	id_index;			/* by ReportID, Type and Offset	*/
+	HIDIndex_t	node_index;			/* by ReportID and last Node	*/
+	HIDData_t	**report_items;		/* items, grouped by ReportID	*/
+	size_t		report_start[257];	/* first of each group in report_items */
 } HIDDesc_t;
 
 #ifdef __cplusplus
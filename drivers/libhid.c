@@ -71,6 +71,10 @@ size_t max_report_size = 0;
 int interrupt_only = 0;
 size_t interrupt_size = 0;
 
+/* Control transfers (GET_REPORT, SET_REPORT, string descriptors)
+ * issued so far, for the driver.stats.usb.* variables */
+size_t hid_ctrl_transfers = 0;
+
 #define SMIN(a, b) ( ((intmax_t)(a) < (intmax_t)(b)) ? (a) : (b) )
 #define UMIN(a, b) ( ((uintmax_t)(a) < (uintmax_t)(b)) ? (a) : (b) )
 
@@ -154,7 +158,9 @@ reportbuf_t *new_report_buffer(HIDDesc_t *arg_pDesc)
 /* refresh the report with the given id in the report buffer rbuf.  If
    the report is not yet in the buffer, or if it is older than "age"
    seconds, then the report is freshly read from the USB
-   device. Otherwise, it is unchanged.
+   device. Otherwise, it is unchanged. Between HIDWalkBegin() and
+   HIDWalkEnd(), a report is read at most once, whatever its age:
+   later calls reuse it (or fail again, if reading it failed).
    Return 0 on success, -1 on error with errno set. */
 /* because buggy firmwares from APC return wrong report size, we either
    ask the report with the found report size or with the whole buffer size
@@ -165,8 +171,25 @@ static int refresh_report_buffer(reportbuf_t *rbuf, hid_dev_handle_t udev, HIDDa
 	int	ret;
 	size_t	r;
 
+	if (rbuf->walk_active && rbuf->walked[id] == rbuf->walk) {
+		if (rbuf->walk_ret[id] <= 0) {
+			errno = -rbuf->walk_ret[id];
+			return -1;
+		}
+
+		/* already read (or found fresh) during this walk */
+		upsdebug_hex(3, "Report[buf]", rbuf->data[id], rbuf->len[id]);
+		return 0;
+	}
+
 	if (interrupt_only || rbuf->ts[id] + age > time(NULL)) {
-		/* buffered report is still good; nothing to do */
+		/* buffered report is still good; nothing to do, and it
+		 * must not be read again if it ages before the walk ends */
+		if (rbuf->walk_active) {
+			rbuf->walked[id] = rbuf->walk;
+			rbuf->walk_ret[id] = 1;
+		}
+
 		upsdebug_hex(3, "Report[buf]", rbuf->data[id], rbuf->len[id]);
 		return 0;
 	}
@@ -228,10 +251,16 @@ static int refresh_report_buffer(reportbuf_t *rbuf, hid_dev_handle_t udev, HIDDa
 # pragma GCC diagnostic pop
 #endif
 
+	hid_ctrl_transfers++;
 	ret = comm_driver->get_report(udev, id,
 		(usb_ctrl_charbuf)rbuf->data[id],
 		(usb_ctrl_charbufsize)r);
 
+	if (rbuf->walk_active) {
+		rbuf->walked[id] = rbuf->walk;
+		rbuf->walk_ret[id] = ret;
+	}
+
 	if (ret <= 0) {
 		errno = -ret;
 		return -1;
@@ -336,6 +365,7 @@ static int set_item_buffered(reportbuf_t *rbuf, hid_dev_handle_t udev, HIDData_t
 # pragma GCC diagnostic pop
 #endif
 
+	hid_ctrl_transfers++;
 	ret = comm_driver->set_report(udev, id,
 		(usb_ctrl_charbuf)rbuf->data[id],
 		(usb_ctrl_charbufsize)r);
@@ -544,6 +574,49 @@ int HIDGetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double *Value, ti
 	return 1;
 }
 
+/* Make sure that the report holding the given HIDData is buffered,
+ * reading it from the device if it is older than "age" seconds, so
+ * that the values of all its items can then be decoded from it.
+ * return 1 if OK, 0 on fail, -errno otherwise (ie disconnect).
+ */
+int HIDGetDataReport(hid_dev_handle_t udev, HIDData_t *hiddata, time_t age)
+{
+	if (hiddata == NULL) {
+		return 0;
+	}
+
+	if (refresh_report_buffer(reportbuf, udev, hiddata, age) < 0) {
+		upsdebug_with_errno(1, "Can't retrieve Report %02x", hiddata->ReportID);
+		return -errno;
+	}
+
+	return 1;
+}
+
+/* Start a walk through the device data: from now until HIDWalkEnd(),
+ * each report is read from the device at most once. */
+void HIDWalkBegin(void)
+{
+	if (!reportbuf) {
+		return;
+	}
+
+	if (++reportbuf->walk == 0) {
+		/* wrapped around: forget which walk reports were read in */
+		memset(reportbuf->walked, 0, sizeof(reportbuf->walked));
+		reportbuf->walk = 1;
+	}
+
+	reportbuf->walk_active = 1;
+}
+
+void HIDWalkEnd(void)
+{
+	if (reportbuf) {
+		reportbuf->walk_active = 0;
+	}
+}
+
 /* Return the physical value associated with the given path.
  * return 1 if OK, 0 on fail, -errno otherwise (ie disconnect).
  */
@@ -624,6 +697,7 @@ char *HIDGetIndexString(hid_dev_handle_t udev, const int Index, char *buf, size_
 # pragma GCC diagnostic pop
 #endif
 
+	hid_ctrl_transfers++;
 	if (comm_driver->get_string(udev, idx, buf, (usb_ctrl_charbufsize)buflen) < 1)
 		buf[0] = '\0';
 
@@ -696,10 +770,8 @@ bool_t HIDSetItemValue(hid_dev_handle_t udev, const char *hidpath, double Value,
 int HIDGetEvents(hid_dev_handle_t udev, HIDData_t **event, int eventsize)
 {
 	unsigned char	buf[SMALLBUF];
-	int		itemCount = 0;
-	int		buflen, ret;
-	size_t	i, r;
-	HIDData_t	*pData;
+	int		buflen;
+	size_t	r;
 
 	/* needs libusb-0.1.8 to work => use ifdef and autoconf */
 	r = (interrupt_size > 0 && interrupt_size < sizeof(buf))
@@ -769,20 +841,31 @@ int HIDGetEvents(hid_dev_handle_t udev, HIDData_t **event, int eventsize)
 		return buflen;	/* propagate "error" or "no event" code */
 	}
 
-	ret = file_report_buffer(reportbuf, buf, (size_t)buflen);
+	return HIDFileEvents(buf, (size_t)buflen, event, eventsize);
+}
+
+/* File an input report read from the interrupt pipe (by HIDGetEvents()
+ * or asynchronously) in the report buffer, and list its items in event.
+ * Return the item count, or -errno on failure.
+ */
+int HIDFileEvents(unsigned char *buf, size_t buflen, HIDData_t **event, int eventsize)
+{
+	int		itemCount = 0;
+	int		ret;
+	size_t	i, nitems;
+	HIDData_t	*pData, **items;
+
+	ret = file_report_buffer(reportbuf, buf, buflen);
 	if (ret < 0) {
 		upsdebug_with_errno(1, "%s: failed to buffer report", __func__);
 		return -errno;
 	}
 
 	/* now read all items that are part of this report */
-	for (i=0; i<pDesc->nitems; i++) {
-
-		pData = &pDesc->item[i];
+	items = FindObjects_with_ID(pDesc, buf[0], &nitems);
+	for (i=0; i<nitems; i++) {
 
-		/* Variable not part of this report */
-		if (pData->ReportID != buf[0])
-			continue;
+		pData = items[i];
 
 		/* Not an input report */
 		if (pData->Type != ITEM_INPUT)
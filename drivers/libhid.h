@@ -95,6 +95,10 @@ typedef struct reportbuf_s {
 	time_t	ts[256];			/* timestamp when report was retrieved */
 	size_t	len[256];			/* size of report data */
 	unsigned char	*data[256];		/* report data (allocated) */
+	unsigned int	walk;			/* number of the current/last walk */
+	int	walk_active;			/* between HIDWalkBegin() and HIDWalkEnd() */
+	unsigned int	walked[256];		/* walk in which report was last read */
+	int	walk_ret[256];			/* ...and what get_report() returned then */
 } reportbuf_t;
 
 extern reportbuf_t	*reportbuf;	/* buffer for most recent reports */
@@ -102,6 +106,7 @@ extern reportbuf_t	*reportbuf;	/* buffer for most recent reports */
 extern size_t max_report_size;
 extern int interrupt_only;
 extern size_t interrupt_size;
+extern size_t hid_ctrl_transfers;
 
 /* ---------------------------------------------------------------------- */
 
@@ -135,6 +140,17 @@ char *HIDGetDataItem(const HIDData_t *hiddata, usage_tables_t *utab);
  * -------------------------------------------------------------------------- */
 int HIDGetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double *Value, time_t age);
 
+/*
+ * HIDGetDataReport
+ * -------------------------------------------------------------------------- */
+int HIDGetDataReport(hid_dev_handle_t udev, HIDData_t *hiddata, time_t age);
+
+/*
+ * HIDWalkBegin, HIDWalkEnd
+ * -------------------------------------------------------------------------- */
+void HIDWalkBegin(void);
+void HIDWalkEnd(void);
+
 /*
  * HIDSetDataValue
  * -------------------------------------------------------------------------- */
@@ -150,6 +166,11 @@ char *HIDGetIndexString(hid_dev_handle_t udev, int Index, char *buf, size_t bufl
  * -------------------------------------------------------------------------- */
 int HIDGetEvents(hid_dev_handle_t udev, HIDData_t **event, int eventlen);
 
+/*
+ * HIDFileEvents
+ * -------------------------------------------------------------------------- */
+int HIDFileEvents(unsigned char *buf, size_t buflen, HIDData_t **event, int eventsize);
+
 /*
  * Support functions
  * -------------------------------------------------------------------------- */
@@ -1029,5 +1029,12 @@ usb_communication_subdriver_t usb_subdriver = {
 	LIBUSB_DEFAULT_INTERFACE,
 	LIBUSB_DEFAULT_DESC_INDEX,
 	LIBUSB_DEFAULT_HID_EP_IN,
-	LIBUSB_DEFAULT_HID_EP_OUT
+	LIBUSB_DEFAULT_HID_EP_OUT,
+	NULL,	/* no asynchronous interrupt reads with libusb 0.1 */
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,	/* no hotplug notifications either */
+	NULL
 };
@@ -32,6 +32,15 @@
 #include "nut_libusb.h"
 #include "nut_stdint.h"
 
+#ifndef WIN32
+# include <poll.h>	/* POLLOUT in libusb_pollfd events */
+#endif
+
+/* libusb 1.0.16 introduced hotplug notifications */
+#if (defined LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000102)
+# define NUT_LIBUSB_HOTPLUG	1
+#endif
+
 #define USB_DRIVER_NAME		"USB communication driver (libusb 1.0)"
 #define USB_DRIVER_VERSION	"0.50"
 
@@ -48,6 +57,9 @@ upsdrv_info_t comm_upsdrv_info = {
 
 static void nut_libusb_close(libusb_device_handle *udev);
 
+/* The device last opened, to tell its hotplug departure from others' */
+static libusb_device	*opened_device = NULL;
+
 /*! Add USB-related driver variables with addvar() and dstate_setinfo().
  * This removes some code duplication across the USB drivers.
  */
@@ -613,6 +625,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		if (!callback) {
 			libusb_free_config_descriptor(conf_desc);
 			libusb_free_device_list(devlist, 1);
+			opened_device = device;
 			return 1;
 		}
 
@@ -802,6 +815,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 
 		fflush(stdout);
 		libusb_free_device_list(devlist, 1);
+		opened_device = device;
 
 		return rdlen;
 
@@ -1122,12 +1136,400 @@ static int nut_libusb_get_interrupt(
 	return nut_libusb_strerror(ret, __func__);
 }
 
+/* Asynchronous interrupt reads: one transfer is kept pending on the
+ * interrupt endpoint, and resubmitted after each report it got. Once
+ * stopped, a transfer is no longer interrupt_transfer, and its callback
+ * (if one is still to come) only frees it. */
+static struct libusb_transfer	*interrupt_transfer = NULL;
+static int	interrupt_pending = 0;
+static struct libusb_transfer	*interrupt_in_cb = NULL;	/* handler running for it */
+static struct libusb_transfer	*interrupt_cancelled = NULL;	/* stop waits for it */
+static void	(*interrupt_handler)(usb_ctrl_charbuf buf, int len, void *arg) = NULL;
+static void	*interrupt_arg = NULL;
+
+static void nut_libusb_free_transfer(struct libusb_transfer *transfer)
+{
+	free(transfer->buffer);
+	libusb_free_transfer(transfer);
+}
+
+static void LIBUSB_CALL nut_libusb_interrupt_cb(struct libusb_transfer *transfer)
+{
+	int	ret;
+
+	if (transfer != interrupt_transfer) {
+		upsdebugx(3, "%s: stopped transfer done", __func__);
+		if (transfer == interrupt_cancelled) {
+			interrupt_cancelled = NULL;
+		}
+		nut_libusb_free_transfer(transfer);
+		return;
+	}
+
+	switch (transfer->status)
+	{
+	case LIBUSB_TRANSFER_COMPLETED:
+		upsdebugx(3, "%s: got %d bytes", __func__, transfer->actual_length);
+		if (transfer->actual_length > 0) {
+			interrupt_in_cb = transfer;
+			interrupt_handler((usb_ctrl_charbuf)transfer->buffer,
+				transfer->actual_length, interrupt_arg);
+			interrupt_in_cb = NULL;
+		}
+
+		/* the handler may have stopped us */
+		if (transfer != interrupt_transfer) {
+			nut_libusb_free_transfer(transfer);
+			return;
+		}
+
+		ret = libusb_submit_transfer(transfer);
+		if (ret == LIBUSB_SUCCESS) {
+			return;
+		}
+		upsdebugx(1, "%s: could not resubmit transfer: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		break;
+
+	case LIBUSB_TRANSFER_CANCELLED:
+		upsdebugx(3, "%s: transfer cancelled", __func__);
+		interrupt_pending = 0;
+		return;
+
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		ret = LIBUSB_ERROR_NO_DEVICE;
+		break;
+
+	case LIBUSB_TRANSFER_STALL:
+		/* nut_libusb_get_interrupt() clears the halt when the
+		 * driver falls back to synchronous reads */
+		ret = LIBUSB_ERROR_PIPE;
+		break;
+
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		ret = LIBUSB_ERROR_TIMEOUT;
+		break;
+
+	case LIBUSB_TRANSFER_OVERFLOW:
+		ret = LIBUSB_ERROR_OVERFLOW;
+		break;
+
+	case LIBUSB_TRANSFER_ERROR:
+	default:
+		ret = LIBUSB_ERROR_IO;
+		break;
+	}
+
+	/* no more reads: let the driver decide what to do */
+	interrupt_pending = 0;
+	interrupt_in_cb = transfer;
+	interrupt_handler(NULL, ret, interrupt_arg);
+	interrupt_in_cb = NULL;
+
+	/* the handler may have stopped us */
+	if (transfer != interrupt_transfer) {
+		nut_libusb_free_transfer(transfer);
+	}
+}
+
+static void nut_libusb_stop_interrupt(libusb_device_handle *udev)
+{
+	struct libusb_transfer	*transfer = interrupt_transfer;
+	struct timeval	tv;
+	int	tries, pending = interrupt_pending;
+
+	NUT_UNUSED_VARIABLE(udev);
+
+	if (!transfer) {
+		return;
+	}
+
+	interrupt_transfer = NULL;
+	interrupt_pending = 0;
+
+	/* called from the handler: the callback frees it when done */
+	if (transfer == interrupt_in_cb) {
+		return;
+	}
+
+	if (!pending || libusb_cancel_transfer(transfer) != LIBUSB_SUCCESS) {
+		nut_libusb_free_transfer(transfer);
+		return;
+	}
+
+	/* the transfer may only be freed after its callback saw it
+	 * cancelled; do not wait for that forever though: should it come
+	 * later, that callback frees it without touching the next one */
+	interrupt_cancelled = transfer;
+	for (tries = 0; interrupt_cancelled && tries < 10; tries++) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+	}
+
+	if (interrupt_cancelled) {
+		upsdebugx(1, "%s: transfer not cancelled yet, "
+			"it will be freed when it is", __func__);
+		interrupt_cancelled = NULL;
+	}
+}
+
+static int nut_libusb_start_interrupt(
+	libusb_device_handle *udev,
+	usb_ctrl_charbufsize bufsize,
+	void (*handler)(usb_ctrl_charbuf buf, int len, void *arg),
+	void *arg)
+{
+	unsigned char	*buf;
+	int	ret;
+
+	if (!udev || !handler || bufsize < 1) {
+		return LIBUSB_ERROR_INVALID_PARAM;
+	}
+
+	/* we need the event sources to wait on in the driver main loop,
+	 * and no timeouts to handle besides them */
+	if (!libusb_pollfds_handle_timeouts(NULL)) {
+		upsdebugx(1, "%s: libusb can not be polled on this platform", __func__);
+		return LIBUSB_ERROR_NOT_SUPPORTED;
+	}
+
+	nut_libusb_stop_interrupt(udev);
+
+	interrupt_transfer = libusb_alloc_transfer(0);
+	buf = calloc(1, (size_t)bufsize);
+	if (!interrupt_transfer || !buf) {
+		libusb_free_transfer(interrupt_transfer);
+		interrupt_transfer = NULL;
+		free(buf);
+		return LIBUSB_ERROR_NO_MEM;
+	}
+
+	interrupt_handler = handler;
+	interrupt_arg = arg;
+
+	/* no timeout: the device sends reports when it has news */
+	libusb_fill_interrupt_transfer(interrupt_transfer, udev,
+		LIBUSB_ENDPOINT_IN + usb_subdriver.hid_ep_in,
+		buf, (int)bufsize, nut_libusb_interrupt_cb, NULL, 0);
+
+	ret = libusb_submit_transfer(interrupt_transfer);
+	if (ret != LIBUSB_SUCCESS) {
+		upsdebugx(1, "%s: could not submit transfer: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		free(buf);
+		libusb_free_transfer(interrupt_transfer);
+		interrupt_transfer = NULL;
+		return ret;
+	}
+
+	interrupt_pending = 1;
+	return 0;
+}
+
+/* Fill fds with (up to maxfds of) the descriptors which libusb wants
+ * watched for its events; return how many there are, or -1. Device
+ * descriptors are watched for writing on Linux (usbfs signals reaped
+ * transfers with POLLOUT), the others for reading. */
+static int nut_libusb_get_pollfds(int *fds, int *for_write, int maxfds)
+{
+	const struct libusb_pollfd	**pollfds;
+	int	i;
+
+	pollfds = libusb_get_pollfds(NULL);
+	if (!pollfds) {
+		return -1;
+	}
+
+	for (i = 0; pollfds[i] && i < maxfds; i++) {
+		fds[i] = pollfds[i]->fd;
+#ifdef POLLOUT
+		for_write[i] = (pollfds[i]->events & POLLOUT) ? 1 : 0;
+#else
+		for_write[i] = 0;
+#endif
+	}
+
+	libusb_free_pollfds(pollfds);
+	return i;
+}
+
+/* The descriptors change as devices get opened and closed: the
+ * handlers set here learn about that from libusb */
+static void	(*pollfd_added)(int fd, int for_write, void *arg) = NULL;
+static void	(*pollfd_removed)(int fd, void *arg) = NULL;
+static void	*pollfd_arg = NULL;
+
+static void LIBUSB_CALL nut_libusb_pollfd_added_cb(int fd, short events, void *user_data)
+{
+	int	for_write = 0;
+
+	NUT_UNUSED_VARIABLE(user_data);
+
+#ifdef POLLOUT
+	for_write = (events & POLLOUT) ? 1 : 0;
+#else
+	NUT_UNUSED_VARIABLE(events);
+#endif
+
+	upsdebugx(3, "%s: fd %d", __func__, fd);
+	if (pollfd_added) {
+		pollfd_added(fd, for_write, pollfd_arg);
+	}
+}
+
+static void LIBUSB_CALL nut_libusb_pollfd_removed_cb(int fd, void *user_data)
+{
+	NUT_UNUSED_VARIABLE(user_data);
+
+	upsdebugx(3, "%s: fd %d", __func__, fd);
+	if (pollfd_removed) {
+		pollfd_removed(fd, pollfd_arg);
+	}
+}
+
+static void nut_libusb_set_pollfd_notifiers(
+	void (*added)(int fd, int for_write, void *arg),
+	void (*removed)(int fd, void *arg),
+	void *arg)
+{
+	pollfd_added = added;
+	pollfd_removed = removed;
+	pollfd_arg = arg;
+
+	if (added || removed) {
+		libusb_set_pollfd_notifiers(NULL, nut_libusb_pollfd_added_cb,
+			nut_libusb_pollfd_removed_cb, NULL);
+	} else {
+		libusb_set_pollfd_notifiers(NULL, NULL, NULL, NULL);
+	}
+}
+
+/* Handle the libusb events which are ready, without waiting */
+static int nut_libusb_handle_events(void)
+{
+	struct timeval	tv = { 0, 0 };
+
+	return libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+}
+
+#ifdef NUT_LIBUSB_HOTPLUG
+/* Hotplug notifications: libusb calls us back from handle_events() */
+static libusb_hotplug_callback_handle	hotplug_handle;
+static int	hotplug_registered = 0;
+static void	(*hotplug_handler)(int arrived, void *arg) = NULL;
+static void	*hotplug_arg = NULL;
+
+static int LIBUSB_CALL nut_libusb_hotplug_cb(libusb_context *ctx,
+	libusb_device *device, libusb_hotplug_event event, void *user_data)
+{
+	struct libusb_device_descriptor	dev_desc;
+
+	NUT_UNUSED_VARIABLE(ctx);
+	NUT_UNUSED_VARIABLE(user_data);
+
+	if (libusb_get_device_descriptor(device, &dev_desc) != LIBUSB_SUCCESS) {
+		dev_desc.idVendor = dev_desc.idProduct = 0;
+	}
+
+	/* no device I/O here (libusb forbids it in this callback):
+	 * the driver matches and opens arrivals with open_dev() */
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+		upsdebugx(2, "%s: device %04X/%04X arrived",
+			__func__, dev_desc.idVendor, dev_desc.idProduct);
+		hotplug_handler(1, hotplug_arg);
+	} else if (device == opened_device) {
+		upsdebugx(2, "%s: our device %04X/%04X left",
+			__func__, dev_desc.idVendor, dev_desc.idProduct);
+		opened_device = NULL;
+		hotplug_handler(0, hotplug_arg);
+	}
+
+	return 0;	/* stay registered */
+}
+
+static void nut_libusb_hotplug_deregister(void)
+{
+	if (!hotplug_registered) {
+		return;
+	}
+
+	libusb_hotplug_deregister_callback(NULL, hotplug_handle);
+	hotplug_registered = 0;
+
+	/* drop the reference taken in nut_libusb_hotplug_register() */
+	libusb_exit(NULL);
+}
+
+static int nut_libusb_hotplug_register(
+	USBDevice_t *curDevice,
+	void (*handler)(int arrived, void *arg),
+	void *arg)
+{
+	int	ret, vendor = LIBUSB_HOTPLUG_MATCH_ANY,
+		product = LIBUSB_HOTPLUG_MATCH_ANY;
+
+	if (!handler) {
+		return LIBUSB_ERROR_INVALID_PARAM;
+	}
+
+	nut_libusb_hotplug_deregister();
+
+	/* keep the (default) context alive while the device gets closed
+	 * and reopened: libusb_init() and libusb_exit() count references */
+	if (libusb_init(NULL) < 0) {
+		return LIBUSB_ERROR_OTHER;
+	}
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)
+	 || !libusb_pollfds_handle_timeouts(NULL)
+	) {
+		upsdebugx(1, "%s: no hotplug notifications on this platform", __func__);
+		libusb_exit(NULL);
+		return LIBUSB_ERROR_NOT_SUPPORTED;
+	}
+
+	hotplug_handler = handler;
+	hotplug_arg = arg;
+
+	/* only wake up the driver for devices it may reconnect to */
+	if (curDevice) {
+		vendor = curDevice->VendorID;
+		product = curDevice->ProductID;
+		upsdebugx(2, "%s: watching for devices %04X/%04X",
+			__func__, curDevice->VendorID, curDevice->ProductID);
+	}
+
+	ret = libusb_hotplug_register_callback(NULL,
+		(libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED
+			| LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+		(libusb_hotplug_flag)0,	/* no events for present devices */
+		vendor, product, LIBUSB_HOTPLUG_MATCH_ANY,
+		nut_libusb_hotplug_cb, NULL, &hotplug_handle);
+	if (ret != LIBUSB_SUCCESS) {
+		upsdebugx(1, "%s: could not register callback: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		libusb_exit(NULL);
+		return ret;
+	}
+
+	hotplug_registered = 1;
+	return 0;
+}
+#endif	/* NUT_LIBUSB_HOTPLUG */
+
 static void nut_libusb_close(libusb_device_handle *udev)
 {
 	if (!udev) {
 		return;
 	}
 
+	nut_libusb_stop_interrupt(udev);
+
+	if (libusb_get_device(udev) == opened_device) {
+		opened_device = NULL;
+	}
+
 	/* usb_release_interface() sometimes blocks and goes
 	 * into uninterruptible sleep.  So don't do it.
 	 */
@@ -1149,5 +1551,17 @@ usb_communication_subdriver_t usb_subdriver = {
 	LIBUSB_DEFAULT_INTERFACE,
 	LIBUSB_DEFAULT_DESC_INDEX,
 	LIBUSB_DEFAULT_HID_EP_IN,
-	LIBUSB_DEFAULT_HID_EP_OUT
+	LIBUSB_DEFAULT_HID_EP_OUT,
+	nut_libusb_start_interrupt,
+	nut_libusb_stop_interrupt,
+	nut_libusb_get_pollfds,
+	nut_libusb_set_pollfd_notifiers,
+	nut_libusb_handle_events,
+#ifdef NUT_LIBUSB_HOTPLUG
+	nut_libusb_hotplug_register,
+	nut_libusb_hotplug_deregister
+#else
+	NULL,
+	NULL
+#endif
 };
@@ -1311,6 +1311,21 @@ static int main_arg(char *var, char *val)
 		return 1;	/* handled */
 	}
 
+	/* Allow per-driver overrides of the global setting,
+	 * and allow to reload this too (see dstate_setstat()) */
+	if (!strcmp(var, "statsinterval")) {
+		int	ival = -1;
+
+		if (str_to_int(val, &ival, 10) && ival >= 0) {
+			dstate_setstatsinterval((time_t)ival);
+		} else {
+			upslogx(LOG_WARNING, "UPS [%s]: invalid statsinterval ignored: %s",
+				NUT_STRARG(upsname), NUT_STRARG(val));
+		}
+
+		return 1;	/* handled */
+	}
+
 	/* only for upsdrvctl - ignored here */
 	if (!strcmp(var, "sdorder"))
 		return 1;	/* handled */
@@ -1485,6 +1500,19 @@ static void do_global_args(const char *var, const char *val)
 		return;
 	}
 
+	/* Allow to reload this, why not */
+	if (!strcmp(var, "statsinterval")) {
+		int	ival = -1;
+
+		if (str_to_int(val, &ival, 10) && ival >= 0) {
+			dstate_setstatsinterval((time_t)ival);
+		} else {
+			upslogx(LOG_WARNING, "Invalid statsinterval ignored: %s", val);
+		}
+
+		return;
+	}
+
 	/* Allow to specify its minimal debugging level for all drivers -
 	 * admins can set more with command-line args, but can't set
 	 * less without changing config. Should help debug of services.
@@ -3097,7 +3125,9 @@ sockname_ownership_finished:
 		timeout.tv_sec += poll_interval;
 
 		dstate_setinfo("driver.state", "updateinfo");
+		dstate_batch_begin();
 		upsdrv_updateinfo();
+		dstate_batch_commit();
 		dstate_setinfo("driver.state", "quiet");
 
 		/* Dump the data tree (in upsc-like format) to stdout and exit */
@@ -0,0 +1,172 @@
+/*  modbus_bus.c - sharing a Modbus RTU serial line between NUT drivers
+ *
+ *  Copyright (C)
+ *    2026 Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "main.h"
+#include "modbus_bus.h"
+#include "timehead.h"
+
+#ifndef WIN32
+# include <sys/file.h>
+# if defined(HAVE_SYS_TERMIOS_H)
+#  include <sys/termios.h>
+# else
+#  include <termios.h>
+# endif /* HAVE_SYS_TERMIOS_H */
+#endif	/* !WIN32 */
+
+static int bus_shared = 0;                 /* take the bus for each transaction */
+static int bus_locked = 0;                 /* this driver holds the bus */
+static useconds_t bus_gap = 0;             /* inter-frame delay (us) */
+static struct timeval bus_released;        /* when this driver last released the bus */
+#ifndef WIN32
+static struct termios bus_tio;             /* line settings of this driver */
+#endif	/* !WIN32 */
+
+void modbus_bus_init(modbus_t *ctx, const char *port, int baud)
+{
+#ifndef WIN32
+	int fd = modbus_get_socket(ctx);
+
+	bus_shared = 0;
+
+	if (do_lock_port == 0 || fd < 0) {
+		upsdebugx(2, "modbus_bus_init: %s is not shared", port);
+		return;
+	}
+
+# if (defined HAVE_FLOCK) || (defined HAVE_LOCKF)
+	if (tcgetattr(fd, &bus_tio) != 0) {
+		upslog_with_errno(LOG_WARNING, "modbus_bus_init: tcgetattr(%s)", port);
+		return;
+	}
+
+	/* 3.5 characters of 11 bits, or a fixed 1.75 ms above 19200 baud */
+	if (baud > 0 && baud <= 19200) {
+		bus_gap = (useconds_t)(38500000L / baud);
+	} else {
+		bus_gap = 1750;
+	}
+
+	bus_shared = 1;
+	upsdebugx(2, "modbus_bus_init: sharing %s, inter-frame delay %u us",
+		port, (unsigned int)bus_gap);
+# else
+	NUT_UNUSED_VARIABLE(baud);
+	upslogx(LOG_WARNING, "Warning: no locking method is available, %s can not be shared", port);
+# endif
+#else	/* WIN32 */
+	NUT_UNUSED_VARIABLE(ctx);
+	NUT_UNUSED_VARIABLE(baud);
+	upsdebugx(2, "modbus_bus_init: %s can not be shared on this platform", port);
+#endif	/* WIN32 */
+}
+
+int modbus_bus_lock(modbus_t *ctx)
+{
+#ifndef WIN32
+	int fd = modbus_get_socket(ctx);
+	struct timeval now;
+	struct termios tio;
+	double elapsed;
+	int rval;
+
+	if (!bus_shared || fd < 0) {
+		return -1;
+	}
+
+	/* back off after our own transaction, so that drivers which waited
+	 * for the bus meanwhile take it first: a round-robin between them */
+	if (bus_released.tv_sec != 0) {
+		gettimeofday(&now, NULL);
+		elapsed = difftimeval(now, bus_released) * 1000000.0;
+		if (elapsed >= 0 && elapsed < (double)bus_gap) {
+			usleep(bus_gap - (useconds_t)elapsed);
+		}
+	}
+
+	do {
+# ifdef HAVE_FLOCK
+		rval = flock(fd, LOCK_EX);
+# elif defined(HAVE_LOCKF)
+		lseek(fd, 0L, SEEK_SET);
+		rval = lockf(fd, F_LOCK, 0L);
+# else
+		rval = -1;
+# endif
+	} while (rval != 0 && errno == EINTR);
+
+	if (rval != 0) {
+		upslog_with_errno(LOG_WARNING, "modbus_bus_lock: can not lock the bus");
+		return -1;
+	}
+	bus_locked = 1;
+
+	/* another driver may have left different line settings (e.g. those
+	 * libmodbus restores when it closes the port), or a late answer */
+	if (tcgetattr(fd, &tio) == 0
+	 && (tio.c_cflag != bus_tio.c_cflag || tio.c_iflag != bus_tio.c_iflag
+	  || tio.c_oflag != bus_tio.c_oflag || tio.c_lflag != bus_tio.c_lflag
+	  || cfgetispeed(&tio) != cfgetispeed(&bus_tio)
+	  || cfgetospeed(&tio) != cfgetospeed(&bus_tio))
+	) {
+		upsdebugx(2, "modbus_bus_lock: restoring the line settings");
+		tcsetattr(fd, TCSANOW, &bus_tio);
+	}
+	modbus_flush(ctx);
+
+	return 0;
+#else	/* WIN32 */
+	NUT_UNUSED_VARIABLE(ctx);
+	return -1;
+#endif	/* WIN32 */
+}
+
+void modbus_bus_unlock(modbus_t *ctx)
+{
+#ifndef WIN32
+	int fd = modbus_get_socket(ctx);
+	int saved_errno = errno;	/* of the transaction, for the caller */
+
+	if (!bus_locked) {
+		return;
+	}
+	bus_locked = 0;
+
+	/* the next frame may only start after the line was silent for
+	 * 3.5 characters; this also covers a reconnected (closed) port */
+	usleep(bus_gap);
+
+	if (fd >= 0) {
+# ifdef HAVE_FLOCK
+		flock(fd, LOCK_UN);
+# elif defined(HAVE_LOCKF)
+		lseek(fd, 0L, SEEK_SET);
+		lockf(fd, F_ULOCK, 0L);
+# endif
+	}
+
+	gettimeofday(&bus_released, NULL);
+	errno = saved_errno;
+#else	/* WIN32 */
+	NUT_UNUSED_VARIABLE(ctx);
+#endif	/* WIN32 */
+}
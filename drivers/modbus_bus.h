@@ -0,0 +1,48 @@
+/*  modbus_bus.h - sharing a Modbus RTU serial line between NUT drivers
+ *
+ *  Copyright (C)
+ *    2026 Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef NUT_MODBUS_BUS_H
+#define NUT_MODBUS_BUS_H
+
+#include <modbus.h>
+
+/*
+ * Several drivers may each talk to their own slave on one RS-485 line:
+ * every driver opens the port with its own libmodbus context, and takes
+ * the bus for each transaction with modbus_bus_lock()/modbus_bus_unlock().
+ * The lock is an advisory lock on the serial port, so waiting drivers
+ * are queued by the kernel, and get their turn between the transactions
+ * of the others.
+ */
+
+/* set up bus sharing for an RTU context, after modbus_connect();
+ * disabled by the "nolock" driver flag */
+void modbus_bus_init(modbus_t *ctx, const char *port, int baud);
+
+/* wait for exclusive use of the bus: returns 0, or -1 if not shared */
+int modbus_bus_lock(modbus_t *ctx);
+
+/* keep the line silent for the inter-frame delay, then release the bus;
+ * errno is left as the transaction set it */
+void modbus_bus_unlock(modbus_t *ctx);
+
+#endif /* NUT_MODBUS_BUS_H */
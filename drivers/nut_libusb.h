@@ -114,6 +114,35 @@ typedef struct usb_communication_subdriver_s {
 	usb_ctrl_descindex hid_desc_index;		/* HID descriptor is at this index (non-trivial for composite USB devices); see comments above */
 	usb_ctrl_endpoint hid_ep_in;			/* Input interrupt endpoint. Default is 1	*/
 	usb_ctrl_endpoint hid_ep_out;			/* Output interrupt endpoint. Default is 1	*/
+
+	/* Asynchronous reads of the interrupt endpoint, NULL where the USB
+	 * library does not support them. start_interrupt() keeps a read
+	 * pending and passes each report received to the handler, or a
+	 * negative error code (after which reads stop). The handler gets
+	 * called from handle_events(), which the driver calls when one of
+	 * the descriptors listed by get_pollfds() is ready (for writing if
+	 * the matching for_write entry is set, else for reading). Those
+	 * change as devices get opened and closed; set_pollfd_notifiers()
+	 * has the library call added() and removed() then (NULL handlers
+	 * to stop that). */
+	int (*start_interrupt)(usb_dev_handle *sdev, usb_ctrl_charbufsize bufsize,
+		void (*handler)(usb_ctrl_charbuf buf, int len, void *arg), void *arg);
+	void (*stop_interrupt)(usb_dev_handle *sdev);
+	int (*get_pollfds)(int *fds, int *for_write, int maxfds);
+	void (*set_pollfd_notifiers)(void (*added)(int fd, int for_write, void *arg),
+		void (*removed)(int fd, void *arg), void *arg);
+	int (*handle_events)(void);
+
+	/* Hotplug notifications, NULL where the USB library does not
+	 * support them: once registered, the handler gets called from
+	 * handle_events() when a USB device with the VendorID and ProductID
+	 * of curDevice (any device if NULL) arrives (arrived=1; it was not
+	 * fully matched yet, open_dev() does that), or when the device last
+	 * opened with open_dev() leaves the bus (arrived=0). Returns 0 on
+	 * success. */
+	int (*hotplug_register)(USBDevice_t *curDevice,
+		void (*handler)(int arrived, void *arg), void *arg);
+	void (*hotplug_deregister)(void);
 } usb_communication_subdriver_t;
 
 extern usb_communication_subdriver_t	usb_subdriver;
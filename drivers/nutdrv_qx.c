@@ -44,6 +44,7 @@
 #include "attribute.h"
 #include "nut_float.h"
 #include "nut_stdint.h"
+#include "strmap.h"
 
 /* note: QX_USB/QX_SERIAL set through Makefile */
 #ifdef QX_USB
@@ -159,10 +160,32 @@ static int	hunnox_step = 0;
 static int	is_usb = 0;	/* Whether the device is connected through USB (1) or serial (0) */
 #endif	/* QX_USB && QX_SERIAL */
 
-static struct {
-	char	command[SMALLBUF];	/* Command sent to the UPS to get answer/to execute an instant command */
-	char	answer[SMALLBUF];	/* Answer from the UPS, filled at runtime */
-} previous_item = { "", "" };	/* Hold the values of the item processed just before the actual one */
+/* Answer to a command already sent during the current walk */
+typedef struct {
+	char	answer[SMALLBUF];	/* Answer from the UPS, as preprocessed for the first item which asked for it */
+	int	(*preprocess_command)(item_t *item, char *command, const size_t commandlen);
+	int	(*preprocess_answer)(item_t *item, const int len);
+} qx_answer_t;
+
+static strmap_t	*walk_answers = NULL;	/* qx_answer_t by command, so that each command is sent once per walk */
+
+/* Statistics of a command, for driver.stats.qx.<name>.* */
+typedef struct {
+	char	name[SMALLBUF];	/* Command without its non-alphanumeric characters */
+	double	latency;	/* Seconds it took to get the last answer */
+	size_t	retries;	/* Times it was sent again during a walk, since the first answer was not usable */
+	int	walk_state;	/* QX_QUERY_* for the current walk */
+} qx_cmdstats_t;
+
+#define QX_QUERY_UNSENT		0
+#define QX_QUERY_ANSWERED	1
+#define QX_QUERY_FAILED		2
+
+static strmap_t	*cmdstats = NULL;	/* qx_cmdstats_t by command */
+static qx_cmdstats_t	**cmdstats_list = NULL;
+static size_t	cmdstats_count = 0;
+static size_t	walk_queries = 0;	/* Commands sent during the current walk */
+static size_t	walk_reused = 0;	/* Answers reused during the current walk */
 
 
 /* == Support functions == */
@@ -170,6 +193,7 @@ static int	subdriver_matcher(void);
 static ssize_t	qx_command(const char *cmd, size_t cmdlen, char *buf, size_t buflen);
 static int	qx_process_answer(item_t *item, const size_t len); /* returns just 0 or -1 */
 static bool_t	qx_ups_walk(walkmode_t mode);
+static bool_t	qx_ups_walk_items(walkmode_t mode);
 static void	ups_status_set(void);
 static void	ups_alarm_set(void);
 static void	qx_set_var(item_t *item);
@@ -3644,6 +3668,13 @@ void	upsdrv_cleanup(void)
 
 #endif	/* TESTING */
 
+	strmap_destroy(walk_answers, free);
+	walk_answers = NULL;
+	strmap_destroy(cmdstats, free);
+	cmdstats = NULL;
+	free(cmdstats_list);
+	cmdstats_list = NULL;
+	cmdstats_count = 0;
 }
 
 
@@ -4050,10 +4081,154 @@ static void	qx_set_var(item_t *item)
 	}
 }
 
-/* Walk UPS variables and set elements of the qx2nut array. */
+/* Get (creating them, if needed) the statistics of a command. */
+static qx_cmdstats_t	*qx_cmdstats_get(const char *command)
+{
+	qx_cmdstats_t	*stats;
+	const char	*ptr;
+	size_t	len = 0, i, suffix = 1;
+
+	if (cmdstats == NULL)
+		cmdstats = strmap_create(STRMAP_NOCASE);
+
+	stats = strmap_get(cmdstats, command);
+	if (stats)
+		return stats;
+
+	stats = xcalloc(1, sizeof(*stats));
+	/* Leave room for a '-<number>' suffix, see below */
+	for (ptr = command; *ptr != '\0' && len < sizeof(stats->name) - 24; ptr++) {
+		if (isalnum((unsigned char)*ptr))
+			stats->name[len++] = *ptr;
+	}
+	if (len == 0)
+		len = (size_t)snprintf(stats->name, sizeof(stats->name), "command%" PRIuSIZE, cmdstats_count);
+
+	/* Commands which differ only by non-alphanumeric characters (e.g. 'QS' and 'QS\r')
+	 * would share their variables: number the later ones ('QS-2') */
+	for (i = 0; i < cmdstats_count; i++) {
+		if (strcasecmp(cmdstats_list[i]->name, stats->name))
+			continue;
+
+		snprintf(stats->name + len, sizeof(stats->name) - len, "-%" PRIuSIZE, ++suffix);
+		i = (size_t)-1;	/* check the new name against all of them again */
+	}
+
+	strmap_put(cmdstats, command, stats);
+	cmdstats_list = xrealloc(cmdstats_list, (cmdstats_count + 1) * sizeof(*cmdstats_list));
+	cmdstats_list[cmdstats_count++] = stats;
+
+	return stats;
+}
+
+/* Get the answer of the UPS to the command of item, as previously
+ * preprocessed for an item with the same command and preprocess
+ * functions in this walk, or NULL if none. */
+static const char	*qx_walk_answer_get(const item_t *item)
+{
+	qx_answer_t	*cached;
+
+	if (walk_answers == NULL || item->command == NULL)
+		return NULL;
+
+	cached = strmap_get(walk_answers, item->command);
+	if (cached == NULL
+	||  cached->preprocess_command != item->preprocess_command
+	||  cached->preprocess_answer != item->preprocess_answer
+	)
+		return NULL;
+
+	return cached->answer;
+}
+
+/* Send the command of item to the UPS and process its answer, like
+ * qx_process() does, and keep the answer for the rest of the walk. */
+static int	qx_walk_query(item_t *item)
+{
+	qx_cmdstats_t	*stats;
+	qx_answer_t	*cached;
+	struct timeval	start, end;
+	int	retcode;
+
+	if (item->command == NULL)
+		return qx_process(item, NULL);
+
+	stats = qx_cmdstats_get(item->command);
+	if (stats->walk_state == QX_QUERY_FAILED)
+		stats->retries++;
+	walk_queries++;
+
+	gettimeofday(&start, NULL);
+	retcode = qx_process(item, NULL);
+	gettimeofday(&end, NULL);
+	stats->latency = difftimeval(end, start);
+
+	/* Like before, keep answers which could not be parsed by this
+	 * item: another one may find what it needs in them */
+	if (!strlen(item->answer)) {
+		stats->walk_state = QX_QUERY_FAILED;
+		return retcode;
+	}
+
+	stats->walk_state = QX_QUERY_ANSWERED;
+
+	cached = strmap_get(walk_answers, item->command);
+	if (cached == NULL) {
+		cached = xcalloc(1, sizeof(*cached));
+		strmap_put(walk_answers, item->command, cached);
+	}
+	snprintf(cached->answer, sizeof(cached->answer), "%s", item->answer);
+	cached->preprocess_command = item->preprocess_command;
+	cached->preprocess_answer = item->preprocess_answer;
+
+	return retcode;
+}
+
+/* Walk UPS variables and set elements of the qx2nut array,
+ * sending each command once, and publish the walk statistics. */
 static bool_t	qx_ups_walk(walkmode_t mode)
+{
+	bool_t	ret;
+	size_t	i;
+
+	strmap_destroy(walk_answers, free);
+	walk_answers = strmap_create(STRMAP_NOCASE);
+	walk_queries = 0;
+	walk_reused = 0;
+	for (i = 0; i < cmdstats_count; i++)
+		cmdstats_list[i]->walk_state = QX_QUERY_UNSENT;
+
+	ret = qx_ups_walk_items(mode);
+
+	upsdebugx(2, "%s: %" PRIuSIZE " commands sent, %" PRIuSIZE " answers reused",
+		__func__, walk_queries, walk_reused);
+
+	/* Only published every 'statsinterval' (if at all) */
+	if (!dstate_stats_due())
+		return ret;
+
+	dstate_setstat("driver.stats.qx.queries", "%" PRIuSIZE, walk_queries);
+	dstate_setstat("driver.stats.qx.reused", "%" PRIuSIZE, walk_reused);
+	for (i = 0; i < cmdstats_count; i++) {
+		char	var[SMALLBUF * 2];
+
+		if (cmdstats_list[i]->walk_state == QX_QUERY_UNSENT)
+			continue;
+
+		snprintf(var, sizeof(var), "driver.stats.qx.%s.latency", cmdstats_list[i]->name);
+		dstate_setstat(var, "%.3f", cmdstats_list[i]->latency);
+		snprintf(var, sizeof(var), "driver.stats.qx.%s.retries", cmdstats_list[i]->name);
+		dstate_setstat(var, "%" PRIuSIZE, cmdstats_list[i]->retries);
+	}
+
+	return ret;
+}
+
+/* Walk UPS variables and set elements of the qx2nut array. */
+static bool_t	qx_ups_walk_items(walkmode_t mode)
 {
 	item_t	*item;
+	const char	*answer;
 	int	retcode;
 
 	/* Clear batt.{chrg,runt}.act for guesstimation */
@@ -4063,10 +4238,6 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		battery_voltage_reports_one_pack_considered = 0;
 	}
 
-	/* Clear data from previous_item */
-	memset(previous_item.command, 0, sizeof(previous_item.command));
-	memset(previous_item.answer, 0, sizeof(previous_item.answer));
-
 	/* 3 modes: QX_WALKMODE_INIT, QX_WALKMODE_QUICK_UPDATE
 	 *      and QX_WALKMODE_FULL_UPDATE */
 
@@ -4184,15 +4355,12 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 
 		}
 
-		/* Check whether the previous item uses the same command
-		 * and then use its answer, if available.. */
-		if (strlen(previous_item.command) > 0
-		&&  strlen(previous_item.answer) > 0
-		&&  !strcasecmp(previous_item.command, item->command)
-		) {
+		/* Check whether an item before this one in this walk used
+		 * the same command and then use its answer, if available.. */
+		if ((answer = qx_walk_answer_get(item)) != NULL) {
 
-			snprintf(item->answer, sizeof(item->answer), "%s",
-				previous_item.answer);
+			snprintf(item->answer, sizeof(item->answer), "%s", answer);
+			walk_reused++;
 
 			/* Process the answer */
 			retcode = qx_process_answer(item, strlen(item->answer));
@@ -4200,16 +4368,10 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		/* ..otherwise: execute command to get answer from the UPS */
 		} else {
 
-			retcode = qx_process(item, NULL);
+			retcode = qx_walk_query(item);
 
 		}
 
-		/* Record item as previous_item */
-		snprintf(previous_item.command, sizeof(previous_item.command), "%s",
-			item->command);
-		snprintf(previous_item.answer, sizeof(previous_item.answer), "%s",
-			item->answer);
-
 		if (retcode) {
 
 			/* Clear data from the item */
@@ -24,6 +24,7 @@
 
 #include "main.h"
 #include <modbus.h>
+#include "modbus_bus.h"
 #include "nut_stdint.h"
 #include <stdbool.h>
 
@@ -32,7 +33,7 @@
 #endif
 
 #define DRIVER_NAME	"NUT PhoenixContact Modbus driver (libmodbus link type: " NUT_MODBUS_LINKTYPE_STR ")"
-#define DRIVER_VERSION	"0.09"
+#define DRIVER_VERSION	"0.10"
 
 #define CHECK_BIT(var,pos) ((var) & (1<<(pos)))
 #define MODBUS_SLAVE_ID 192
@@ -163,7 +164,9 @@ static int write_uint32_register(modbus_t *ctx, int reg, uint32_t value)
 	regs[0] = value >> 16;      /*High word*/
 	regs[1] = value & 0xFFFF;   /*Low word*/
 
+	modbus_bus_lock(ctx);
 	ret = modbus_write_registers(ctx, reg, 2, regs);
+	modbus_bus_unlock(ctx);
 	if (ret == -1) {
 		upslogx(LOG_ERR, "Failed to write 32-bit value to reg 0x%04X: %s", (unsigned int)reg, modbus_strerror(errno));
 	}
@@ -175,9 +178,14 @@ static int write_uint32_reg_bit(modbus_t *ctx, int reg, int bit_index, bool bit_
 {
 	uint16_t regs[2];
 	uint32_t val;
+	int ret = 0;
+
+	/* read, modify and write back without another driver in between */
+	modbus_bus_lock(ctx);
 
 	if (modbus_read_registers(ctx, reg, 2, regs) != 2) {
 		upslogx(LOG_ERR, "Failed to read 32-bit register 0x%04X: %s", (unsigned int)reg, modbus_strerror(errno));
+		modbus_bus_unlock(ctx);
 		return -1;
 	}
 
@@ -193,9 +201,11 @@ static int write_uint32_reg_bit(modbus_t *ctx, int reg, int bit_index, bool bit_
 
 	if (modbus_write_registers(ctx, reg, 2, regs) == -1) {
 		upslogx(LOG_ERR, "Failed to write modified 32-bit value to 0x%04X: %s", (unsigned int)reg, modbus_strerror(errno));
-		return -1;
+		ret = -1;
 	}
-	return 0;
+
+	modbus_bus_unlock(ctx);
+	return ret;
 }
 
 static void phoenixcontact_apply_advanced_config(modbus_t *ctx)
@@ -205,6 +215,7 @@ static void phoenixcontact_apply_advanced_config(modbus_t *ctx)
 	write_uint32_reg_bit(ctx, 0x1040, 5, false);
 
 	/* NOTE: you can configure these via override.* or default.* settings */
+	modbus_bus_lock(ctx);
 	modbus_write_register(ctx, REG_PC_SHUTDOWN_DELAY,      GETVAL_U16("battery.energysave.delay",         60));
 	modbus_write_register(ctx, REG_PC_SHUTDOWN_TIME,       GETVAL_U16("ups.timer.shutdown",               60));
 	modbus_write_register(ctx, REG_PC_RESET_TIME,          GETVAL_U16("ups.timer.start",                   5));
@@ -213,6 +224,7 @@ static void phoenixcontact_apply_advanced_config(modbus_t *ctx)
 	modbus_write_register(ctx, REG_VOLTAGE_BELOW_BATTERY,  GETVAL_U16("input.voltage.low.critical",    21000));
 	modbus_write_register(ctx, REG_VOLTAGE_ABOVE_MAINS,    GETVAL_U16("input.voltage.high.critical",   29000));
 	modbus_write_register(ctx, REG_MAINS_RETURN_DELAY,     GETVAL_U16("ups.delay.start",                  10));
+	modbus_bus_unlock(ctx);
 
 	/* the value 0xFFFDFFFF sets bit 17 low so that the mode selector switch is overwritten in software */
 	write_uint32_register(ctx, 0x1076, 0xFFFDFFFF);
@@ -357,7 +369,12 @@ void upsdrv_updateinfo(void)
 	{
 	case QUINT4_UPS:
 		for (i = 0; i < sizeof(delay_params) / sizeof(delay_params[0]); i++) {
-			if (modbus_read_registers(modbus_ctx, delay_params[i].reg_addr, 1, &value) != -1) {
+			int	r;
+
+			modbus_bus_lock(modbus_ctx);
+			r = modbus_read_registers(modbus_ctx, delay_params[i].reg_addr, 1, &value);
+			modbus_bus_unlock(modbus_ctx);
+			if (r != -1) {
 				dstate_setinfo(delay_params[i].nut_name, "%d", value);
 			} else {
 				upslogx(LOG_WARNING, "Failed to read %s (0x%04X): %s",
@@ -833,6 +850,9 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 	}
 
+	/* share the RS-485 line with drivers of other slaves */
+	modbus_bus_init(modbus_ctx, device_path, 115200);
+
 	result = mrir(modbus_ctx, 0x0004, 1, &FWVersion);
 	if (result == -1)
 	{
@@ -856,6 +876,8 @@ void upsdrv_initups(void)
 			fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 		}
 
+		modbus_bus_init(modbus_ctx, device_path, 19200);
+
 		r = mrir(modbus_ctx, 0x0004, 1, &FWVersion);
 
 		if (r < 0)
@@ -882,7 +904,9 @@ void upsdrv_cleanup(void)
 static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
 {
 	int r;
+	modbus_bus_lock(arg_ctx);
 	r = modbus_read_input_registers(arg_ctx, addr, nb, dest);
+	modbus_bus_unlock(arg_ctx);
 	if (r == -1) {
 		upslogx(LOG_ERR, "mrir: modbus_read_input_registers(addr:%d, count:%d): %s (%s)", addr, nb, modbus_strerror(errno), device_path);
 		errcount++;
@@ -41,6 +41,88 @@
 
 	static unsigned int	comm_failures = 0;
 
+/* read buffer of the ser_rbuf_*() methods, one per port that uses them:
+ * what a read() returns past the bytes that were asked for is kept there
+ * for the next call, instead of being lost or read again byte by byte
+ * (the list is not locked: only single-threaded drivers create these) */
+typedef struct ser_rbuf_s {
+	TYPE_FD_SER	fd;
+	size_t	start;		/* offset of the first unread byte */
+	size_t	len;		/* count of unread bytes */
+	unsigned char	data[SER_RBUF_SIZE];
+	struct ser_rbuf_s	*next;
+} ser_rbuf_t;
+
+static ser_rbuf_t	*ser_rbufs = NULL;
+
+static ser_rbuf_t *ser_rbuf_find(TYPE_FD_SER fd, int create)
+{
+	ser_rbuf_t	*rb;
+
+	for (rb = ser_rbufs; rb; rb = rb->next) {
+		if (rb->fd == fd) {
+			return rb;
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	rb = xcalloc(1, sizeof(*rb));
+	rb->fd = fd;
+	rb->next = ser_rbufs;
+	ser_rbufs = rb;
+
+	return rb;
+}
+
+/* drop the bytes read ahead on fd, and its buffer too if 'release' is set */
+static void ser_rbuf_discard(TYPE_FD_SER fd, int release)
+{
+	ser_rbuf_t	*rb, **prev;
+
+	for (prev = &ser_rbufs; (rb = *prev) != NULL; prev = &rb->next) {
+		if (rb->fd != fd) {
+			continue;
+		}
+
+		if (release) {
+			*prev = rb->next;
+			free(rb);
+		} else {
+			rb->start = rb->len = 0;
+		}
+
+		return;
+	}
+}
+
+/* wait for data like select_read(), and append what one read() returns;
+ * with a full buffer this returns 0 without reading */
+static ssize_t ser_rbuf_fill(ser_rbuf_t *rb, time_t d_sec, useconds_t d_usec)
+{
+	ssize_t	ret;
+
+	if (rb->start > 0) {
+		memmove(rb->data, &rb->data[rb->start], rb->len);
+		rb->start = 0;
+	}
+
+	if (rb->len >= sizeof(rb->data)) {
+		return 0;
+	}
+
+	ret = select_read(rb->fd, &rb->data[rb->len], sizeof(rb->data) - rb->len,
+		d_sec, (suseconds_t)d_usec);
+
+	if (ret > 0) {
+		rb->len += (size_t)ret;
+	}
+
+	return ret;
+}
+
 static void ser_open_error(const char *port)
 	__attribute__((noreturn));
 
@@ -198,6 +280,9 @@ int ser_set_speed_nf(TYPE_FD_SER fd, const char *port, speed_t speed)
 	tcflush(fd, TCIFLUSH);
 	tcsetattr(fd, TCSANOW, &tio);
 
+	/* whatever was read ahead came at the old speed */
+	ser_rbuf_discard(fd, 0);
+
 	return 0;
 }
 
@@ -325,6 +410,8 @@ int ser_close(TYPE_FD_SER fd, const char *port)
 #endif	/* WIN32 */
 	}
 
+	ser_rbuf_discard(fd, 1);
+
 	if (close(fd) != 0)
 		return -1;
 
@@ -559,12 +646,198 @@ ssize_t ser_get_line(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
 		d_sec, d_usec);
 }
 
+/* keep reading until buflen bytes are received or a timeout occurs,
+   taking bytes read ahead by the previous ser_rbuf_*() calls first;
+   on timeout, those received so far stay buffered */
+ssize_t ser_rbuf_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec)
+{
+	ser_rbuf_t	*rb = ser_rbuf_find(fd, 1);
+	unsigned char	*data = buf;
+	size_t	recv = 0, n;
+	ssize_t	ret;
+
+	assert(buflen < SSIZE_MAX);
+	memset(buf, '\0', buflen);
+
+	while (recv < buflen) {
+		if (rb->len == 0) {
+			ret = ser_rbuf_fill(rb, d_sec, d_usec);
+
+			if (ret == 0 && recv <= sizeof(rb->data)) {
+				memcpy(rb->data, data, recv);
+				rb->start = 0;
+				rb->len = recv;
+				memset(buf, '\0', buflen);
+			}
+
+			if (ret < 1) {
+				return ret;
+			}
+		}
+
+		n = buflen - recv;
+		if (n > rb->len) {
+			n = rb->len;
+		}
+
+		memcpy(&data[recv], &rb->data[rb->start], n);
+		rb->start += n;
+		rb->len -= n;
+		recv += n;
+	}
+
+	return (ssize_t)recv;
+}
+
+ssize_t ser_rbuf_get_char(TYPE_FD_SER fd, void *ch, time_t d_sec, useconds_t d_usec)
+{
+	return ser_rbuf_get_buf_len(fd, ch, 1, d_sec, d_usec);
+}
+
+/* reads a line up to <endchar> like ser_get_line_alert(), but anything
+   that follows stays buffered for the next ser_rbuf_*() call, and so
+   does the start of a line which timed out (less ignored and alert
+   characters, which were handled already) */
+ssize_t ser_rbuf_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
+	const char *ignset, const char *alertset, void handler(char ch),
+	time_t d_sec, useconds_t d_usec)
+{
+	ser_rbuf_t	*rb = ser_rbuf_find(fd, 1);
+	char	*data = buf, ch;
+	ssize_t	ret, count = 0, maxcount;
+
+	assert(buflen < SSIZE_MAX && buflen > 0);
+	memset(buf, '\0', buflen);
+
+	maxcount = (ssize_t)buflen - 1;		/* for trailing \0 */
+
+	while (count < maxcount) {
+		if (rb->len == 0) {
+			ret = ser_rbuf_fill(rb, d_sec, d_usec);
+
+			if (ret == 0 && (size_t)count <= sizeof(rb->data)) {
+				memcpy(rb->data, data, (size_t)count);
+				rb->start = 0;
+				rb->len = (size_t)count;
+				memset(buf, '\0', buflen);
+			}
+
+			if (ret < 1) {
+				return ret;
+			}
+		}
+
+		ch = (char)rb->data[rb->start++];
+		rb->len--;
+
+		if (ch == endchar) {
+			return count;
+		}
+
+		if (strchr(ignset, ch))
+			continue;
+
+		if (strchr(alertset, ch)) {
+			if (handler)
+				handler(ch);
+
+			continue;
+		}
+
+		data[count++] = ch;
+	}
+
+	return count;
+}
+
+/* as above, only with no alertset handling (just a wrapper) */
+ssize_t ser_rbuf_get_line(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
+	const char *ignset, time_t d_sec, useconds_t d_usec)
+{
+	return ser_rbuf_get_line_alert(fd, buf, buflen, endchar, ignset, "", NULL,
+		d_sec, d_usec);
+}
+
+/* copy up to buflen buffered bytes without consuming them, waiting for
+   data only if nothing is buffered yet */
+ssize_t ser_rbuf_peek(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec)
+{
+	ser_rbuf_t	*rb = ser_rbuf_find(fd, 1);
+	ssize_t	ret;
+
+	assert(buflen < SSIZE_MAX);
+
+	if (rb->len == 0) {
+		ret = ser_rbuf_fill(rb, d_sec, d_usec);
+
+		if (ret < 1) {
+			return ret;
+		}
+	}
+
+	if (buflen > rb->len) {
+		buflen = rb->len;
+	}
+
+	memcpy(buf, &rb->data[rb->start], buflen);
+
+	return (ssize_t)buflen;
+}
+
+/* discard input until the len bytes of str have been read (these too);
+   returns 1 when found, 0 on timeout (of each read), -1 on error */
+int ser_rbuf_expect(TYPE_FD_SER fd, const void *str, size_t len, time_t d_sec, useconds_t d_usec)
+{
+	ser_rbuf_t	*rb = ser_rbuf_find(fd, 1);
+	const unsigned char	*p;
+	ssize_t	ret;
+
+	assert(len > 0 && len <= sizeof(rb->data));
+
+	for (;;) {
+		/* only a partial match can be left at the end of the data */
+		while (rb->len >= len) {
+			p = memchr(&rb->data[rb->start], *(const unsigned char *)str,
+				rb->len - len + 1);
+
+			if (!p) {
+				rb->start += rb->len - len + 1;
+				rb->len = len - 1;
+				break;
+			}
+
+			rb->len -= (size_t)(p - &rb->data[rb->start]);
+			rb->start = (size_t)(p - rb->data);
+
+			if (!memcmp(p, str, len)) {
+				rb->start += len;
+				rb->len -= len;
+				return 1;
+			}
+
+			rb->start++;
+			rb->len--;
+		}
+
+		ret = ser_rbuf_fill(rb, d_sec, d_usec);
+
+		if (ret < 1) {
+			return (int)ret;
+		}
+	}
+}
+
 ssize_t ser_flush_in(TYPE_FD_SER fd, const char *ignset, int verbose)
 {
 	ssize_t	ret, extra = 0;
 	char	ch;
+	int	buffered = (ser_rbuf_find(fd, 0) != NULL);
 
-	while ((ret = ser_get_char(fd, &ch, 0, 0)) > 0) {
+	/* bytes read ahead by the ser_rbuf_*() methods are input too */
+	while ((ret = buffered
+		? ser_rbuf_get_char(fd, &ch, 0, 0)
+		: ser_get_char(fd, &ch, 0, 0)) > 0
+	) {
 
 		if (strchr(ignset, ch))
 			continue;
@@ -585,6 +858,8 @@ ssize_t ser_flush_in(TYPE_FD_SER fd, const char *ignset, int verbose)
 
 int ser_flush_io(TYPE_FD_SER fd)
 {
+	ser_rbuf_discard(fd, 0);
+
 	return tcflush(fd, TCIOFLUSH);
 }
 
@@ -32,6 +32,9 @@
 #define SER_ERR_LIMIT 10	/* start limiting after 10 in a row  */
 #define SER_ERR_RATE 100	/* then only print every 100th error */
 
+/* size of the per-port read buffer of the ser_rbuf_*() methods */
+#define SER_RBUF_SIZE 512
+
 /* porting stuff for WIN32 */
 #ifdef WIN32
 /* TODO : support "open" flags */
@@ -95,6 +98,25 @@ ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endcha
 ssize_t ser_get_line(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
 	const char *ignset, time_t d_sec, useconds_t d_usec);
 
+/* buffered reads: each read() takes as much as is available, and what
+   was not asked for yet (or came before a timeout) is kept for the next
+   ser_rbuf_*() call on this port; do not mix them with the unbuffered ser_get_*() methods, except
+   ser_flush_in() and ser_flush_io() which discard the buffer too */
+ssize_t ser_rbuf_get_char(TYPE_FD_SER fd, void *ch, time_t d_sec, useconds_t d_usec);
+ssize_t ser_rbuf_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec);
+ssize_t ser_rbuf_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
+	const char *ignset, const char *alertset, void handler (char ch),
+	time_t d_sec, useconds_t d_usec);
+ssize_t ser_rbuf_get_line(TYPE_FD_SER fd, void *buf, size_t buflen, char endchar,
+	const char *ignset, time_t d_sec, useconds_t d_usec);
+
+/* copy up to buflen buffered bytes without consuming them */
+ssize_t ser_rbuf_peek(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec);
+
+/* discard input up to and including the len bytes of str:
+   1 when found, 0 on timeout, -1 on error */
+int ser_rbuf_expect(TYPE_FD_SER fd, const void *str, size_t len, time_t d_sec, useconds_t d_usec);
+
 ssize_t ser_flush_in(TYPE_FD_SER fd, const char *ignset, int verbose);
 int ser_flush_io(TYPE_FD_SER fd);
 
@@ -38,6 +38,7 @@
 #include "nut_stdint.h"
 #include "snmp-ups.h"
 #include "parseconf.h"
+#include "strmap.h"
 
 #include <ctype.h> /* for isprint() */
 
@@ -213,11 +214,51 @@ static int outletgroup_template_index_base = -1;
 static int ambient_template_index_base = -1;
 static int device_template_offset = -1;
 
+/* Values fetched during one snmp_ups_walk(), by OID string. The OIDs a
+ * walk asks for are recorded as the plan for the next walk of the same
+ * kind, which fetches them all at once with multi-varbind GET requests;
+ * see nut_snmp_walk_begin() */
+typedef struct {
+	struct snmp_pdu	*pdu;	/* NULL if the agent has no such OID */
+	bool_t	used;	/* asked for by this walk */
+} su_cached_t;
+
+typedef struct {
+	char	**OID;
+	size_t	count;
+	size_t	size;
+} su_walkplan_t;
+
+#define SU_WALKPLAN_INIT	0
+#define SU_WALKPLAN_UPDATE	1
+#define SU_WALKPLAN_SEMISTATIC	2	/* update which refreshes semi-static entries */
+
+static strmap_t	*walk_cache = NULL;
+static su_walkplan_t	walkplan[3], walkplan_next;
+static int	walkplan_current = -1;
+static int	max_varbinds = DEFAULT_MAX_VARBINDS;
+static size_t	snmp_requests = 0;	/* GET/GETNEXT/GETBULK requests sent, in total */
+
+/* Template counts which guesstimate_template_count() got from a complete
+ * walk of a table column, by count variable and template OID, so that
+ * templates with no instances are not probed again on each walk: kept
+ * until the number of daisychained devices changes */
+static strmap_t	*template_counts = NULL;
+static long	template_counts_devices = 0;
+
+/* Index of the snmp_info entries by NUT name for su_find_info(), built
+ * on first use for the current mapping table: the first entry with a
+ * name wins, as with the scan which it replaces */
+static strmap_t	*su_info_index = NULL;
+static snmp_info_t	*su_info_indexed = NULL;
+
 /* sysOID location */
 #define SYSOID_OID	".1.3.6.1.2.1.1.2.0"
 
 /* Forward functions declarations */
 static void disable_transfer_oids(void);
+static void nut_snmp_walkplan_free(su_walkplan_t *plan);
+static bool_t snmp_ups_walk_items(int mode);
 bool_t get_and_process_data(int mode, snmp_info_t *su_info_p);
 int extract_template_number(snmp_info_flags_t template_type, const char* varname);
 snmp_info_flags_t get_template_type(const char* varname);
@@ -409,6 +450,8 @@ void upsdrv_makevartable(void)
 		"Specifies the number of Net-SNMP retries to be used in the requests (default=5)");
 	addvar(VAR_VALUE, SU_VAR_TIMEOUT,
 		"Specifies the Net-SNMP timeout in seconds between retries (default=1)");
+	addvar(VAR_VALUE, SU_VAR_MAXVARBINDS,
+		"Set the maximum number of OIDs requested by one SNMP GET (default=16, 1 to request them one by one)");
 	addvar(VAR_FLAG, "notransferoids",
 		"Disable transfer OIDs (use on APCC Symmetras)");
 	addvar(VAR_FLAG, "symmetrathreephase",
@@ -654,6 +697,14 @@ void upsdrv_initups(void)
 	}
 	semistatic_countdown = semistaticfreq;
 
+	/* init multi-varbind GET size */
+	if (getval(SU_VAR_MAXVARBINDS))
+		max_varbinds = atoi(getval(SU_VAR_MAXVARBINDS));
+	if (max_varbinds < 1) {
+		upsdebugx(1, "Bad %s value provided, setting to default", SU_VAR_MAXVARBINDS);
+		max_varbinds = DEFAULT_MAX_VARBINDS;
+	}
+
 	/* Get UPS Model node to see if there's a MIB */
 /* FIXME: extend and use match_model_OID(char *model) */
 	su_info_p = su_find_info("ups.model");
@@ -1068,6 +1119,16 @@ net-snmp/library/keytools.h:   int    generate_Ku(const oid * hashtype, u_int ha
 
 void nut_snmp_cleanup(void)
 {
+	int	i;
+
+	for (i = 0; i < 3; i++)
+		nut_snmp_walkplan_free(&walkplan[i]);
+	strmap_destroy(template_counts, free);
+	template_counts = NULL;
+	strmap_destroy(su_info_index, NULL);
+	su_info_index = NULL;
+	su_info_indexed = NULL;
+
 	/* close snmp session. */
 	if (g_snmp_sess_p) {
 		snmp_close(g_snmp_sess_p);
@@ -1136,6 +1197,7 @@ static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 
 		snmp_add_null_var(pdu, current_name, current_name_len);
 
+		snmp_requests++;
 		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
 
 		if (!response) {
@@ -1227,19 +1289,352 @@ static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 	return ret_array;
 }
 
+static void nut_snmp_walkplan_free(su_walkplan_t *plan)
+{
+	size_t	i;
+
+	for (i = 0; i < plan->count; i++)
+		free(plan->OID[i]);
+	free(plan->OID);
+	memset(plan, 0, sizeof(*plan));
+}
+
+static void nut_snmp_walkplan_add(su_walkplan_t *plan, const char *OID)
+{
+	if (plan->count == plan->size) {
+		plan->size = plan->size ? 2 * plan->size : 64;
+		plan->OID = xrealloc(plan->OID, plan->size * sizeof(*plan->OID));
+	}
+	plan->OID[plan->count++] = xstrdup(OID);
+}
+
+static void nut_snmp_cached_free(void *value)
+{
+	su_cached_t	*cached = value;
+
+	if (cached->pdu)
+		snmp_free_pdu(cached->pdu);
+	free(cached);
+}
+
+/* cache the value of OID (which is consumed) for the rest of the walk */
+static su_cached_t *nut_snmp_cache_put(const char *OID, struct snmp_pdu *pdu, bool_t used)
+{
+	su_cached_t	*cached = strmap_get(walk_cache, OID);
+
+	if (cached) {
+		/* listed twice in the plan */
+		if (pdu)
+			snmp_free_pdu(pdu);
+		return cached;
+	}
+
+	cached = xcalloc(1, sizeof(*cached));
+	cached->pdu = pdu;
+	cached->used = used;
+	strmap_put(walk_cache, OID, cached);
+
+	if (used)
+		nut_snmp_walkplan_add(&walkplan_next, OID);
+
+	return cached;
+}
+
+/* cache one varbind of a response under OID */
+static void nut_snmp_cache_var(const char *OID, netsnmp_variable_list *var)
+{
+	struct snmp_pdu	*pdu;
+	netsnmp_variable_list	*next;
+
+	if (var->type == SNMP_NOSUCHOBJECT
+	 || var->type == SNMP_NOSUCHINSTANCE
+	 || var->type == SNMP_ENDOFMIBVIEW
+	) {
+		upsdebugx(4, "%s: %s: no such object", __func__, OID);
+		nut_snmp_cache_put(OID, NULL, FALSE);
+		return;
+	}
+
+	pdu = snmp_pdu_create(SNMP_MSG_RESPONSE);
+	if (pdu == NULL) {
+		fatalx(EXIT_FAILURE, "Not enough memory");
+	}
+
+	/* clone just this varbind, not the rest of the list */
+	next = var->next_variable;
+	var->next_variable = NULL;
+	pdu->variables = snmp_clone_varbind(var);
+	var->next_variable = next;
+
+	nut_snmp_cache_put(OID, pdu, FALSE);
+}
+
+/* GET the values of count OIDs with one request (or a few, if the agent
+ * says the response would be too big, or does not know some OID with
+ * SNMPv1) and cache them. Returns -1 if the agent did not answer; the
+ * OIDs left uncached are then requested one by one as the walk needs
+ * them, with the usual error reporting. */
+static int nut_snmp_get_many(char **OID, size_t count)
+{
+	struct snmp_pdu	*pdu, *response;
+	netsnmp_variable_list	*var;
+	oid	name[MAX_OID_LEN];
+	size_t	name_len, i;
+	int	status;
+
+	while (count > 0) {
+		pdu = snmp_pdu_create(SNMP_MSG_GET);
+		if (pdu == NULL) {
+			fatalx(EXIT_FAILURE, "Not enough memory");
+		}
+
+		for (i = 0; i < count; i++) {
+			name_len = MAX_OID_LEN;
+			snmp_parse_oid(OID[i], name, &name_len);
+			snmp_add_null_var(pdu, name, name_len);
+		}
+
+		response = NULL;
+		snmp_requests++;
+		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+
+		if (status != STAT_SUCCESS || response == NULL) {
+			upsdebugx(3, "%s: no answer for %" PRIuSIZE " OIDs (status = %i)",
+				__func__, count, status);
+			if (response)
+				snmp_free_pdu(response);
+			return -1;
+		}
+
+		if (response->errstat == SNMP_ERR_TOOBIG && count > 1) {
+			snmp_free_pdu(response);
+			/* split, and remember it for the next walks */
+			if ((size_t)max_varbinds > count / 2) {
+				max_varbinds = (int)(count / 2);
+				upsdebugx(1, "%s: response too big, now requesting "
+					"at most %i OIDs at once", __func__, max_varbinds);
+			}
+			if (nut_snmp_get_many(OID, count / 2) < 0)
+				return -1;
+			return nut_snmp_get_many(OID + count / 2, count - count / 2);
+		}
+
+		if (response->errstat == SNMP_ERR_NOSUCHNAME
+		 && response->errindex >= 1
+		 && (size_t)response->errindex <= count
+		) {
+			/* SNMPv1 agents fail the whole request for one unknown
+			 * OID, and say which: drop it, and ask for the others */
+			i = (size_t)response->errindex - 1;
+			snmp_free_pdu(response);
+			upsdebugx(4, "%s: %s: no such name", __func__, OID[i]);
+			nut_snmp_cache_put(OID[i], NULL, FALSE);
+			OID[i] = OID[--count];
+			continue;
+		}
+
+		if (response->errstat != SNMP_ERR_NOERROR) {
+			upsdebugx(3, "%s: error %li for %" PRIuSIZE " OIDs",
+				__func__, response->errstat, count);
+			snmp_free_pdu(response);
+			return 0;
+		}
+
+		for (i = 0, var = response->variables;
+			i < count && var != NULL;
+			i++, var = var->next_variable
+		) {
+			nut_snmp_cache_var(OID[i], var);
+		}
+
+		snmp_free_pdu(response);
+		return 0;
+	}
+
+	return 0;
+}
+
+/* Fetch the cells of a table column (the instances of a template OID,
+ * whose last component is their index) from index "first" on, with
+ * GETBULK requests, into the walk cache where nut_snmp_get() then finds
+ * them: "count" cells, or all the cells to the end of the column if
+ * count is 0. Returns how many consecutive indexes from "first" on do
+ * exist, or -1 if this could not be told (SNMPv1 has no GETBULK, or the
+ * agent did not answer), and the caller then probes them one by one. */
+static int nut_snmp_get_column(const char *column, int first, int count)
+{
+	struct snmp_pdu	*pdu, *response;
+	netsnmp_variable_list	*var;
+	oid	prefix[MAX_OID_LEN], start[MAX_OID_LEN];
+	size_t	prefix_len = MAX_OID_LEN, start_len;
+	char	cell[SU_INFOSIZE];
+	int	status, found = 0, fetched = 0, expected = first;
+	bool_t	done = FALSE, contiguous = TRUE;
+
+	if (walk_cache == NULL || g_snmp_sess_p == NULL
+	 || g_snmp_sess_p->version == SNMP_VERSION_1
+	 || max_varbinds < 2
+	)
+		return -1;
+
+	if (!snmp_parse_oid(column, prefix, &prefix_len) || prefix_len >= MAX_OID_LEN)
+		return -1;
+
+	/* GETBULK returns the OIDs which follow the one we ask for */
+	memcpy(start, prefix, prefix_len * sizeof(oid));
+	start_len = prefix_len;
+	if (first > 0)
+		start[start_len++] = (oid)(first - 1);
+
+	while (!done && (count == 0 || fetched < count)) {
+		pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+		if (pdu == NULL) {
+			fatalx(EXIT_FAILURE, "Not enough memory");
+		}
+
+		pdu->non_repeaters = 0;
+		pdu->max_repetitions = (count == 0 || count - fetched > max_varbinds)
+			? max_varbinds : count - fetched;
+		snmp_add_null_var(pdu, start, start_len);
+
+		response = NULL;
+		snmp_requests++;
+		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+
+		if (status != STAT_SUCCESS || response == NULL
+		 || response->errstat != SNMP_ERR_NOERROR
+		 || response->variables == NULL
+		) {
+			upsdebugx(3, "%s: %s: no answer (status = %i)",
+				__func__, column, status);
+			if (response)
+				snmp_free_pdu(response);
+			return -1;
+		}
+
+		for (var = response->variables; var != NULL; var = var->next_variable) {
+			if (var->type == SNMP_ENDOFMIBVIEW
+			 || var->name_length != prefix_len + 1
+			 || memcmp(var->name, prefix, prefix_len * sizeof(oid))
+			 || snmp_oid_compare(var->name, var->name_length, start, start_len) <= 0
+			) {
+				/* past the end of the column */
+				done = TRUE;
+				break;
+			}
+
+			snprintf(cell, sizeof(cell), "%s.%lu",
+				column, (unsigned long)var->name[prefix_len]);
+			nut_snmp_cache_var(cell, var);
+			fetched++;
+
+			if (contiguous && var->name[prefix_len] == (oid)expected) {
+				found++;
+				expected++;
+			} else {
+				contiguous = FALSE;
+			}
+
+			memcpy(start, var->name, var->name_length * sizeof(oid));
+			start_len = var->name_length;
+		}
+
+		snmp_free_pdu(response);
+	}
+
+	/* We went past the first missing index, so the agent has no such cell */
+	if (done || !contiguous) {
+		snprintf(cell, sizeof(cell), "%s.%i", column, expected);
+		nut_snmp_cache_put(cell, NULL, FALSE);
+	}
+
+	upsdebugx(2, "%s: %s: %i cells from index %i on", __func__,
+		column, found, first);
+
+	return found;
+}
+
+/* Start caching the values of the OIDs asked for during a walk, and
+ * fetch those which the previous walk of the same kind asked for in as
+ * few requests as possible */
+static void nut_snmp_walk_begin(int plan)
+{
+	char	**batch;
+	oid	name[MAX_OID_LEN];
+	size_t	name_len, i, n = 0, chunk, requests = snmp_requests;
+
+	walk_cache = strmap_create(0);
+	walkplan_current = plan;
+	memset(&walkplan_next, 0, sizeof(walkplan_next));
+
+	if (max_varbinds < 2 || walkplan[plan].count == 0)
+		return;
+
+	batch = xcalloc(walkplan[plan].count, sizeof(*batch));
+	for (i = 0; i < walkplan[plan].count; i++) {
+		name_len = MAX_OID_LEN;
+		if (snmp_parse_oid(walkplan[plan].OID[i], name, &name_len)) {
+			batch[n++] = walkplan[plan].OID[i];
+		} else {
+			nut_snmp_cache_put(walkplan[plan].OID[i], NULL, FALSE);
+		}
+	}
+
+	for (i = 0; i < n; i += chunk) {
+		/* all of the chunk gets fetched, even if a response
+		 * too big lowers max_varbinds for the next ones */
+		chunk = n - i < (size_t)max_varbinds ? n - i : (size_t)max_varbinds;
+		if (nut_snmp_get_many(batch + i, chunk) < 0) {
+			break;
+		}
+	}
+
+	free(batch);
+
+	upsdebugx(2, "%s: fetched %" PRIuSIZE " OIDs with %" PRIuSIZE " requests",
+		__func__, strmap_count(walk_cache), snmp_requests - requests);
+}
+
+static void nut_snmp_walk_end(void)
+{
+	strmap_destroy(walk_cache, nut_snmp_cached_free);
+	walk_cache = NULL;
+
+	/* the OIDs to fetch up front next time */
+	nut_snmp_walkplan_free(&walkplan[walkplan_current]);
+	walkplan[walkplan_current] = walkplan_next;
+	memset(&walkplan_next, 0, sizeof(walkplan_next));
+	walkplan_current = -1;
+}
+
 struct snmp_pdu *nut_snmp_get(const char *OID)
 {
 	struct snmp_pdu ** pdu_array;
 	struct snmp_pdu * ret_pdu;
+	su_cached_t	*cached;
 
 	if (OID == NULL)
 		return NULL;
 
 	upsdebugx(3, "%s(%s)", __func__, OID);
 
+	/* Already fetched during this walk? */
+	if (walk_cache != NULL
+	 && (cached = strmap_get(walk_cache, OID)) != NULL
+	) {
+		if (!cached->used) {
+			cached->used = TRUE;
+			nut_snmp_walkplan_add(&walkplan_next, OID);
+		}
+		upsdebugx(4, "%s: %s cached", __func__, OID);
+		return cached->pdu ? snmp_clone_pdu(cached->pdu) : NULL;
+	}
+
 	pdu_array = nut_snmp_walk(OID,1);
 
 	if(pdu_array == NULL) {
+		if (walk_cache != NULL)
+			nut_snmp_cache_put(OID, NULL, TRUE);
 		return NULL;
 	}
 
@@ -1247,6 +1642,9 @@ struct snmp_pdu *nut_snmp_get(const char *OID)
 
 	nut_snmp_free(pdu_array);
 
+	if (walk_cache != NULL && ret_pdu != NULL)
+		nut_snmp_cache_put(OID, snmp_clone_pdu(ret_pdu), TRUE);
+
 	return ret_pdu;
 }
 
@@ -1828,15 +2226,28 @@ snmp_info_t *su_find_info(const char *type)
 		fatalx(EXIT_FAILURE, "%s: snmp_info is not initialized", __func__);
 	}
 
-	if (snmp_info[0].info_type == NULL) {
-		upsdebugx(1, "%s: WARNING: snmp_info is empty", __func__);
-	}
+	if (su_info_indexed != snmp_info) {
+		if (snmp_info[0].info_type == NULL) {
+			upsdebugx(1, "%s: WARNING: snmp_info is empty", __func__);
+		}
 
-	for (su_info_p = &snmp_info[0]; (su_info_p != NULL && su_info_p->info_type != NULL) ; su_info_p++)
-		if (!strcasecmp(su_info_p->info_type, type)) {
-			upsdebugx(3, "%s: \"%s\" found", __func__, type);
-			return su_info_p;
+		strmap_destroy(su_info_index, NULL);
+		su_info_index = strmap_create(STRMAP_NOCASE);
+		for (su_info_p = &snmp_info[0]; su_info_p->info_type != NULL; su_info_p++) {
+			if (strmap_get(su_info_index, su_info_p->info_type) == NULL)
+				strmap_put(su_info_index, su_info_p->info_type, su_info_p);
 		}
+		su_info_indexed = snmp_info;
+
+		upsdebugx(3, "%s: indexed %" PRIuSIZE " names", __func__,
+			strmap_count(su_info_index));
+	}
+
+	su_info_p = strmap_get(su_info_index, type);
+	if (su_info_p != NULL) {
+		upsdebugx(3, "%s: \"%s\" found", __func__, type);
+		return su_info_p;
+	}
 
 	upsdebugx(3, "%s: unknown info type (%s)", __func__, type);
 	return NULL;
@@ -2453,24 +2864,72 @@ static int base_snmp_template_index(const snmp_info_t *su_info_p)
 	return base_index;
 }
 
+/* Check that two instances of a template, for index and index + 1, only
+ * differ by their last component, which is that index: then they are
+ * cells of a table column, whose OID is put into column */
+static bool_t template_column(const char *OID0, const char *OID1, int index, char *column, size_t len)
+{
+	const char	*dot0 = strrchr(OID0, '.'), *dot1 = strrchr(OID1, '.');
+	char	cell[SU_BUFSIZE];
+	size_t	prefix_len;
+
+	if (dot0 == NULL || dot1 == NULL)
+		return FALSE;
+
+	prefix_len = (size_t)(dot0 - OID0);
+	if (prefix_len != (size_t)(dot1 - OID1) || prefix_len >= len
+	 || strncmp(OID0, OID1, prefix_len)
+	)
+		return FALSE;
+
+	snprintf(cell, sizeof(cell), ".%i", index);
+	if (strcmp(dot0, cell))
+		return FALSE;
+
+	snprintf(cell, sizeof(cell), ".%i", index + 1);
+	if (strcmp(dot1, cell))
+		return FALSE;
+
+	memcpy(column, OID0, prefix_len);
+	column[prefix_len] = '\0';
+
+	return TRUE;
+}
+
 /* Try to determine the number of items (outlets, outlet groups, ...),
  * using a template definition. Walk through the template until we can't
- * get anymore values. I.e., if we can iterate up to 8 item, return 8 */
-static int guesstimate_template_count(snmp_info_t *su_info_p)
+ * get anymore values. I.e., if we can iterate up to 8 item, return 8.
+ * If walked is not NULL, it tells whether the whole table column could
+ * be walked, so the result is not due to a failed request. */
+static int guesstimate_template_count(snmp_info_t *su_info_p, bool_t *walked)
 {
 	int base_index = 0;
-	char test_OID[SU_INFOSIZE];
+	char test_OID[SU_INFOSIZE], next_OID[SU_INFOSIZE], column[SU_INFOSIZE];
 	int base_count;
 	const char *OID_template = su_info_p->OID;
 
 	upsdebugx(1, "%s(%s)", __func__, OID_template);
 
+	if (walked != NULL)
+		*walked = FALSE;
+
 	/* Test if OID is indexed: safeguard for infinite loop */
 	if (strchr(OID_template, '%') == NULL) {
 		upsdebugx(3, "Warning: non-indexed object, discarding (OID = %s)", OID_template);
 		return 0;
 	}
 
+	/* If the template is a table column, get it all with GETBULK:
+	 * the probes below then find the cells in the walk cache */
+	snprintf_dynamic(test_OID, sizeof(test_OID), OID_template, "%i", 0);
+	snprintf_dynamic(next_OID, sizeof(next_OID), OID_template, "%i", 1);
+	if (template_column(test_OID, next_OID, 0, column, sizeof(column))
+	 && nut_snmp_get_column(column, 0, 0) >= 0
+	 && walked != NULL
+	) {
+		*walked = TRUE;
+	}
+
 	/* Determine if OID index starts from 0 or 1? */
 	snprintf_dynamic(test_OID, sizeof(test_OID), OID_template, "%i", base_index);
 
@@ -2497,6 +2956,106 @@ static int guesstimate_template_count(snmp_info_t *su_info_p)
 	return base_count;
 }
 
+static int template_count_get(const char *count_var, const char *OID_template)
+{
+	char	key[SU_INFOSIZE * 2];
+	int	*count;
+
+	if (template_counts == NULL || template_counts_devices != devices_count) {
+		strmap_destroy(template_counts, free);
+		template_counts = strmap_create(0);
+		template_counts_devices = devices_count;
+	}
+
+	snprintf(key, sizeof(key), "%s %s", count_var, OID_template);
+	count = strmap_get(template_counts, key);
+
+	return count ? *count : -1;
+}
+
+static void template_count_set(const char *count_var, const char *OID_template, int count)
+{
+	char	key[SU_INFOSIZE * 2];
+	int	*value = xmalloc(sizeof(*value));
+
+	*value = count;
+	snprintf(key, sizeof(key), "%s %s", count_var, OID_template);
+	free(strmap_put(template_counts, key, value));
+}
+
+/* Format the OID of an instance of a template
+ * type: outlet, outlet.group, device */
+static void template_instance_OID(const char *type, const snmp_info_t *su_info_p,
+	int cur_template_number, char *OID, size_t len)
+{
+	/* Special processing for daisychain */
+	if (!strncmp(type, "device", 6)) {
+		if (current_device_number > 0) {
+			snprintf_dynamic(OID, len, su_info_p->OID, "%i", current_device_number + device_template_offset);
+		}
+		/*else
+		 * FIXME: daisychain-whole, what to do?
+		 */
+	}
+	else {
+		/* Special processing for daisychain:
+		 * these outlet | outlet groups also include formatting info,
+		 * so we have to check if the daisychain is enabled, and if
+		 * the formatting info for it are in 1rst or 2nd position */
+		if (daisychain_enabled == TRUE) {
+			if (su_info_p->flags & SU_TYPE_DAISY_1) {
+				snprintf_dynamic(OID, len,
+					su_info_p->OID, "%i%i",
+					current_device_number + device_template_offset,
+					cur_template_number);
+			}
+			else if (su_info_p->flags & SU_TYPE_DAISY_2) {
+				snprintf_dynamic(OID, len,
+					su_info_p->OID, "%i%i",
+					cur_template_number + device_template_offset,
+					current_device_number - device_template_offset);
+			}
+			else {
+				/* Note: no device daisychain templating (SU_TYPE_DAISY_MASTER_ONLY)! */
+				snprintf_dynamic(OID, len,
+					su_info_p->OID, "%i",
+					cur_template_number);
+			}
+		}
+		else {
+			snprintf_dynamic(OID, len,
+					su_info_p->OID, "%i",
+					cur_template_number);
+		}
+	}
+}
+
+/* Get all the instances of a template which process_template() is about
+ * to walk with GETBULK requests, if they are the cells of a table column
+ * and were not fetched yet */
+static void template_prefetch(const char *type, const snmp_info_t *su_info_p,
+	int base_index, int count)
+{
+	char	OID0[SU_INFOSIZE] = "", OID1[SU_INFOSIZE] = "", last[SU_INFOSIZE] = "";
+	char	column[SU_INFOSIZE];
+
+	if (walk_cache == NULL || su_info_p->OID == NULL
+	 || SU_TYPE(su_info_p) == SU_TYPE_CMD || count < 2
+	)
+		return;
+
+	template_instance_OID(type, su_info_p, base_index, OID0, sizeof(OID0));
+	template_instance_OID(type, su_info_p, base_index + 1, OID1, sizeof(OID1));
+
+	/* already fetched, e.g. by the walk plan */
+	template_instance_OID(type, su_info_p, base_index + count - 1, last, sizeof(last));
+	if (strmap_get(walk_cache, last) != NULL)
+		return;
+
+	if (template_column(OID0, OID1, base_index, column, sizeof(column)))
+		nut_snmp_get_column(column, base_index, count);
+}
+
 /* Process template definition, instantiate and get data or register
  * command
  * type: outlet, outlet.group, device */
@@ -2528,7 +3087,15 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 		/* FIXME: should we disable it?
 		 * su_info_p->flags &= ~SU_FLAG_OK;
 		 * or rely on guesstimation? */
-		template_count = guesstimate_template_count(su_info_p);
+		template_count = template_count_get(template_count_var, su_info_p->OID);
+		if (template_count < 0) {
+			bool_t	walked;
+
+			template_count = guesstimate_template_count(su_info_p, &walked);
+			if (walked == TRUE) {
+				template_count_set(template_count_var, su_info_p->OID, template_count);
+			}
+		}
 		/* Publish the count estimation */
 		if (template_count > 0) {
 			dstate_setinfo(template_count_var, "%i", template_count);
@@ -2546,6 +3113,9 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 
 		base_snmp_index = base_snmp_template_index(su_info_p);
 
+		/* get all the instances at once, if we can */
+		template_prefetch(type, su_info_p, base_snmp_index, template_count);
+
 		for (cur_template_number = base_snmp_index ;
 				cur_template_number < (template_count + base_snmp_index) ;
 				cur_template_number++)
@@ -2655,46 +3225,8 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 			}
 
 			if (cur_info_p.OID != NULL) {
-				/* Special processing for daisychain */
-				if (!strncmp(type, "device", 6)) {
-					if (current_device_number > 0) {
-						snprintf_dynamic((char *)cur_info_p.OID, SU_INFOSIZE, su_info_p->OID, "%i", current_device_number + device_template_offset);
-					}
-					/*else
-					 * FIXME: daisychain-whole, what to do?
-					 */
-				}
-				else {
-					/* Special processing for daisychain:
-					 * these outlet | outlet groups also include formatting info,
-					 * so we have to check if the daisychain is enabled, and if
-					 * the formatting info for it are in 1rst or 2nd position */
-					if (daisychain_enabled == TRUE) {
-						if (su_info_p->flags & SU_TYPE_DAISY_1) {
-							snprintf_dynamic((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, "%i%i",
-								current_device_number + device_template_offset,
-								cur_template_number);
-						}
-						else if (su_info_p->flags & SU_TYPE_DAISY_2) {
-							snprintf_dynamic((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, "%i%i",
-								cur_template_number + device_template_offset,
-								current_device_number - device_template_offset);
-						}
-						else {
-							/* Note: no device daisychain templating (SU_TYPE_DAISY_MASTER_ONLY)! */
-							snprintf_dynamic((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, "%i",
-								cur_template_number);
-						}
-					}
-					else {
-						snprintf_dynamic((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, "%i",
-								cur_template_number);
-					}
-				}
+				template_instance_OID(type, su_info_p, cur_template_number,
+					(char *)cur_info_p.OID, SU_INFOSIZE);
 
 				/* add instant commands to the info database. */
 				if (SU_TYPE(su_info_p) == SU_TYPE_CMD) {
@@ -2900,7 +3432,7 @@ bool_t daisychain_init(void)
 		 * the number of devices present */
 		else
 		{
-			devices_count = guesstimate_template_count(su_info_p);
+			devices_count = guesstimate_template_count(su_info_p, NULL);
 			upsdebugx(1, "Guesstimation: there are %ld device(s) present", devices_count);
 		}
 
@@ -3097,6 +3629,37 @@ static int process_phase_data(const char* type, long *nb_phases, snmp_info_t *su
 
 /* walk ups variables and set elements of the info array. */
 bool_t snmp_ups_walk(int mode)
+{
+	bool_t	status;
+	size_t	requests = snmp_requests;
+
+	if (mode == SU_WALKMODE_UPDATE) {
+		semistatic_countdown--;
+		if (semistatic_countdown < 0)
+			semistatic_countdown = semistaticfreq;
+	}
+
+	nut_snmp_walk_begin(mode == SU_WALKMODE_INIT ? SU_WALKPLAN_INIT
+		: semistatic_countdown == 0 ? SU_WALKPLAN_SEMISTATIC
+		: SU_WALKPLAN_UPDATE);
+
+	status = snmp_ups_walk_items(mode);
+
+	nut_snmp_walk_end();
+
+	upsdebugx(2, "%s: %" PRIuSIZE " SNMP requests", __func__,
+		snmp_requests - requests);
+	dstate_setstat("driver.stats.snmp.requests", "%" PRIuSIZE,
+		snmp_requests - requests);
+	dstate_setstat("driver.stats.snmp.requests.total", "%" PRIuSIZE,
+		snmp_requests);
+
+	return status;
+}
+
+/* walk the mapping entries, getting their values from the agent (or
+ * from the values nut_snmp_walk_begin() fetched up front) */
+static bool_t snmp_ups_walk_items(int mode)
 {
 	long *walked_input_phases, *walked_output_phases, *walked_bypass_phases;
 #ifdef COUNT_ITERATIONS
@@ -3106,12 +3669,6 @@ bool_t snmp_ups_walk(int mode)
 	snmp_info_t *su_info_p;
 	bool_t status = FALSE;
 
-	if (mode == SU_WALKMODE_UPDATE) {
-		semistatic_countdown--;
-		if (semistatic_countdown < 0)
-			semistatic_countdown = semistaticfreq;
-	}
-
 	/* Loop through all device(s) */
 	/* Note: considering "unitary" and "daisy-chained" devices, we have
 	 * several variables (and their values) that can come into play:
@@ -139,6 +139,7 @@
 #define DEFAULT_NETSNMP_RETRIES   5
 #define DEFAULT_NETSNMP_TIMEOUT   1    /* in seconds */
 #define DEFAULT_SEMISTATICFREQ    10   /* in snmpwalk update cycles */
+#define DEFAULT_MAX_VARBINDS      16   /* OIDs per GET request */
 
 /* use explicit booleans */
 #ifndef FALSE
@@ -367,6 +368,7 @@ typedef struct {
 #define SU_VAR_VERSION		"snmp_version"
 #define SU_VAR_RETRIES		"snmp_retries"
 #define SU_VAR_TIMEOUT		"snmp_timeout"
+#define SU_VAR_MAXVARBINDS	"snmp_max_varbinds"
 #define SU_VAR_SEMISTATICFREQ	"semistaticfreq"
 #define SU_VAR_MIBS			"mibs"
 #define SU_VAR_POLLFREQ		"pollfreq"
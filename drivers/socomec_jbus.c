@@ -29,13 +29,14 @@
 
 #include "main.h"
 #include <modbus.h>
+#include "modbus_bus.h"
 
 #if !(defined NUT_MODBUS_LINKTYPE_STR)
 # define NUT_MODBUS_LINKTYPE_STR	"unknown"
 #endif
 
 #define DRIVER_NAME	"Socomec jbus driver (libmodbus link type: " NUT_MODBUS_LINKTYPE_STR ")"
-#define DRIVER_VERSION	"0.09"
+#define DRIVER_VERSION	"0.10"
 
 #define CHECK_BIT(var,pos) ((var) & (1<<(pos)))
 #define MODBUS_SLAVE_ID 1
@@ -448,21 +449,34 @@ void upsdrv_help(void)
 /* list flags and values that you want to receive via -x */
 void upsdrv_makevartable(void)
 {
+	addvar(VAR_VALUE, "slaveid", "Modbus slave id (default=1)");
 }
 
 void upsdrv_initups(void)
 {
 	int r;
+	char *val, *end;
+	long slaveid = MODBUS_SLAVE_ID;
 	upsdebugx(2, "upsdrv_initups");
 
+	/* 0 is the broadcast address, and above 247 are reserved:
+	 * neither addresses a single device on a shared line */
+	val = getval("slaveid");
+	if (val) {
+		errno = 0;
+		slaveid = strtol(val, &end, 10);
+		if (errno || end == val || *end != '\0' || slaveid < 1 || slaveid > 247)
+			fatalx(EXIT_FAILURE, "Invalid slaveid '%s', must be a number from 1 to 247", val);
+	}
+
 	modbus_ctx = modbus_new_rtu(device_path, 9600, 'N', 8, 1);
 	if (modbus_ctx == NULL)
 		fatalx(EXIT_FAILURE, "Unable to create the libmodbus context");
 
-	r = modbus_set_slave(modbus_ctx, MODBUS_SLAVE_ID);	/* slave ID */
+	r = modbus_set_slave(modbus_ctx, (int)slaveid);	/* slave ID */
 	if (r < 0) {
 		modbus_free(modbus_ctx);
-		fatalx(EXIT_FAILURE, "Invalid modbus slave ID %d",MODBUS_SLAVE_ID);
+		fatalx(EXIT_FAILURE, "Invalid modbus slave ID %ld", slaveid);
 	}
 
 	if (modbus_connect(modbus_ctx) == -1) {
@@ -470,6 +484,8 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 	}
 
+	/* share the serial line with the drivers of other slaves */
+	modbus_bus_init(modbus_ctx, device_path, 9600);
 }
 
 void upsdrv_cleanup(void)
@@ -491,7 +507,9 @@ static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
 	}
 
 	/*r = modbus_read_input_registers(arg_ctx, addr, nb, dest);*/
+	modbus_bus_lock(arg_ctx);
 	r = modbus_read_registers(arg_ctx, addr, nb, dest);
+	modbus_bus_unlock(arg_ctx);
 	if (r == -1) {
 		upslogx(LOG_ERR, "mrir: modbus_read_input_registers(addr:%d, count:%d): %s (%s)", addr, nb, modbus_strerror(errno), device_path);
 	}
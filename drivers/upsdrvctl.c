@@ -41,6 +41,21 @@
 #include "main.h"
 #include "upsdrvquery.h"
 
+#ifndef WIN32
+	/* progress of a driver in start_all_drivers() */
+typedef enum {
+	STARTJOB_PENDING = 0,	/* not launched yet, or waiting to retry */
+	STARTJOB_RUNNING,	/* launched, waiting for it to detach */
+	STARTJOB_STARTED,
+	STARTJOB_FAILED,
+	STARTJOB_TIMEOUT,
+	STARTJOB_SKIPPED	/* maxretry=0 */
+} startjob_t;
+
+	/* how often start_all_drivers() checks on launched drivers (usec) */
+#define STARTJOB_POLL	100000
+#endif	/* !WIN32 */
+
 typedef struct {
 	char	*upsname;
 	char	*driver;
@@ -52,6 +67,12 @@ typedef struct {
 	int	exceeded_timeout;
 #ifndef WIN32
 	pid_t	pid;
+
+	/* parallel start: state, attempts made, and when the first and
+	 * current attempts began, when it settled, or when to retry */
+	startjob_t	startjob;
+	int	startattempts;
+	struct timeval	startfirst, startlast, startdone, startretry;
 #else	/* WIN32 */
 	int	pid;	/* for WIN32 used just as a flag that this UPS was started by this tool in this run */
 #endif	/* WIN32 */
@@ -82,6 +103,18 @@ static int	maxretry = 1;
 	 */
 static int	retrydelay = 5;
 
+	/* counter - how many drivers "upsdrvctl start" may launch and wait
+	 * for at the same time; 1 starts them one by one in ups.conf order
+	 * NOTE: Default value is also documented in man page
+	 */
+static int	maxstartjobs = 1;
+
+#ifndef WIN32
+	/* set while start_all_drivers() launches drivers: forkexec() then
+	 * only forks, and leaves the waiting to that loop */
+static int	startjobs_active = 0;
+#endif	/* !WIN32 */
+
 	/* Directory where driver executables live */
 static char	*driverpath = NULL;
 
@@ -132,6 +165,14 @@ void do_upsconf_args(char *arg_upsname, char *var, char *val)
 		if (!strcmp(var, "retrydelay"))
 			retrydelay = atoi(val);
 
+		if (!strcmp(var, "maxstartjobs")) {
+			maxstartjobs = atoi(val);
+			if (maxstartjobs < 1) {
+				upsdebugx(0, "NOTE: invalid 'maxstartjobs' setting ignored: %s", NUT_STRARG(val));
+				maxstartjobs = 1;
+			}
+		}
+
 		if (!strcmp(var, "nowait")) {
 			char * s = getenv("NUT_IGNORE_NOWAIT");
 			if (s && !strcmp(s, "true")) {
@@ -700,6 +741,13 @@ static void forkexec(char *const argv[], const ups_t *ups)
 				return;
 			}
 
+			/* start_all_drivers() waits for it along with others */
+			if (startjobs_active) {
+				upsdebugx(2, "Launched driver PID %" PRIdMAX
+					", continuing...", (intmax_t)pid);
+				return;
+			}
+
 			if (nut_foreground_passthrough > 0 && upscount > 1) {
 				/* Let upsdrvctl fork to run its numerous children
 				 * but without further forking on their side - so
@@ -1349,6 +1397,246 @@ static void send_one_driver(void (*command_func)(const ups_t *), const char *arg
 	fatalx(EXIT_FAILURE, "UPS %s not found in ups.conf", arg_upsname);
 }
 
+#ifndef WIN32
+/* clone* and failover drivers talk to the drivers named in their "port"
+ * (socket names like "drivername-upsname", comma-separated for failover),
+ * so a parallel start launches them after those drivers have settled;
+ * this follows how nut-driver-enumerator orders such services */
+static int start_depends_on(const ups_t *ups, const ups_t *other)
+{
+	char	sockname[SMALLBUF];
+	const char	*p;
+	size_t	len, toklen;
+
+	if (ups == other || !ups->driver || !ups->port || !other->driver
+	 || (!strstr(ups->driver, "clone") && strcmp(ups->driver, "failover"))
+	) {
+		return 0;
+	}
+
+	snprintf(sockname, sizeof(sockname), "%s-%s", other->driver, other->upsname);
+	len = strlen(sockname);
+
+	p = ups->port;
+	while (*p) {
+		p += strspn(p, ", ");
+		toklen = strcspn(p, ", ");
+
+		if (toklen == len && !strncmp(p, sockname, len))
+			return 1;
+
+		p += toklen;
+	}
+
+	return 0;
+}
+
+static void start_job(ups_t *ups, const struct timeval *now)
+{
+	if (!ups->startattempts)
+		ups->startfirst = *now;
+
+	ups->startattempts++;
+	ups->startlast = *now;
+	ups->startjob = STARTJOB_RUNNING;
+
+	start_driver(ups);
+}
+
+/* the launched driver exited (forked away or failed), or did not finish
+ * within its maxstartdelay: note the outcome, or schedule another attempt */
+static void start_job_done(ups_t *ups, const struct timeval *now, startjob_t outcome)
+{
+	int	drv_maxretry = (ups->maxretry >= 0 ? ups->maxretry : maxretry);
+	int	drv_retrydelay = (ups->retrydelay >= 0 ? ups->retrydelay : retrydelay);
+
+	if (outcome != STARTJOB_STARTED && ups->startattempts < drv_maxretry) {
+		upsdebugx(2, "Driver [%s]: %i remaining attempts",
+			ups->upsname, drv_maxretry - ups->startattempts);
+		ups->startjob = STARTJOB_PENDING;
+		ups->startretry = *now;
+		if (drv_retrydelay > 0)
+			ups->startretry.tv_sec += drv_retrydelay;
+		return;
+	}
+
+	ups->startjob = outcome;
+	ups->startdone = *now;
+
+	if (outcome == STARTJOB_TIMEOUT)
+		exec_timeout++;
+	else if (outcome == STARTJOB_FAILED)
+		exec_error++;
+}
+
+/* Launch up to maxstartjobs drivers at a time, and poll each of them for
+ * the outcome that forkexec() would otherwise wait for one by one, so one
+ * slow or unreachable device does not hold up all the others. */
+static void start_all_drivers(void)
+{
+	ups_t	*ups, *dep, *slowest = NULL;
+	struct timeval	begin, now;
+	int	running = 0, pending = 0, waiting, launched, started = 0, total = 0;
+
+	upsdebugx(1, "Starting drivers, up to %d at a time", maxstartjobs);
+
+	gettimeofday(&begin, NULL);
+
+	for (ups = upstable; ups; ups = ups->next) {
+		ups->startattempts = 0;
+		ups->startretry = begin;
+		total++;
+
+		if ((ups->maxretry >= 0 ? ups->maxretry : maxretry) < 1) {
+			ups->startjob = STARTJOB_SKIPPED;
+			ups->startdone = begin;
+			continue;
+		}
+
+		ups->startjob = STARTJOB_PENDING;
+		pending++;
+	}
+
+	startjobs_active = 1;
+
+	while (running + pending > 0) {
+		gettimeofday(&now, NULL);
+
+		/* collect the drivers which detached, failed or are overdue */
+		for (ups = upstable; ups; ups = ups->next) {
+			int	wstat, drv_maxstartdelay;
+			pid_t	waitret;
+
+			if (ups->startjob != STARTJOB_RUNNING)
+				continue;
+
+			waitret = waitpid(ups->pid, &wstat, WNOHANG);
+
+			if (waitret == 0) {
+				drv_maxstartdelay = (ups->maxstartdelay != -1 ? ups->maxstartdelay : maxstartdelay);
+				if (drv_maxstartdelay < 0
+				 || difftimeval(now, ups->startlast) < drv_maxstartdelay
+				) {
+					continue;
+				}
+
+				upslogx(LOG_WARNING, "Driver [%s]: startup timer elapsed, continuing...",
+					ups->upsname);
+				ups->exceeded_timeout = 1;
+				start_job_done(ups, &now, STARTJOB_TIMEOUT);
+			} else if (waitret == -1) {
+				upslog_with_errno(LOG_WARNING, "Driver [%s]: waitpid failed",
+					ups->upsname);
+				start_job_done(ups, &now, STARTJOB_FAILED);
+			} else if (WIFEXITED(wstat) == 0) {
+				upslogx(LOG_WARNING, "Driver [%s] exited abnormally",
+					ups->upsname);
+				start_job_done(ups, &now, STARTJOB_FAILED);
+			} else if (WEXITSTATUS(wstat) != 0) {
+				upslogx(LOG_WARNING, "Driver [%s] failed to start"
+					" (exit status=%d)", ups->upsname, WEXITSTATUS(wstat));
+				start_job_done(ups, &now, STARTJOB_FAILED);
+			} else {
+				start_job_done(ups, &now, STARTJOB_STARTED);
+			}
+
+			running--;
+			if (ups->startjob == STARTJOB_PENDING)
+				pending++;
+		}
+
+		/* launch what is due, in ups.conf order, unless it still
+		 * waits for drivers which it talks to */
+		launched = 0;
+		waiting = 0;
+		for (ups = upstable; ups && running < maxstartjobs; ups = ups->next) {
+			if (ups->startjob != STARTJOB_PENDING)
+				continue;
+
+			if (difftimeval(ups->startretry, now) > 0) {
+				waiting++;
+				continue;
+			}
+
+			for (dep = upstable; dep; dep = dep->next) {
+				if ((dep->startjob == STARTJOB_PENDING || dep->startjob == STARTJOB_RUNNING)
+				 && start_depends_on(ups, dep)
+				) {
+					break;
+				}
+			}
+
+			if (dep)
+				continue;
+
+			start_job(ups, &now);
+			running++;
+			pending--;
+			launched++;
+		}
+
+		/* nothing runs or awaits a retry, yet nothing could start:
+		 * the "port" references loop back, so break the loop */
+		if (!running && !launched && !waiting && pending) {
+			for (ups = upstable; ups; ups = ups->next) {
+				if (ups->startjob == STARTJOB_PENDING)
+					break;
+			}
+
+			upslogx(LOG_WARNING, "Driver [%s] waits for drivers "
+				"which wait for it, starting it anyway",
+				ups->upsname);
+			start_job(ups, &now);
+			running++;
+			pending--;
+			continue;
+		}
+
+		if (running + pending > 0)
+			usleep(STARTJOB_POLL);
+	}
+
+	startjobs_active = 0;
+
+	/* summary of how long each driver took to start */
+	for (ups = upstable; ups; ups = ups->next) {
+		double	took = 0;
+
+		if (ups->startjob == STARTJOB_SKIPPED) {
+			upsdebugx(1, "Driver [%s] not started: maxretry=0", ups->upsname);
+			continue;
+		}
+
+		took = difftimeval(ups->startdone, ups->startfirst);
+		upsdebugx(1, "Driver [%s] %s after %.1f sec (%d attempt%s)",
+			ups->upsname,
+			(ups->startjob == STARTJOB_STARTED ? "started"
+			 : ups->startjob == STARTJOB_TIMEOUT ? "timed out"
+			 : "failed to start"),
+			took, ups->startattempts,
+			(ups->startattempts == 1 ? "" : "s"));
+
+		if (ups->startjob == STARTJOB_STARTED)
+			started++;
+
+		if (!slowest || took > difftimeval(slowest->startdone, slowest->startfirst))
+			slowest = ups;
+	}
+
+	gettimeofday(&now, NULL);
+	if (slowest) {
+		upslogx(LOG_INFO, "Started %d of %d drivers in %.1f sec "
+			"(up to %d at a time), slowest: %s took %.1f sec",
+			started, total, difftimeval(now, begin), maxstartjobs,
+			slowest->upsname,
+			difftimeval(slowest->startdone, slowest->startfirst));
+	} else {
+		upslogx(LOG_INFO, "Started %d of %d drivers (up to %d at a time)",
+			started, total, maxstartjobs);
+	}
+}
+#endif	/* !WIN32 */
+
 /* walk UPS table and send command to all UPSes according to sdorder */
 static void send_all_drivers(void (*command_func)(const ups_t *))
 {
@@ -1373,15 +1661,16 @@ static void send_all_drivers(void (*command_func)(const ups_t *))
 
 	if (command_func != &shutdown_driver) {
 		/* e.g. start_driver or stop_driver */
+		int	nowait_fg = ( (nut_foreground_passthrough > 0)
+		      || (nut_foreground_passthrough != 0
+		          && nut_debug_level > 0
+		          && nut_debug_level_passthrough > 0)
+		    );
 
 		/* Only warn when relevant - got more than one device to start */
 		if (command_func == &start_driver
 		&&  ups->next
-		&&  ( (nut_foreground_passthrough > 0)
-		      || (nut_foreground_passthrough != 0
-		          && nut_debug_level > 0
-		          && nut_debug_level_passthrough > 0)
-		    )
+		&&  nowait_fg
 		) {
 			upslogx(LOG_WARNING,
 				"Starting \"all\" drivers but requested the %s! "
@@ -1395,6 +1684,20 @@ static void send_all_drivers(void (*command_func)(const ups_t *))
 			);
 		}
 
+#ifndef WIN32
+		/* Only worth it when we would wait for each driver otherwise */
+		if (command_func == &start_driver
+		&&  ups->next
+		&&  maxstartjobs > 1
+		&&  waitfordrivers
+		&&  !nowait_fg
+		&&  !testmode
+		) {
+			start_all_drivers();
+			return;
+		}
+#endif	/* !WIN32 */
+
 		while (ups) {
 			command_func(ups);
 
@@ -41,6 +41,7 @@
 #include "hidparser.h"
 #include "hidtypes.h"
 #include "common.h"
+#include "strmap.h"
 #ifdef WIN32
 #include "wincompat.h"
 #endif	/* WIN32 */
@@ -118,6 +119,23 @@ typedef enum {
 	HU_WALKMODE_FULL_UPDATE
 } walkmode_t;
 
+/* Fetch plan of a QUICK or FULL walk: the reports holding the items
+ * it polls, in report order. Each of them is read from the device
+ * once per walk, then all the items are decoded from the buffered
+ * reports. Worked out from the hid2nut table after the INIT walk. */
+typedef struct {
+	bool_t	valid;
+	bool_t	interrupt;		/* use_interrupt_pipe it was made for */
+	size_t	nreports;
+	HIDData_t	*report[256];	/* one item of each report to read */
+} walkplan_t;
+
+/* QUICK, FULL, and FULL after a setvar/instcmd (data_has_changed) */
+#define HU_WALKPLAN_QUICK	0
+#define HU_WALKPLAN_FULL	1
+#define HU_WALKPLAN_CHANGED	2
+static walkplan_t walkplan[3];
+
 /* pointer to the active subdriver object (changed in callback() function) */
 static subdriver_t *subdriver = NULL;
 
@@ -154,6 +172,31 @@ static long interrupt_pipe_no_events_count = 0;
 /* How HIDGetEvents() below reports no events found */
 #define	NUT_LIBUSB_CODE_NO_EVENTS	0
 
+/* Are interrupt reports read asynchronously (see hid_ups_async_start())? */
+static bool_t async_active = FALSE;
+#if !((defined SHUT_MODE) && SHUT_MODE)
+/* ...or did that fail for the current connection? */
+static bool_t async_failed = FALSE;
+/* Reports received and not handled yet, the error which stopped
+ * the reads (if any), and the events handled since last update */
+#define	HU_ASYNC_MAX_REPORTS	16
+static unsigned char	async_report[HU_ASYNC_MAX_REPORTS][SMALLBUF];
+static size_t	async_report_len[HU_ASYNC_MAX_REPORTS];
+static int	async_nreports = 0;
+static int	async_error = 0;
+static int	async_events = 0;
+/* libusb descriptors watched by dstate_poll_fds() */
+static int	async_fds[DSTATE_MAX_WATCHED_FDS];
+static int	async_nfds = 0;
+/* Does libusb tell us about USB devices arriving and leaving (see
+ * hid_ups_hotplug_start())? Then, after our device left the bus, a
+ * reconnection is attempted as soon as a device arrives, instead of
+ * rescanning the bus every pollinterval */
+static bool_t hotplug_active = FALSE;
+static bool_t hotplug_arrived = FALSE;
+static bool_t hotplug_gone = FALSE;
+#endif	/* !SHUT_MODE => USB */
+
 static time_t lastpoll; /* Timestamp the last polling */
 hid_dev_handle_t udev = HID_DEV_HANDLE_CLOSED;
 
@@ -251,12 +294,20 @@ static time_t last_rb_start = 0;
 /* support functions */
 static hid_info_t *find_nut_info(const char *varname);
 static hid_info_t *find_hid_info(const HIDData_t *hiddata);
+static void hid_ups_index_items(void);
+static void hid_ups_index_free(void);
+static void hid_ups_cache_load(usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen);
+static void hid_ups_cache_save(void);
+static bool_t hid_ups_cache_skip(hid_info_t *item);
+static void hid_ups_cache_note(const hid_info_t *item, int retcode);
 static const char *hu_find_infoval(info_lkp_t *hid2info, const double value);
 static long hu_find_valinfo(info_lkp_t *hid2info, const char* value);
 static void process_boolean_info(const char *nutvalue);
 static void ups_alarm_set(void);
 static void ups_status_set(void);
 static bool_t hid_ups_walk(walkmode_t mode);
+static bool_t hid_ups_walk_items(walkmode_t mode);
+static bool_t hid_ups_walk_fetch(walkmode_t mode);
 static int reconnect_ups(void);
 static int ups_infoval_set(hid_info_t *item, double value);
 static int callback(hid_dev_handle_t argudev, HIDDevice_t *arghd,
@@ -265,6 +316,33 @@ static int callback(hid_dev_handle_t argudev, HIDDevice_t *arghd,
 static double interval(void);
 #endif
 
+/* Indexes of the subdriver->hid2nut items for find_nut_info() and
+ * find_hid_info(), built after each HU_WALKMODE_INIT walk (which sets
+ * their hiddata): by NUT name, and by the number (in pDesc) of their
+ * HID object. Those functions scan the table while they are NULL. */
+static strmap_t		*nut_info_index = NULL;
+static hid_info_t	**hid_info_index = NULL;
+
+/* What the HU_WALKMODE_INIT walk learned about each hid2nut item of
+ * this device, kept in a file under the state path so that later starts
+ * need not probe again the commands and the reports which the device
+ * refused; see hid_ups_cache_load() */
+#define HU_CACHE_UNKNOWN	'-'
+#define HU_CACHE_SUPPORTED	's'
+#define HU_CACHE_COMMAND	'c'
+#define HU_CACHE_STALLED	'p'	/* refused once, probed again */
+#define HU_CACHE_UNSUPPORTED	'u'	/* refused on two walks in a row */
+
+static bool_t	cache_enabled = TRUE;
+static bool_t	cache_warm = FALSE;	/* cache_state was loaded from the file */
+static bool_t	cache_dirty = FALSE;	/* and changed since, save it again */
+static char	*cache_state = NULL;	/* one HU_CACHE_* per hid2nut item */
+static size_t	cache_nitems = 0;
+static char	cache_key[LARGEBUF];
+
+/* time spent parsing the report descriptor (in callback()) */
+static double	startup_parse = 0.0;
+
 /* global variables */
 HIDDesc_t	*pDesc = NULL;		/* parsed Report Descriptor */
 reportbuf_t	*reportbuf = NULL;	/* buffer for most recent reports */
@@ -1155,6 +1233,9 @@ void upsdrv_makevartable(void)
 	addvar(VAR_FLAG, "powercom_sdcmd_byte_order_fallback",
 		"Set to use legacy byte order for Powercom HID shutdown commands. Either it was wrong forever, or some older devices/firmwares had it the other way around");
 
+	addvar(VAR_FLAG, "nocache",
+		"Don't keep what the device supports in a file under the state path, probe it at each start");
+
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	addvar(VAR_VALUE, "subdriver", "Explicit USB HID subdriver selection");
 
@@ -1180,12 +1261,370 @@ void upsdrv_makevartable(void)
 
 #define	MAX_EVENT_NUM	32
 
-void upsdrv_updateinfo(void)
+/* Set the values of the items of the HID notifications got on the
+ * interrupt pipe */
+static void hid_ups_process_events(HIDData_t **event, int evtCount)
 {
 	hid_info_t	*item;
-	HIDData_t	*event[MAX_EVENT_NUM], *found_data;
-	int		i, evtCount;
+	HIDData_t	*found_data;
+	int		i;
 	double		value;
+
+	for (i = 0; i < evtCount; i++) {
+
+		if (HIDGetDataValue(udev, event[i], &value, poll_interval) != 1)
+			continue;
+
+		if (nut_debug_level >= 2) {
+			upsdebugx(2,
+				"Path: %s, Type: %s, ReportID: 0x%02x, "
+				"Offset: %i, Size: %i, Value: %g",
+				HIDGetDataItem(event[i], subdriver->utab),
+				HIDDataType(event[i]), event[i]->ReportID,
+				event[i]->Offset, event[i]->Size, value);
+		}
+
+		/* Skip Input reports, if we don't use the Feature report */
+		found_data = FindObject_with_Path(pDesc, &(event[i]->Path), interrupt_only ? ITEM_INPUT:ITEM_FEATURE);
+		if (!found_data && !interrupt_only) {
+			found_data = FindObject_with_Path(pDesc, &(event[i]->Path), ITEM_INPUT);
+		}
+		if (!found_data) {
+			upsdebugx(2, "Could not find event as either ITEM_INPUT or ITEM_FEATURE?");
+			continue;
+		}
+		item = find_hid_info(found_data);
+		if (!item) {
+			upsdebugx(3, "NUT doesn't use this HID object");
+			continue;
+		}
+
+		ups_infoval_set(item, value);
+	}
+}
+
+#if !((defined SHUT_MODE) && SHUT_MODE)
+/* Called by libusb (from hid_ups_async_fd()) with each report read
+ * from the interrupt pipe, or with the error which stopped the reads */
+static void hid_ups_async_report(usb_ctrl_charbuf buf, int len, void *arg)
+{
+	NUT_UNUSED_VARIABLE(arg);
+
+	if (!buf) {
+		async_error = len;
+		return;
+	}
+
+	if (async_nreports >= HU_ASYNC_MAX_REPORTS) {
+		upsdebugx(1, "%s: too many reports (dropped)", __func__);
+		return;
+	}
+
+	async_report_len[async_nreports] = ((size_t)len < sizeof(async_report[0]))
+		? (size_t)len : sizeof(async_report[0]);
+	memcpy(async_report[async_nreports], buf, async_report_len[async_nreports]);
+	async_nreports++;
+}
+
+/* Called by libusb (from hid_ups_async_fd()) when a USB device
+ * arrived, or when ours left the bus */
+static void hid_ups_hotplug_event(int arrived, void *arg)
+{
+	NUT_UNUSED_VARIABLE(arg);
+
+	if (arrived) {
+		hotplug_arrived = TRUE;
+	} else {
+		hotplug_gone = TRUE;
+	}
+}
+
+/* A libusb descriptor woke up dstate_poll_fds(): handle the reports
+ * which arrived, and publish the new status right away instead of
+ * at the next upsdrv_updateinfo(). Have that one run now if our
+ * device came or went. */
+static int hid_ups_async_fd(TYPE_FD fd, void *arg)
+{
+	HIDData_t	*event[MAX_EVENT_NUM];
+	int		i, evtCount, handled = 0;
+
+	NUT_UNUSED_VARIABLE(fd);
+	NUT_UNUSED_VARIABLE(arg);
+
+	comm_driver->handle_events();
+
+	if (hotplug_gone && hd != NULL) {
+		upsdebugx(1, "Device left the USB bus");
+		dstate_setinfo("driver.state", "reconnect.trying");
+		async_nreports = 0;
+		hd = NULL;
+		dstate_datastale();
+		return 1;
+	}
+
+	if (hotplug_arrived) {
+		if (hd == NULL) {
+			return 1;
+		}
+
+		/* some other device, we are fine */
+		hotplug_arrived = FALSE;
+	}
+
+	if (async_nreports < 1) {
+		return 0;
+	}
+
+	dstate_batch_begin();
+
+	for (i = 0; i < async_nreports; i++) {
+		evtCount = HIDFileEvents(async_report[i], async_report_len[i],
+			event, MAX_EVENT_NUM);
+		upsdebugx(1, "Got %i HID objects asynchronously...",
+			(evtCount >= 0) ? evtCount : 0);
+		if (evtCount > 0) {
+			hid_ups_process_events(event, evtCount);
+			handled += evtCount;
+		}
+	}
+	async_nreports = 0;
+
+	if (handled > 0) {
+		async_events += handled;
+
+		status_init();
+		buzzmode_init();
+		ups_status_set();
+		buzzmode_commit();
+		status_commit();
+	}
+
+	dstate_batch_commit();
+	return 0;
+}
+
+/* Called by libusb when a descriptor it wants watched was opened */
+static void hid_ups_pollfd_added(int fd, int for_write, void *arg)
+{
+	int	i;
+
+	NUT_UNUSED_VARIABLE(arg);
+
+	for (i = 0; i < async_nfds && async_fds[i] != fd; i++)
+		;
+
+	if (i == DSTATE_MAX_WATCHED_FDS
+	 || dstate_watch_fd(fd, for_write, hid_ups_async_fd, NULL) < 0
+	) {
+		upsdebugx(1, "%s: can not watch fd %d", __func__, fd);
+		return;
+	}
+
+	if (i == async_nfds) {
+		async_fds[async_nfds++] = fd;
+	}
+}
+
+/* ...and when one is about to be closed */
+static void hid_ups_pollfd_removed(int fd, void *arg)
+{
+	int	i;
+
+	NUT_UNUSED_VARIABLE(arg);
+
+	for (i = 0; i < async_nfds; i++) {
+		if (async_fds[i] == fd) {
+			dstate_unwatch_fd(fd);
+			async_fds[i] = async_fds[--async_nfds];
+			return;
+		}
+	}
+}
+
+/* Have dstate_poll_fds() watch the libusb descriptors (which change as
+ * devices get opened and closed, libusb tells us about that) if on,
+ * or stop watching them */
+static int hid_ups_watch_fds(bool_t on)
+{
+	int	i, for_write[DSTATE_MAX_WATCHED_FDS];
+
+	if (comm_driver->set_pollfd_notifiers) {
+		comm_driver->set_pollfd_notifiers(NULL, NULL, NULL);
+	}
+
+	for (i = 0; i < async_nfds; i++) {
+		dstate_unwatch_fd(async_fds[i]);
+	}
+	async_nfds = 0;
+
+	if (!on) {
+		return 0;
+	}
+
+	async_nfds = comm_driver->get_pollfds(async_fds, for_write,
+		DSTATE_MAX_WATCHED_FDS);
+	if (async_nfds < 1) {
+		async_nfds = 0;
+		return -1;
+	}
+
+	for (i = 0; i < async_nfds; i++) {
+		if (dstate_watch_fd(async_fds[i], for_write[i], hid_ups_async_fd, NULL) < 0) {
+			hid_ups_watch_fds(FALSE);
+			return -1;
+		}
+	}
+
+	if (comm_driver->set_pollfd_notifiers) {
+		comm_driver->set_pollfd_notifiers(hid_ups_pollfd_added,
+			hid_ups_pollfd_removed, NULL);
+	}
+
+	return 0;
+}
+
+static void hid_ups_async_stop(void)
+{
+	if (async_active) {
+		comm_driver->stop_interrupt(udev);
+		async_active = FALSE;
+	}
+
+	/* hotplug notifications still need them */
+	hid_ups_watch_fds(hotplug_active);
+
+	async_nreports = 0;
+	async_events = 0;
+}
+
+/* Read the interrupt pipe asynchronously, with the libusb descriptors
+ * watched by dstate_poll_fds() in the driver main loop, so that the
+ * reports get handled as soon as they arrive */
+static void hid_ups_async_start(void)
+{
+	size_t	r;
+	int	ret;
+
+	if (async_active || async_failed || !comm_driver->start_interrupt) {
+		return;
+	}
+
+	r = (interrupt_size > 0 && interrupt_size < sizeof(async_report[0]))
+		? interrupt_size : sizeof(async_report[0]);
+
+	async_error = 0;
+	ret = comm_driver->start_interrupt(udev, (usb_ctrl_charbufsize)r,
+		hid_ups_async_report, NULL);
+	if (ret < 0) {
+		goto failed;
+	}
+	async_active = TRUE;
+
+	if (hid_ups_watch_fds(TRUE) < 0) {
+		goto failed;
+	}
+
+	upsdebugx(1, "Reading interrupt pipe asynchronously (%i fds)", async_nfds);
+	return;
+
+failed:
+	upsdebugx(1, "Can not read interrupt pipe asynchronously, "
+		"falling back to synchronous reads");
+	hid_ups_async_stop();
+	async_failed = TRUE;
+}
+
+/* Return the events handled asynchronously since the last call
+ * (or NUT_LIBUSB_CODE_NO_EVENTS), or the error which stopped the
+ * reads; in that case, fall back to synchronous reads */
+static int hid_ups_async_status(void)
+{
+	int	ret;
+
+	if (async_error) {
+		ret = async_error;
+		upsdebugx(1, "Asynchronous interrupt reads stopped (%i), "
+			"falling back to synchronous reads", ret);
+		hid_ups_async_stop();
+		async_error = 0;
+		async_failed = TRUE;
+		return ret;
+	}
+
+	ret = async_events;
+	async_events = 0;
+	return (ret > 0) ? ret : NUT_LIBUSB_CODE_NO_EVENTS;
+}
+
+static void hid_ups_hotplug_stop(void)
+{
+	if (!hotplug_active) {
+		return;
+	}
+
+	comm_driver->hotplug_deregister();
+	hotplug_active = FALSE;
+	hid_ups_watch_fds(async_active);
+}
+
+/* Have libusb tell us when USB devices arrive and leave, to reconnect
+ * as soon as the UPS gets plugged back in, rather than rescanning the
+ * bus (or having the driver restarted) until it is. Reconnects only
+ * accept the device we opened (see reconnect_ups()), so there is no
+ * point in waking up for arrivals with another VendorID/ProductID */
+static void hid_ups_hotplug_start(void)
+{
+	if (!comm_driver->hotplug_register
+	 || comm_driver->hotplug_register(hd, hid_ups_hotplug_event, NULL) < 0
+	) {
+		upsdebugx(1, "No USB hotplug notifications, "
+			"will rescan the bus to reconnect");
+		return;
+	}
+	hotplug_active = TRUE;
+
+	if (hid_ups_watch_fds(TRUE) < 0) {
+		upsdebugx(1, "Can not wait for USB hotplug notifications, "
+			"will rescan the bus to reconnect");
+		hid_ups_hotplug_stop();
+		return;
+	}
+
+	upsdebugx(1, "Using USB hotplug notifications to reconnect");
+}
+#endif	/* !SHUT_MODE => USB */
+
+/* Is it time to try and reconnect? Every pollinterval, or as soon as
+ * a device arrived after ours left the bus; until one does, only every
+ * pollfreq in case a notification got missed (and the device which
+ * left is closed, for libusb to forget its descriptors) */
+static bool_t hid_ups_reconnect_due(time_t now)
+{
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	if (hotplug_active && hotplug_arrived) {
+		hotplug_arrived = FALSE;
+		return TRUE;
+	}
+
+	if (hotplug_active && hotplug_gone) {
+		if (udev != HID_DEV_HANDLE_CLOSED) {
+			comm_driver->close_dev(udev);
+			udev = HID_DEV_HANDLE_CLOSED;
+			hid_ups_watch_fds(TRUE);
+		}
+		dstate_datastale();
+
+		return (now >= (lastpoll + pollfreq));
+	}
+#endif	/* !SHUT_MODE => USB */
+
+	return (now >= (lastpoll + poll_interval));
+}
+
+void upsdrv_updateinfo(void)
+{
+	HIDData_t	*event[MAX_EVENT_NUM];
+	int		evtCount;
 	time_t		now;
 
 	upsdebugx(1, "upsdrv_updateinfo...");
@@ -1194,8 +1633,13 @@ void upsdrv_updateinfo(void)
 
 	/* check for device availability to set datastale! */
 	if (hd == NULL) {
+#if !((defined SHUT_MODE) && SHUT_MODE)
+		hid_ups_async_stop();
+		async_failed = FALSE;
+#endif	/* !SHUT_MODE => USB */
+
 		/* don't flood reconnection attempts */
-		if (now < (lastpoll + poll_interval)) {
+		if (!hid_ups_reconnect_due(now)) {
 			return;
 		}
 
@@ -1215,6 +1659,9 @@ void upsdrv_updateinfo(void)
 		hd = &curDevice;
 		interrupt_pipe_EIO_count = 0;
 		interrupt_pipe_no_events_count = 0;
+#if !((defined SHUT_MODE) && SHUT_MODE)
+		hotplug_gone = FALSE;
+#endif	/* !SHUT_MODE => USB */
 
 		if (hid_ups_walk(HU_WALKMODE_INIT) == FALSE) {
 			hd = NULL;
@@ -1227,7 +1674,15 @@ void upsdrv_updateinfo(void)
 
 	/* Get HID notifications on Interrupt pipe first */
 	if (use_interrupt_pipe == TRUE) {
+#if !((defined SHUT_MODE) && SHUT_MODE)
+		hid_ups_async_start();
+		if (async_active || async_error) {
+			/* already handled as they arrived */
+			evtCount = hid_ups_async_status();
+		} else
+#endif	/* !SHUT_MODE => USB */
 		evtCount = HIDGetEvents(udev, event, MAX_EVENT_NUM);
+
 		switch (evtCount)
 		{
 		case LIBUSB_ERROR_BUSY:      /* Device or resource busy */
@@ -1280,38 +1735,10 @@ void upsdrv_updateinfo(void)
 		upsdebugx(1, "Not using interrupt pipe...");
 	}
 
-	/* Process pending events (HID notifications on Interrupt pipe) */
-	for (i = 0; i < evtCount; i++) {
-
-		if (HIDGetDataValue(udev, event[i], &value, poll_interval) != 1)
-			continue;
-
-		if (nut_debug_level >= 2) {
-			upsdebugx(2,
-				"Path: %s, Type: %s, ReportID: 0x%02x, "
-				"Offset: %i, Size: %i, Value: %g",
-				HIDGetDataItem(event[i], subdriver->utab),
-				HIDDataType(event[i]), event[i]->ReportID,
-				event[i]->Offset, event[i]->Size, value);
-		}
-
-		/* Skip Input reports, if we don't use the Feature report */
-		found_data = FindObject_with_Path(pDesc, &(event[i]->Path), interrupt_only ? ITEM_INPUT:ITEM_FEATURE);
-		if (!found_data && !interrupt_only) {
-			found_data = FindObject_with_Path(pDesc, &(event[i]->Path), ITEM_INPUT);
-		}
-		if (!found_data) {
-			upsdebugx(2, "Could not find event as either ITEM_INPUT or ITEM_FEATURE?");
-			continue;
-		}
-		item = find_hid_info(found_data);
-		if (!item) {
-			upsdebugx(3, "NUT doesn't use this HID object");
-			continue;
-		}
-
-		ups_infoval_set(item, value);
-	}
+	/* Process pending events (HID notifications on Interrupt pipe),
+	 * unless they were handled asynchronously as they arrived */
+	if (!async_active)
+		hid_ups_process_events(event, evtCount);
 #ifdef DEBUG
 	upsdebugx(1, "took %.3f seconds handling interrupt reports...",
 		interval());
@@ -1412,6 +1839,9 @@ void upsdrv_initups(void)
 {
 	int ret;
 	char *val;
+	struct timeval	start, opened, walked;
+
+	gettimeofday(&start, NULL);
 
 #if (defined SHUT_MODE) && SHUT_MODE
 	/*!
@@ -1507,6 +1937,10 @@ void upsdrv_initups(void)
 		disable_fix_report_desc = 1;
 	}
 
+	if (testvar("nocache")) {
+		cache_enabled = FALSE;
+	}
+
 	/* Search for the first supported UPS matching the
 	   regular expression (USB) or device_path (SHUT) */
 	ret = comm_driver->open_dev(&udev, &curDevice, subdriver_matcher, &callback);
@@ -1514,6 +1948,7 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "No matching HID UPS found");
 
 	hd = &curDevice;
+	gettimeofday(&opened, NULL);
 
 	upsdebugx(1, "Detected a UPS: %s/%s",
 		hd->Vendor ? hd->Vendor : "unknown",
@@ -1668,6 +2103,8 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "Can't initialize data from HID UPS");
 	}
 
+	gettimeofday(&walked, NULL);
+
 	/* Set values below from user settings only if supported by UPS */
 	if (dstate_getinfo("battery.charge.low")) {
 		/* Retrieve user defined battery settings */
@@ -1727,13 +2164,38 @@ void upsdrv_initups(void)
 		dstate_addcmd("shutdown.return");
 		dstate_addcmd("shutdown.stayoff");
 	}
+
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	hid_ups_hotplug_start();
+#endif	/* !SHUT_MODE => USB */
+
+	dstate_setinfo("driver.startup.open", "%.3f", difftimeval(opened, start));
+	dstate_setinfo("driver.startup.parse", "%.3f", startup_parse);
+	dstate_setinfo("driver.startup.init", "%.3f", difftimeval(walked, opened));
+	gettimeofday(&walked, NULL);
+	dstate_setinfo("driver.startup.total", "%.3f", difftimeval(walked, start));
+	dstate_setinfo("driver.startup.cache", "%s",
+		!cache_enabled ? "disabled" : cache_warm ? "hit" : "miss");
+	upsdebugx(1, "Device ready in %s sec (open: %s, of which parse: %s; init walk: %s; cache %s)",
+		dstate_getinfo("driver.startup.total"),
+		dstate_getinfo("driver.startup.open"),
+		dstate_getinfo("driver.startup.parse"),
+		dstate_getinfo("driver.startup.init"),
+		dstate_getinfo("driver.startup.cache"));
 }
 
 void upsdrv_cleanup(void)
 {
 	upsdebugx(1, "upsdrv_cleanup...");
 
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	hid_ups_hotplug_stop();
+	hid_ups_async_stop();
+#endif	/* !SHUT_MODE => USB */
 	comm_driver->close_dev(udev);
+	hid_ups_index_free();
+	free(cache_state);
+	cache_state = NULL;
 	Free_ReportDesc(pDesc);
 	free_report_buffer(reportbuf);
 #if !((defined SHUT_MODE) && SHUT_MODE)
@@ -1810,6 +2272,7 @@ static int callback(
 {
 	int i;
 	const char *mfr = NULL, *model = NULL, *serial = NULL;
+	struct timeval	start, parsed;
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	int ret;
 #endif	/* !SHUT_MODE => USB */
@@ -1839,6 +2302,8 @@ static int callback(
 	udev = argudev;
 
 	/* Parse Report Descriptor */
+	gettimeofday(&start, NULL);
+	hid_ups_index_free();
 	Free_ReportDesc(pDesc);
 	pDesc = Parse_ReportDesc(rdbuf, rdlen);
 	if (!pDesc) {
@@ -1877,6 +2342,11 @@ static int callback(
 	if (subdriver->fix_report_desc(arghd, pDesc)) {
 		upsdebugx(2, "Report Descriptor Fixed");
 	}
+	gettimeofday(&parsed, NULL);
+	startup_parse = difftimeval(parsed, start);
+
+	hid_ups_cache_load(rdbuf, rdlen);
+
 	HIDDumpTree(udev, arghd, subdriver->utab);
 
 #if !((defined SHUT_MODE) && SHUT_MODE)
@@ -1948,19 +2418,240 @@ int fix_report_desc(HIDDevice_t *arg_pDev, HIDDesc_t *arg_pDesc) {
 	return 0;
 }
 
+/* check whether the item is polled in a QUICK or FULL walk */
+static bool_t hid_ups_walk_wanted(const hid_info_t *item, walkmode_t mode, bool_t changed)
+{
+	if (mode == HU_WALKMODE_QUICK_UPDATE) {
+		/* Quick update only deals with status and alarms! */
+		return (item->hidflags & HU_FLAG_QUICK_POLL) ? TRUE : FALSE;
+	}
+
+	/* These don't need polling after initinfo() */
+	if (item->hidflags & (HU_FLAG_ABSENT | HU_TYPE_CMD))
+		return FALSE;
+
+	/* These don't need polling after initinfo() normally
+	 * However in "pollonly" mode we use these to detect "Data stale"
+	 * condition (e.g. cable disconnected) by failing the reads:
+	 */
+	if ((item->hidflags & HU_FLAG_STATIC) && use_interrupt_pipe)
+		return FALSE;
+
+	/* These need to be polled after user changes (setvar / instcmd)
+	 * or to detect "Data stale" in "pollonly" mode
+	 */
+	if (   (item->hidflags & HU_FLAG_SEMI_STATIC)
+		&& (changed == FALSE)
+		&& use_interrupt_pipe
+	)
+		return FALSE;
+
+	return TRUE;
+}
+
+/* check whether the report holding this item must not be read */
+static bool_t hid_ups_report_skipped(const HIDData_t *hiddata)
+{
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	/* skip report 0x54 for Tripplite SU3000LCD2UHV due to firmware bug */
+	if ((curDevice.VendorID == 0x09ae) && (curDevice.ProductID == 0x1330)) {
+		if (hiddata && (hiddata->ReportID == 0x54)) {
+			return TRUE;
+		}
+	}
+#else	/* SHUT_MODE */
+	NUT_UNUSED_VARIABLE(hiddata);
+#endif	/* !SHUT_MODE => USB */
+
+	return FALSE;
+}
+
+/* handle the result of reading a report or item: return 1 if there is
+ * a value, 0 if not (try again next time), or -1 if the device was
+ * lost and we need to reconnect */
+static int hid_ups_walk_retcode(int retcode)
+{
+	switch (retcode)
+	{
+	case LIBUSB_ERROR_BUSY:      /* Device or resource busy */
+		upslog_with_errno(LOG_CRIT, "Got disconnected by another driver");
+		goto fallthrough_reconnect;
+
+#if WITH_LIBUSB_0_1 /* limit to libusb 0.1 implementation */
+	case -EPERM:		/* Operation not permitted */
+#endif
+	case LIBUSB_ERROR_NO_DEVICE: /* No such device */
+	case LIBUSB_ERROR_ACCESS:    /* Permission denied */
+#if WITH_LIBUSB_0_1           /* limit to libusb 0.1 implementation */
+	case -ENXIO:		  /* No such device or address */
+#endif
+	case LIBUSB_ERROR_NOT_FOUND: /* No such file or directory */
+	case LIBUSB_ERROR_NO_MEM:    /* Insufficient memory */
+	fallthrough_reconnect:
+		/* Uh oh, got to reconnect! */
+		dstate_setinfo("driver.state", "reconnect.trying");
+		hd = NULL;
+		return -1;
+
+	case LIBUSB_ERROR_IO:        /* I/O error */
+		/* Uh oh, got to reconnect, with a special suggestion! */
+		dstate_setinfo("driver.state", "reconnect.trying");
+		interrupt_pipe_EIO_count++;
+		hd = NULL;
+		return -1;
+
+	case 1:
+		return 1;	/* Found! */
+
+	case 0:
+		return 0;
+
+	case LIBUSB_ERROR_TIMEOUT:   /* Connection timed out */
+/* libusb win32 does not know EPROTO and EOVERFLOW,
+ * it only returns EIO for any IO errors */
+#ifndef WIN32
+	case LIBUSB_ERROR_OVERFLOW:  /* Value too large for defined data type */
+# if EPROTO && WITH_LIBUSB_0_1
+	case -EPROTO:		/* Protocol error */
+# endif
+#endif	/* !WIN32 */
+	case LIBUSB_ERROR_PIPE:      /* Broken pipe */
+	default:
+		/* Don't know what happened, try again later... */
+		upsdebugx(1, "HIDGetDataValue unknown retcode '%i'", retcode);
+		return 0;
+	}
+}
+
+/* get (or make) the fetch plan for a QUICK or FULL walk */
+static walkplan_t *hid_ups_walk_plan(walkmode_t mode)
+{
+	walkplan_t	*plan;
+	hid_info_t	*item;
+	HIDData_t	*seen[256];
+	bool_t		changed = FALSE;
+	int		id;
+
+	if (mode == HU_WALKMODE_QUICK_UPDATE) {
+		plan = &walkplan[HU_WALKPLAN_QUICK];
+	} else if (data_has_changed == TRUE) {
+		plan = &walkplan[HU_WALKPLAN_CHANGED];
+		changed = TRUE;
+	} else {
+		plan = &walkplan[HU_WALKPLAN_FULL];
+	}
+
+	if (plan->valid && plan->interrupt == use_interrupt_pipe)
+		return plan;
+
+	memset(seen, 0, sizeof(seen));
+	for (item = subdriver->hid2nut; item->info_type != NULL; item++) {
+		if (item->hiddata == NULL || hid_ups_report_skipped(item->hiddata))
+			continue;
+
+		if (!hid_ups_walk_wanted(item, mode, changed))
+			continue;
+
+		if (!seen[item->hiddata->ReportID])
+			seen[item->hiddata->ReportID] = item->hiddata;
+	}
+
+	plan->nreports = 0;
+	for (id = 0; id < 256; id++) {
+		if (seen[id])
+			plan->report[plan->nreports++] = seen[id];
+	}
+
+	plan->interrupt = use_interrupt_pipe;
+	plan->valid = TRUE;
+
+	upsdebugx(2, "%s: %s walk reads %" PRIuSIZE " reports", __func__,
+		(mode == HU_WALKMODE_QUICK_UPDATE) ? "quick" : "full",
+		plan->nreports);
+
+	return plan;
+}
+
+/* read the reports of the fetch plan of a QUICK or FULL walk */
+static bool_t hid_ups_walk_fetch(walkmode_t mode)
+{
+	walkplan_t	*plan = hid_ups_walk_plan(mode);
+	size_t		i;
+
+	for (i = 0; i < plan->nreports; i++) {
+#if (defined SHUT_MODE) && SHUT_MODE
+		if (exit_flag != 0)
+			return TRUE;
+#endif	/* SHUT_MODE */
+
+		/* errors other than a lost device are handled (and logged)
+		 * when the items of this report are decoded */
+		if (hid_ups_walk_retcode(HIDGetDataReport(udev, plan->report[i], poll_interval)) < 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 /* walk ups variables and set elements of the info array. */
 static bool_t hid_ups_walk(walkmode_t mode)
 {
-	hid_info_t	*item;
-	double		value;
-	int		retcode;
+	bool_t	ret = TRUE;
+	size_t	transfers = hid_ctrl_transfers, nreports = 0;
+	int	id;
+
+	/* Read each report (at most) once during this walk */
+	HIDWalkBegin();
+
+	if (mode == HU_WALKMODE_INIT) {
+		/* the hid2nut mapping may change now */
+		memset(walkplan, 0, sizeof(walkplan));
+		hid_ups_index_free();
+	} else {
+		ret = hid_ups_walk_fetch(mode);
+	}
+
+	if (ret == TRUE)
+		ret = hid_ups_walk_items(mode);
+
+	HIDWalkEnd();
+
+	if (mode == HU_WALKMODE_INIT && ret == TRUE) {
+		hid_ups_index_items();
+		if (!cache_warm || cache_dirty)
+			hid_ups_cache_save();
+	}
+
+	if (reportbuf) {
+		for (id = 0; id < 256; id++) {
+			if (reportbuf->walked[id] == reportbuf->walk)
+				nreports++;
+		}
+	}
+
+	upsdebugx(2, "%s: %" PRIuSIZE " reports read with %" PRIuSIZE
+		" control transfers", __func__, nreports,
+		hid_ctrl_transfers - transfers);
 
 #if !((defined SHUT_MODE) && SHUT_MODE)
-	/* extract the VendorId for further testing */
-	int vendorID = curDevice.VendorID;
-	int productID = curDevice.ProductID;
+	dstate_setstat("driver.stats.usb.reports", "%" PRIuSIZE, nreports);
+	dstate_setstat("driver.stats.usb.transfers", "%" PRIuSIZE,
+		hid_ctrl_transfers - transfers);
+	dstate_setstat("driver.stats.usb.transfers.total", "%" PRIuSIZE,
+		hid_ctrl_transfers);
 #endif	/* !SHUT_MODE => USB */
 
+	return ret;
+}
+
+/* decode the values of ups variables (from the device, or from the
+ * reports already read in this walk) and set elements of the info array. */
+static bool_t hid_ups_walk_items(walkmode_t mode)
+{
+	hid_info_t	*item;
+	double		value;
+	int		retcode;
+
 	/* 3 modes: HU_WALKMODE_INIT, HU_WALKMODE_QUICK_UPDATE
 	 * and HU_WALKMODE_FULL_UPDATE */
 
@@ -2052,31 +2743,8 @@ static bool_t hid_ups_walk(walkmode_t mode)
 			continue;
 
 		case HU_WALKMODE_QUICK_UPDATE:
-			/* Quick update only deals with status and alarms! */
-			if (!(item->hidflags & HU_FLAG_QUICK_POLL))
-				continue;
-
-			break;
-
 		case HU_WALKMODE_FULL_UPDATE:
-			/* These don't need polling after initinfo() */
-			if (item->hidflags & (HU_FLAG_ABSENT | HU_TYPE_CMD))
-				continue;
-
-			/* These don't need polling after initinfo() normally
-			 * However in "pollonly" mode we use these to detect "Data stale"
-			 * condition (e.g. cable disconnected) by failing the reads:
-			 */
-			if ((item->hidflags & HU_FLAG_STATIC) && use_interrupt_pipe)
-				continue;
-
-			/* These need to be polled after user changes (setvar / instcmd)
-			 * or to detect "Data stale" in "pollonly" mode
-			 */
-			if (   (item->hidflags & HU_FLAG_SEMI_STATIC)
-				&& (data_has_changed == FALSE)
-				&& use_interrupt_pipe
-			)
+			if (!hid_ups_walk_wanted(item, mode, data_has_changed))
 				continue;
 
 			break;
@@ -2110,67 +2778,21 @@ static bool_t hid_ups_walk(walkmode_t mode)
 # pragma GCC diagnostic pop
 #endif
 
-#if !((defined SHUT_MODE) && SHUT_MODE)
-		/* skip report 0x54 for Tripplite SU3000LCD2UHV due to firmware bug */
-		if ((vendorID == 0x09ae) && (productID == 0x1330)) {
-			if (item->hiddata && (item->hiddata->ReportID == 0x54)) {
-				continue;
-			}
-		}
-#endif	/* !SHUT_MODE => USB */
-
-		retcode = HIDGetDataValue(udev, item->hiddata, &value, poll_interval);
+		if (mode == HU_WALKMODE_INIT && hid_ups_cache_skip(item))
+			continue;
 
-		switch (retcode)
-		{
-		case LIBUSB_ERROR_BUSY:      /* Device or resource busy */
-			upslog_with_errno(LOG_CRIT, "Got disconnected by another driver");
-			goto fallthrough_reconnect;
+		if (hid_ups_report_skipped(item->hiddata))
+			continue;
 
-#if WITH_LIBUSB_0_1 /* limit to libusb 0.1 implementation */
-		case -EPERM:		/* Operation not permitted */
-#endif
-		case LIBUSB_ERROR_NO_DEVICE: /* No such device */
-		case LIBUSB_ERROR_ACCESS:    /* Permission denied */
-#if WITH_LIBUSB_0_1           /* limit to libusb 0.1 implementation */
-		case -ENXIO:		  /* No such device or address */
-#endif
-		case LIBUSB_ERROR_NOT_FOUND: /* No such file or directory */
-		case LIBUSB_ERROR_NO_MEM:    /* Insufficient memory */
-		fallthrough_reconnect:
-			/* Uh oh, got to reconnect! */
-			dstate_setinfo("driver.state", "reconnect.trying");
-			hd = NULL;
-			return FALSE;
+		retcode = HIDGetDataValue(udev, item->hiddata, &value, poll_interval);
+		if (mode == HU_WALKMODE_INIT)
+			hid_ups_cache_note(item, retcode);
 
-		case LIBUSB_ERROR_IO:        /* I/O error */
-			/* Uh oh, got to reconnect, with a special suggestion! */
-			dstate_setinfo("driver.state", "reconnect.trying");
-			interrupt_pipe_EIO_count++;
-			hd = NULL;
+		retcode = hid_ups_walk_retcode(retcode);
+		if (retcode < 0)
 			return FALSE;
-
-		case 1:
-			break;	/* Found! */
-
-		case 0:
-			continue;
-
-		case LIBUSB_ERROR_TIMEOUT:   /* Connection timed out */
-/* libusb win32 does not know EPROTO and EOVERFLOW,
- * it only returns EIO for any IO errors */
-#ifndef WIN32
-		case LIBUSB_ERROR_OVERFLOW:  /* Value too large for defined data type */
-# if EPROTO && WITH_LIBUSB_0_1
-		case -EPROTO:		/* Protocol error */
-# endif
-#endif	/* !WIN32 */
-		case LIBUSB_ERROR_PIPE:      /* Broken pipe */
-		default:
-			/* Don't know what happened, try again later... */
-		   upsdebugx(1, "HIDGetDataValue unknown retcode '%i'", retcode);
+		if (retcode == 0)
 			continue;
-		}
 
 		upsdebugx(2,
 			"Path: %s, Type: %s, ReportID: 0x%02x, "
@@ -2259,6 +2881,13 @@ static int reconnect_ups(void)
 	upsdebugx(4, "Opening comm_driver ...");
 	ret = comm_driver->open_dev(&udev, &curDevice, subdriver_matcher, NULL);
 	upsdebugx(4, "Opening comm_driver returns ret=%i", ret);
+
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	/* the libusb descriptors changed with the device */
+	if (hotplug_active) {
+		hid_ups_watch_fds(TRUE);
+	}
+#endif	/* !SHUT_MODE => USB */
 	if (ret > 0) {
 		return 1;
 	}
@@ -2637,6 +3266,248 @@ static void ups_status_set(void)
 	}
 }
 
+static void hid_ups_index_free(void)
+{
+	strmap_destroy(nut_info_index, NULL);
+	nut_info_index = NULL;
+	free(hid_info_index);
+	hid_info_index = NULL;
+}
+
+/* index the info array items with HID data, keeping the first of each
+ * name or HID object (as the scans of the find_*_info() methods do) */
+static void hid_ups_index_items(void)
+{
+	hid_info_t	*item;
+
+	hid_ups_index_free();
+
+	if (!pDesc || !subdriver)
+		return;
+
+	nut_info_index = strmap_create(STRMAP_NOCASE);
+	hid_info_index = xcalloc(pDesc->nitems, sizeof(*hid_info_index));
+
+	for (item = subdriver->hid2nut; item->info_type != NULL; item++) {
+		if (item->hiddata == NULL)
+			continue;
+
+		if (!strmap_get(nut_info_index, item->info_type))
+			strmap_put(nut_info_index, item->info_type, item);
+
+		if (item->hidflags & HU_FLAG_ABSENT)
+			continue;
+
+		if (item->hiddata >= pDesc->item
+		 && item->hiddata < pDesc->item + pDesc->nitems
+		 && !hid_info_index[item->hiddata - pDesc->item]
+		) {
+			hid_info_index[item->hiddata - pDesc->item] = item;
+		}
+	}
+
+	upsdebugx(2, "%s: %" PRIuSIZE " NUT names indexed", __func__,
+		strmap_count(nut_info_index));
+}
+
+static void hid_ups_cache_path(char *buf, size_t len)
+{
+	if (upsname) {
+		snprintf(buf, len, "%s/%s-%s.cache", dflt_statepath(), progname, upsname);
+	} else {
+		snprintf(buf, len, "%s/%s.cache", dflt_statepath(), progname);
+	}
+}
+
+/* Prepare cache_state for the hid2nut table of the subdriver, and fill
+ * it from the cache file if that was written for the same device (by
+ * VendorID, ProductID and Serial), with the same report descriptor,
+ * subdriver and driver version. Otherwise the next HU_WALKMODE_INIT
+ * walk probes the device as usual and hid_ups_cache_save() then
+ * records what it found. */
+static void hid_ups_cache_load(usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen)
+{
+	char	fn[NUT_PATH_MAX + 1], line[LARGEBUF];
+	FILE	*f;
+	size_t	n, loaded = 0;
+	char	state, *path;
+
+	free(cache_state);
+	cache_state = NULL;
+	cache_warm = FALSE;
+	cache_dirty = FALSE;
+
+	if (!cache_enabled || !subdriver)
+		return;
+
+	for (cache_nitems = 0; subdriver->hid2nut[cache_nitems].info_type != NULL; cache_nitems++);
+	cache_state = xcalloc(cache_nitems + 1, sizeof(*cache_state));
+	memset(cache_state, HU_CACHE_UNKNOWN, cache_nitems);
+
+	snprintf(cache_key, sizeof(cache_key),
+		"%s %s %04x:%04x %" PRI_NUT_USB_CTRL_CHARBUFSIZE " %08" PRIx32 " %s",
+		DRIVER_VERSION, subdriver->name, hd->VendorID, hd->ProductID,
+		rdlen, str_hash(STR_HASH_INIT, rdbuf, (size_t)rdlen, 0),
+		hd->Serial ? hd->Serial : "");
+
+	hid_ups_cache_path(fn, sizeof(fn));
+	f = fopen(fn, "r");
+	if (!f) {
+		upsdebugx(2, "%s: no cache in %s", __func__, fn);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (!strncmp(line, "key ", 4)) {
+			if (strcmp(line + 4, cache_key)) {
+				upsdebugx(1, "%s: %s was written for another device, "
+					"descriptor or driver version, ignoring it",
+					__func__, fn);
+				break;
+			}
+			cache_warm = TRUE;
+			continue;
+		}
+
+		/* "item <n> <state> <hidpath>", after a matching key */
+		if (!cache_warm || strncmp(line, "item ", 5))
+			continue;
+
+		n = strtoul(line + 5, &path, 10);
+		if (path[0] != ' ' || !path[1] || path[2] != ' ')
+			continue;
+		state = path[1];
+		path += 3;
+
+		if (n >= cache_nitems || !subdriver->hid2nut[n].hidpath
+		 || strcmp(subdriver->hid2nut[n].hidpath, path)
+		) {
+			/* the table changed without a version change */
+			upsdebugx(1, "%s: %s does not match the %s mapping table, ignoring it",
+				__func__, fn, subdriver->name);
+			cache_warm = FALSE;
+			break;
+		}
+
+		cache_state[n] = state;
+		loaded++;
+	}
+
+	fclose(f);
+
+	if (!cache_warm) {
+		memset(cache_state, HU_CACHE_UNKNOWN, cache_nitems);
+		return;
+	}
+
+	upsdebugx(1, "%s: using %" PRIuSIZE " known items from %s",
+		__func__, loaded, fn);
+}
+
+/* Write what the last HU_WALKMODE_INIT walk found to the cache file */
+static void hid_ups_cache_save(void)
+{
+	char	fn[NUT_PATH_MAX + 1], tmp[NUT_PATH_MAX + 5];
+	FILE	*f;
+	size_t	n;
+	int	ret;
+
+	if (!cache_state)
+		return;
+
+	hid_ups_cache_path(fn, sizeof(fn));
+	snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+
+	f = fopen(tmp, "w");
+	if (!f) {
+		upsdebug_with_errno(1, "%s: can't write %s", __func__, tmp);
+		return;
+	}
+
+	ret = fprintf(f, "# %s capabilities cache, remove to probe the device again\n"
+		"key %s\n", progname, cache_key);
+
+	for (n = 0; ret >= 0 && n < cache_nitems; n++) {
+		if (cache_state[n] == HU_CACHE_UNKNOWN)
+			continue;
+
+		ret = fprintf(f, "item %" PRIuSIZE " %c %s\n", n, cache_state[n],
+			subdriver->hid2nut[n].hidpath);
+	}
+
+	if (fclose(f) != 0 || ret < 0 || rename(tmp, fn) != 0) {
+		upsdebug_with_errno(1, "%s: can't write %s", __func__, fn);
+		unlink(tmp);
+		return;
+	}
+
+	cache_dirty = FALSE;
+	upsdebugx(2, "%s: wrote %s", __func__, fn);
+}
+
+/* In HU_WALKMODE_INIT, check whether the cache tells all we need to
+ * know about this item without reading its report */
+static bool_t hid_ups_cache_skip(hid_info_t *item)
+{
+	size_t	n = (size_t)(item - subdriver->hid2nut);
+
+	if (!cache_warm || n >= cache_nitems)
+		return FALSE;
+
+	switch (cache_state[n])
+	{
+	case HU_CACHE_UNSUPPORTED:
+		upsdebugx(3, "Skipping unsupported Path '%s' (cached)", item->hidpath);
+		item->hiddata = NULL;
+		return TRUE;
+
+	case HU_CACHE_COMMAND:
+		upsdebugx(3, "Adding command '%s' using Path '%s' (cached)",
+			item->info_type, item->hidpath);
+		dstate_addcmd(item->info_type);
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+/* In HU_WALKMODE_INIT, record the result of probing this item. Only a
+ * stall (the USB answer for requests which the device does not support)
+ * counts against it, and it takes one on two walks in a row (e.g. on two
+ * starts) to mark it unsupported, as a device may also stall when it is
+ * busy. Timeouts and other errors may be transient, and change nothing.
+ * When a walk with a loaded cache learns something new, the file gets
+ * written again. */
+static void hid_ups_cache_note(const hid_info_t *item, int retcode)
+{
+	size_t	n = (size_t)(item - subdriver->hid2nut);
+	char	state;
+
+	if (!cache_state || n >= cache_nitems)
+		return;
+
+	if (retcode == 1) {
+		state = (item->hidflags & HU_TYPE_CMD)
+			? HU_CACHE_COMMAND : HU_CACHE_SUPPORTED;
+	} else if (retcode == LIBUSB_ERROR_PIPE) {
+		state = (cache_state[n] == HU_CACHE_STALLED)
+			? HU_CACHE_UNSUPPORTED : HU_CACHE_STALLED;
+	} else {
+		return;
+	}
+
+	if (cache_state[n] != state) {
+		upsdebugx(3, "%s: Path '%s' is now '%c' (was '%c')",
+			__func__, item->hidpath, state, cache_state[n]);
+		cache_state[n] = state;
+		if (cache_warm)
+			cache_dirty = TRUE;
+	}
+}
+
 /* find info element definition in info array
  * by NUT varname, or NULL if not found.
  */
@@ -2656,6 +3527,18 @@ static hid_info_t *find_nut_info(const char *varname)
 		return NULL;
 	}
 
+	if (nut_info_index) {
+		hidups_item = strmap_get(nut_info_index, varname);
+		if (hidups_item) {
+			errno = 0;
+			return hidups_item;
+		}
+
+		upsdebugx(2, "%s: unknown info type: %s", __func__, varname);
+		errno = EINVAL;
+		return NULL;
+	}
+
 	for (hidups_item = subdriver->hid2nut; hidups_item->info_type != NULL ; hidups_item++) {
 		if (strcasecmp(hidups_item->info_type, varname))
 			continue;
@@ -2684,6 +3567,14 @@ static hid_info_t *find_hid_info(const HIDData_t *hiddata)
 		return NULL;
 	}
 
+	if (hid_info_index && hiddata >= pDesc->item
+	 && hiddata < pDesc->item + pDesc->nitems
+	) {
+		hidups_item = hid_info_index[hiddata - pDesc->item];
+		errno = hidups_item ? 0 : EINVAL;
+		return hidups_item;
+	}
+
 	for (hidups_item = subdriver->hid2nut; hidups_item->info_type != NULL ; hidups_item++) {
 		/* Skip server side vars */
 		if (hidups_item->hidflags & HU_FLAG_ABSENT)
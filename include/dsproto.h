@@ -0,0 +1,74 @@
+/* dsproto.h - binary framing for the driver/server socket protocol
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef NUT_DSPROTO_H_SEEN
+#define NUT_DSPROTO_H_SEEN 1
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* A server sends the handshake as a text command; a driver which knows
+ * the framing replies with the same line (still as text), and everything
+ * it sends after that line uses the records below. Commands from the
+ * server to the driver always remain text. See docs/sock-protocol.txt.
+ *
+ * Each record is a fixed header followed by the payload:
+ *   byte  0	opcode (DSPROTO_OP_*)
+ *   bytes 1-2	variable id, network byte order (0 if not used)
+ *   bytes 3-4	payload length, network byte order
+ */
+#define DSPROTO_HANDSHAKE	"PROTOCOL BINARY"
+
+#define DSPROTO_HEADER_LEN	5
+#define DSPROTO_MAX_PAYLOAD	65535
+#define DSPROTO_MAX_ID		65535
+
+#define DSPROTO_OP_TEXT		0	/* any text protocol line, without the newline */
+#define DSPROTO_OP_DEFINE	1	/* name of the variable with this id */
+#define DSPROTO_OP_SETINFO	2	/* new raw (unescaped) value of the variable */
+
+typedef struct dsproto_frame_s {
+	int	op;
+	unsigned int	id;
+	const char	*payload;	/* points into the decoded buffer, not NUL-terminated */
+	size_t	len;
+} dsproto_frame_t;
+
+/* write one record to buf; returns its size, or 0 if it does not fit
+ * into bufsize or the id or payload length are out of range */
+size_t dsproto_encode(char *buf, size_t bufsize, int op, unsigned int id,
+	const char *payload, size_t len);
+
+/* parse one record from the start of buf; returns its size, or 0 if
+ * buf does not hold a complete record yet */
+size_t dsproto_decode(const char *buf, size_t len, dsproto_frame_t *frame);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_DSPROTO_H_SEEN */
@@ -0,0 +1,95 @@
+/* evloop.h - persistent descriptor event loop for NUT daemons
+ *
+ * Copyright (C)
+ *   2026 Network UPS Tools team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef NUT_EVLOOP_H_SEEN
+#define NUT_EVLOOP_H_SEEN 1
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* Descriptors are registered once (e.g. when a connection is accepted)
+ * and stay in the loop until evloop_del() is called for them, so the
+ * cost of a wakeup depends on the number of ready descriptors and not
+ * on the number of registered ones (with the epoll backend at least).
+ *
+ * NOTE: This is currently only implemented for POSIX descriptors;
+ * on WIN32 evloop_create() returns NULL.
+ */
+
+/* interest and readiness flags */
+#define EVLOOP_READ	0x01
+#define EVLOOP_WRITE	0x02
+#define EVLOOP_ERROR	0x04	/* hangup, error or invalid descriptor (returned only) */
+
+/* backends for evloop_create() */
+typedef enum {
+	EVLOOP_BACKEND_DEFAULT = 0,	/* best available on this platform */
+	EVLOOP_BACKEND_POLL,		/* portable poll(2) fallback */
+	EVLOOP_BACKEND_EPOLL		/* Linux epoll(7) */
+} evloop_backend_t;
+
+/* one ready descriptor, as returned by evloop_next() */
+typedef struct evloop_event_s {
+	int	fd;
+	int	events;	/* EVLOOP_* flags that are ready */
+	int	type;	/* caller-defined tag passed to evloop_add() */
+	void	*data;	/* caller-defined pointer passed to evloop_add() */
+} evloop_event_t;
+
+typedef struct evloop_s evloop_t;
+
+/* returns NULL if the requested backend is not available */
+evloop_t *evloop_create(evloop_backend_t backend);
+void evloop_destroy(evloop_t *loop);
+
+/* name of the backend in use, for logging */
+const char *evloop_backend_name(const evloop_t *loop);
+
+/* number of currently registered descriptors */
+size_t evloop_count(const evloop_t *loop);
+
+/* all return 0 on success, -1 on error (with errno set) */
+int evloop_add(evloop_t *loop, int fd, int events, int type, void *data);
+int evloop_mod(evloop_t *loop, int fd, int events);
+int evloop_del(evloop_t *loop, int fd);
+
+/* wait up to timeout_ms (-1 = forever) for descriptors to become ready;
+ * returns the number of ready descriptors, 0 on timeout, -1 on error */
+int evloop_wait(evloop_t *loop, int timeout_ms);
+
+/* fetch the next ready descriptor from the last evloop_wait() batch;
+ * returns 0 when the batch is exhausted. Descriptors removed with
+ * evloop_del() after the wait are skipped, so handlers may safely
+ * close other connections while the batch is being processed. */
+int evloop_next(evloop_t *loop, evloop_event_t *ev);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_EVLOOP_H_SEEN */
@@ -48,6 +48,9 @@ extern "C" {
 #define PCONF_DEFAULT_ARG_LIMIT 32
 #define PCONF_DEFAULT_WORDLEN_LIMIT 512
 
+/* characters that pconf_encode() escapes with a backslash */
+#define PCONF_ESCAPE "#\\\""
+
 typedef struct {
 	FILE	*f;			/* stream to current file	*/
 	int	state;			/* current parser state		*/
@@ -85,6 +88,13 @@ void pconf_finish(PCONF_CTX_t *ctx);
 char *pconf_encode(const char *src, char *dest, size_t destsize);
 int pconf_char(PCONF_CTX_t *ctx, char ch);
 
+/* Like pconf_char() for each character of buf, but stops after the one
+ * which completes a line (returns 1) or causes an error (returns -1);
+ * returns 0 when all of buf was consumed without that. *used is set to
+ * the number of characters consumed, so the caller can handle the line
+ * and call again with the rest of buf. */
+int pconf_feed(PCONF_CTX_t *ctx, const char *buf, size_t len, size_t *used);
+
 #ifdef __cplusplus
 /* *INDENT-OFF* */
 }
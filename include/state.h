@@ -32,6 +32,9 @@ extern "C" {
 
 #define ST_SOCK_BUF_LEN 512
 
+/* values up to this size (with the final NUL) are stored inside the node */
+#define ST_INLINE_VALUE_LEN 32
+
 #include "timehead.h"
 
 #if defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_MONOTONIC) && HAVE_CLOCK_GETTIME && HAVE_CLOCK_MONOTONIC
@@ -41,10 +44,10 @@ typedef struct timeval	st_tree_timespec_t;
 #endif
 
 typedef struct st_tree_s {
-	char	*var;
+	char	*var;			/* interned, shared by all trees */
 	char	*val;			/* points to raw or safe */
 
-	char	*raw;			/* raw data from caller */
+	char	*raw;			/* raw data from caller, in rawbuf if short */
 	size_t	rawsize;
 
 	char	*safe;			/* safe data from pconf_encode */
@@ -62,10 +65,26 @@ typedef struct st_tree_s {
 	struct enum_s		*enum_list;
 	struct range_s		*range_list;
 
+	/* height of the subtree rooted here, for balancing */
+	int	height;
+
+	/* assigned by drivers for the binary socket protocol (0 = none) */
+	unsigned int	id;
+
 	struct st_tree_s	*left;
 	struct st_tree_s	*right;
+
+	char	rawbuf[ST_INLINE_VALUE_LEN];
 } st_tree_t;
 
+/* memory held by all state trees of this process */
+typedef struct st_tree_memstats_s {
+	size_t	nodes;		/* variables in all trees */
+	size_t	names;		/* distinct (interned) variable names */
+	size_t	heap_values;	/* values too long for rawbuf, or escaped */
+	size_t	bytes;		/* total allocated for all of the above */
+} st_tree_memstats_t;
+
 int state_get_timestamp(st_tree_timespec_t *now);
 int st_tree_node_compare_timestamp(const st_tree_t *node, const st_tree_timespec_t *cutoff);
 int state_setinfo(st_tree_t **nptr, const char *var, const char *val);
@@ -87,6 +106,7 @@ int state_delinfo_olderthan(st_tree_t **root, const char *var, const st_tree_tim
 int state_delenum(st_tree_t *root, const char *var, const char *val);
 int state_delrange(st_tree_t *root, const char *var, const int min, const int max);
 st_tree_t *state_tree_find(st_tree_t *node, const char *var);
+void state_get_memstats(st_tree_memstats_t *stats);
 
 #ifdef __cplusplus
 /* *INDENT-OFF* */
@@ -23,6 +23,8 @@
 #ifndef NUT_STR_H_SEEN
 #define NUT_STR_H_SEEN 1
 
+#include "nut_stdint.h"	/* uint32_t for str_hash() */
+
 #ifdef __cplusplus
 /* *INDENT-OFF* */
 extern "C" {
@@ -135,6 +137,13 @@ int	str_to_double_strict(const char *string, double *number, const int base);
  */
 int	str_ends_with(const char *s, const char *suff);
 
+/* FNV-1a hash of *len* bytes at *data*, for hash tables.
+ * - *hash*: STR_HASH_INIT, or the result for the preceding data;
+ * - *nocase*: if non-zero, letters are hashed as if lower case.
+ * Return the updated hash. */
+#define STR_HASH_INIT	2166136261U
+uint32_t	str_hash(uint32_t hash, const void *data, size_t len, int nocase);
+
 #ifndef HAVE_STRSEP
 /* Makefile should add the implem to libcommon(client).la */
 char *strsep(char **stringp, const char *delim);
@@ -0,0 +1,65 @@
+/* strmap.h - string keyed hash index for NUT daemons
+ *
+ * Copyright (C)
+ *   2026 Network UPS Tools team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef NUT_STRMAP_H_SEEN
+#define NUT_STRMAP_H_SEEN 1
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+/* Maps strings to caller-owned, non-NULL pointers, for lookups which
+ * would otherwise walk a list comparing names. The keys are copied.
+ * Maps created with STRMAP_NOCASE compare keys like strcasecmp().
+ */
+
+#define STRMAP_NOCASE	0x01
+
+typedef struct strmap_s strmap_t;
+
+strmap_t *strmap_create(int flags);
+
+/* freeval (if not NULL) is called for each value still in the map */
+void strmap_destroy(strmap_t *map, void (*freeval)(void *value));
+
+/* add or replace the value of key; returns the previous value or NULL */
+void *strmap_put(strmap_t *map, const char *key, void *value);
+
+/* returns the value of key, or NULL if it is not in the map */
+void *strmap_get(const strmap_t *map, const char *key);
+
+/* remove key; returns its value, or NULL if it was not in the map */
+void *strmap_del(strmap_t *map, const char *key);
+
+/* number of keys in the map */
+size_t strmap_count(const strmap_t *map);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif	/* NUT_STRMAP_H_SEEN */
@@ -35,10 +35,12 @@ let ups_global   = "chroot"
                  | "driverpath"
                  | "maxstartdelay"
                  | "maxretry"
+                 | "maxstartjobs"
                  | "nowait"
                  | "retrydelay"
                  | "pollinterval"
                  | "synchronous"
+                 | "statsinterval"
                  | "user"
                  | "group"
                  | "debug_min"
@@ -56,6 +58,7 @@ let ups_fields   = "driver"
                  | "ignorelb"
                  | "maxstartdelay"
                  | "synchronous"
+                 | "statsinterval"
                  | "user"
                  | "group"
                  | "debug_min"
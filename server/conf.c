@@ -46,11 +46,9 @@ static void ups_create(const char *fn, const char *name, const char *desc)
 {
 	upstype_t	*temp;
 
-	for (temp = firstups; temp != NULL; temp = temp->next) {
-		if (!strcasecmp(temp->name, name)) {
-			upslogx(LOG_ERR, "UPS name [%s] is already in use!", name);
-			return;
-		}
+	if (get_ups_ptr(name) != NULL) {
+		upslogx(LOG_ERR, "UPS name [%s] is already in use!", name);
+		return;
 	}
 
 	/* grab some memory and add the info */
@@ -78,12 +76,14 @@ static void ups_create(const char *fn, const char *name, const char *desc)
 	}
 #endif	/* WIN32 */
 	temp->sock_fd = sstate_connect(temp);
+	ups_watch_fd(temp);
 
 	/* preload this to the current time to avoid false staleness */
 	time(&temp->last_heard);
 
 	temp->next = firstups;
 	firstups = temp;
+	ups_index_add(temp);
 	num_ups++;
 }
 
@@ -117,6 +117,7 @@ static void ups_update(const char *fn, const char *name, const char *desc)
 		sstate_cmdfree(temp);
 		pconf_finish(&temp->sock_ctx);
 
+		ups_unwatch_fd(temp);
 #ifndef WIN32
 		close(temp->sock_fd);
 #else	/* WIN32 */
@@ -241,6 +242,28 @@ static int parse_upsd_conf_args(size_t numargs, char **arg)
 		}
 	}
 
+	/* MAXSENDQUEUE <bytes> */
+	if (!strcmp(arg[0], "MAXSENDQUEUE")) {
+		if (isdigit((size_t)arg[1][0]) && atol(arg[1]) >= NUT_NET_ANSWER_MAX) {
+			maxsendqueue = (size_t)atol(arg[1]);
+			return 1;
+		}
+		else {
+			upslogx(LOG_ERR, "MAXSENDQUEUE has invalid value (%s), "
+				"must be at least %d!", arg[1], NUT_NET_ANSWER_MAX);
+			return 0;
+		}
+	}
+
+	/* DRIVER_BINARY_PROTOCOL <bool> */
+	if (!strcmp(arg[0], "DRIVER_BINARY_PROTOCOL")) {
+		if (parse_boolean(arg[1], &driver_binary_protocol))
+			return 1;
+
+		upslogx(LOG_ERR, "DRIVER_BINARY_PROTOCOL has non boolean value (%s)!", arg[1]);
+		return 0;
+	}
+
 	/* STATEPATH <dir> */
 	if (!strcmp(arg[0], "STATEPATH")) {
 		const char *sp = getenv("NUT_STATEPATH");
@@ -561,6 +584,7 @@ static void delete_ups(upstype_t *target)
 
 			/* make sure nobody stays logged into this thing */
 			kick_login_clients(target->name);
+			ups_index_del(target);
 
 			/* about to delete the first ups? */
 			if (ptr == last)
@@ -568,12 +592,14 @@ static void delete_ups(upstype_t *target)
 			else
 				last->next = ptr->next;
 
-			if (VALID_FD(ptr->sock_fd))
+			if (VALID_FD(ptr->sock_fd)) {
+				ups_unwatch_fd(ptr);
 #ifndef WIN32
 				close(ptr->sock_fd);
 #else	/* WIN32 */
 				CloseHandle(ptr->sock_fd);
 #endif	/* WIN32 */
+			}
 
 			/* release memory */
 			sstate_infofree(ptr);
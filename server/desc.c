@@ -23,67 +23,22 @@
 
 #include "common.h"
 #include "parseconf.h"
+#include "strmap.h"
 
 #include "desc.h"
 
 extern const char *datapath;
 
-typedef struct dlist_s {
-	char	*name;
-	char	*desc;
-	struct dlist_s	*next;
-} dlist_t;
+/* name -> description, both looked up case-insensitively */
+static strmap_t	*cmd_list = NULL, *var_list = NULL;
 
-static dlist_t	*cmd_list = NULL, *var_list = NULL;
-
-static void list_free(dlist_t *ptr)
-{
-	dlist_t	*next;
-
-	while (ptr) {
-		next = ptr->next;
-
-		free(ptr->name);
-		free(ptr->desc);
-		free(ptr);
-
-		ptr = next;
-	}
-}
-
-static const char *list_get(const dlist_t *list, const char *name)
-{
-	const dlist_t	*temp;
-
-	for (temp = list; temp != NULL; temp = temp->next) {
-
-		if (!strcasecmp(temp->name, name)) {
-			return temp->desc;
-		}
-	}
-
-	return NULL;
-}
-
-static void desc_add(dlist_t **list, const char *name, const char *desc)
+static void desc_add(strmap_t **list, const char *name, const char *desc)
 {
-	dlist_t	*temp;
-
-	for (temp = *list; temp != NULL; temp = temp->next) {
-		if (!strcasecmp(temp->name, name)) {
-			break;
-		}
-	}
-
-	if (temp == NULL) {
-		temp = xcalloc(1, sizeof(*temp));
-		temp->name = xstrdup(name);
-		temp->next = *list;
-		*list = temp;
+	if (*list == NULL) {
+		*list = strmap_create(STRMAP_NOCASE);
 	}
 
-	free(temp->desc);
-	temp->desc = xstrdup(desc);
+	free(strmap_put(*list, name, xstrdup(desc)));
 }
 
 static void desc_file_err(const char *errmsg)
@@ -137,18 +92,18 @@ void desc_load(void)
 
 void desc_free(void)
 {
-	list_free(cmd_list);
-	list_free(var_list);
+	strmap_destroy(cmd_list, free);
+	strmap_destroy(var_list, free);
 
 	cmd_list = var_list = NULL;
 }
 
 const char *desc_get_cmd(const char *name)
 {
-	return list_get(cmd_list, name);
+	return strmap_get(cmd_list, name);
 }
 
 const char *desc_get_var(const char *name)
 {
-	return list_get(var_list, name);
+	return strmap_get(var_list, name);
 }
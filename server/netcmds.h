@@ -34,6 +34,7 @@
 #include "netmisc.h"
 #include "netuser.h"
 #include "netinstcmd.h"
+#include "netwatch.h"
 
 #define FLAG_USER	0x0001		/* username and password must be set */
 
@@ -43,11 +44,13 @@ extern "C" {
 /* *INDENT-ON* */
 #endif
 
-static struct {
+typedef struct {
 	const	char	*name;
 	void	(*func)(nut_ctype_t *client, size_t numargs, const char **arg);
 	int	flags;
-} netcmds[] = {
+} netcmds_t;
+
+static netcmds_t netcmds[] = {
 	{ "VER",	net_ver,	0		},
 	{ "NETVER",	net_netver,	0		},
 	{ "PROTVER",	net_netver,	0		},	/* aliased since NUT 2.8.0 */
@@ -57,6 +60,9 @@ static struct {
 	{ "GET",	net_get,	0		},
 	{ "LIST",	net_list,	0		},
 
+	{ "WATCH",	net_watch,	0		},
+	{ "UNWATCH",	net_unwatch,	0		},
+
 	{ "USERNAME",	net_username,	0		},
 	{ "PASSWORD",	net_password,	0		},
 
@@ -183,7 +183,8 @@ static void get_type(nut_ctype_t *client, const char *upsname, const char *var)
 	sendback(client, "%s NUMBER\n", buf);
 }
 
-static void get_var_server(nut_ctype_t *client, const char *upsname, const char *var)
+/* returns 0 if var is not a known server.* variable */
+static int send_var_server(nut_ctype_t *client, const char *upsname, const char *var)
 {
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE
 #pragma GCC diagnostic push
@@ -210,7 +211,7 @@ static void get_var_server(nut_ctype_t *client, const char *upsname, const char
 			(PACKAGE_URL && !pkgurlHasNutOrg) ? " or " : "",
 			pkgurlHasNutOrg ? "" : "https://www.networkupstools.org/"
 			);
-		return;
+		return 1;
 	}
 #ifdef __clang__
 #pragma clang diagnostic pop
@@ -222,20 +223,39 @@ static void get_var_server(nut_ctype_t *client, const char *upsname, const char
 	if (!strcasecmp(var, "server.version")) {
 		sendback(client, "VAR %s server.version \"%s\"\n",
 			upsname, UPS_VERSION);
-		return;
+		return 1;
 	}
 
-	send_err(client, NUT_ERR_VAR_NOT_SUPPORTED);
+	return 0;
+}
+
+/* returns 0 if the UPS does not have var */
+static int send_var(nut_ctype_t *client, const upstype_t *ups, const char *upsname, const char *var)
+{
+	const	char	*val;
+
+	val = sstate_getinfo(ups, var);
+
+	if (!val)
+		return 0;
+
+	/* handle special case for status */
+	if ((!strcasecmp(var, "ups.status")) && (ups->fsd))
+		sendback(client, "VAR %s %s \"FSD %s\"\n", upsname, var, val);
+	else
+		sendback(client, "VAR %s %s \"%s\"\n", upsname, var, val);
+
+	return 1;
 }
 
 static void get_var(nut_ctype_t *client, const char *upsname, const char *var)
 {
 	const	upstype_t	*ups;
-	const	char	*val;
 
 	/* ignore upsname for server.* variables */
 	if (!strncasecmp(var, "server.", 7)) {
-		get_var_server(client, upsname, var);
+		if (!send_var_server(client, upsname, var))
+			send_err(client, NUT_ERR_VAR_NOT_SUPPORTED);
 		return;
 	}
 
@@ -249,18 +269,37 @@ static void get_var(nut_ctype_t *client, const char *upsname, const char *var)
 	if (!ups_available(ups, client))
 		return;
 
-	val = sstate_getinfo(ups, var);
-
-	if (!val) {
+	if (!send_var(client, ups, upsname, var))
 		send_err(client, NUT_ERR_VAR_NOT_SUPPORTED);
+}
+
+/* the values of several variables in one reply; those which the UPS
+ * does not have are left out */
+static void get_vars(nut_ctype_t *client, const char *upsname, size_t numvar, const char **var)
+{
+	const	upstype_t	*ups;
+	size_t	i;
+
+	ups = get_ups_ptr(upsname);
+
+	if (!ups) {
+		send_err(client, NUT_ERR_UNKNOWN_UPS);
 		return;
 	}
 
-	/* handle special case for status */
-	if ((!strcasecmp(var, "ups.status")) && (ups->fsd))
-		sendback(client, "VAR %s %s \"FSD %s\"\n", upsname, var, val);
-	else
-		sendback(client, "VAR %s %s \"%s\"\n", upsname, var, val);
+	if (!ups_available(ups, client))
+		return;
+
+	sendback(client, "BEGIN GET VARS %s\n", upsname);
+
+	for (i = 0; i < numvar; i++) {
+		if (!strncasecmp(var[i], "server.", 7))
+			send_var_server(client, upsname, var[i]);
+		else
+			send_var(client, ups, upsname, var[i]);
+	}
+
+	sendback(client, "END GET VARS %s\n", upsname);
 }
 
 void net_get(nut_ctype_t *client, size_t numarg, const char **arg)
@@ -312,6 +351,12 @@ void net_get(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
+	/* GET VARS UPS VARNAME [VARNAME...] */
+	if (!strcasecmp(arg[0], "VARS")) {
+		get_vars(client, arg[1], numarg - 2, &arg[2]);
+		return;
+	}
+
 	/* GET TYPE UPS VARNAME */
 	if (!strcasecmp(arg[0], "TYPE")) {
 		get_type(client, arg[1], arg[2]);
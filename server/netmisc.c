@@ -28,6 +28,7 @@
 #include "neterr.h"
 
 #include "netmisc.h"
+#include "netwatch.h"
 
 void net_ver(nut_ctype_t *client, size_t numarg, const char **arg)
 {
@@ -92,7 +93,7 @@ void net_help(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
-	sendback(client, "Commands: HELP VER PROTVER GET LIST SET INSTCMD"
+	sendback(client, "Commands: HELP VER PROTVER GET LIST WATCH UNWATCH SET INSTCMD"
 		" LOGIN LOGOUT USERNAME PASSWORD STARTTLS\n");
 	/* Not exposed: PRIMARY/MASTER FSD */
 }
@@ -123,6 +124,7 @@ void net_fsd(nut_ctype_t *client, size_t numarg, const char **arg)
 		client->username, client->addr, ups->name);
 
 	ups->fsd = 1;
+	watch_notify(ups, "ups.status");
 	sendback(client, "OK FSD-SET\n");
 }
 
@@ -313,6 +313,12 @@ void net_starttls(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
+	/* the reply must be on the wire in clear text before the handshake,
+	 * and the SSL layer expects a blocking socket from here on */
+	if (!sendback_drain(client)) {
+		return;
+	}
+
 #ifdef WITH_OPENSSL
 
 	client->ssl = SSL_new(ssl_ctx);
@@ -0,0 +1,441 @@
+/* netwatch.c - WATCH handlers and change notifications for upsd
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "common.h"
+
+#include "upsd.h"
+#include "sstate.h"
+#include "state.h"
+#include "neterr.h"
+#include "nut_stdint.h"
+#include "strmap.h"
+
+#include "netwatch.h"
+
+#include <ctype.h>
+
+/* one "WATCH <ups> [pattern...]" of a client */
+typedef struct watch_s {
+	char	*upsname;
+	char	**patterns;	/* none: all variables */
+	size_t	numpatterns;
+
+	/* changed variables not sent yet in the order of the changes,
+	 * and indexed by name to keep each only once */
+	char	**pending;
+	size_t	numpending;
+	size_t	maxpending;
+	strmap_t	*pending_idx;
+	int	status_pending;
+
+	struct watch_s	*next;
+} watch_t;
+
+/* clients with subscriptions, and those of them with changes to send */
+static size_t	watch_clients = 0;
+static size_t	watch_clients_pending = 0;
+
+/* match a variable name against a pattern where '*' stands for
+ * any number of characters, e.g. "battery.*" or "*.voltage" */
+static int watch_glob(const char *pat, const char *name)
+{
+	const char	*star = NULL, *back = NULL;
+
+	while (*name) {
+		if (*pat == '*') {
+			star = pat++;
+			back = name;
+			continue;
+		}
+
+		if (tolower((unsigned char)*pat) == tolower((unsigned char)*name)) {
+			pat++;
+			name++;
+			continue;
+		}
+
+		if (!star) {
+			return 0;
+		}
+
+		/* let the last star swallow one more character */
+		pat = star + 1;
+		name = ++back;
+	}
+
+	while (*pat == '*') {
+		pat++;
+	}
+
+	return (*pat == '\0');
+}
+
+static int watch_match(const watch_t *w, const char *var)
+{
+	size_t	i;
+
+	if (!w->numpatterns) {
+		return 1;
+	}
+
+	for (i = 0; i < w->numpatterns; i++) {
+		if (watch_glob(w->patterns[i], var)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void watch_mark(nut_ctype_t *client)
+{
+	if (client->watch_pending) {
+		return;
+	}
+
+	client->watch_pending = 1;
+	watch_clients_pending++;
+}
+
+static void watch_clear(watch_t *w)
+{
+	size_t	i;
+
+	for (i = 0; i < w->numpending; i++) {
+		strmap_del(w->pending_idx, w->pending[i]);
+		free(w->pending[i]);
+	}
+
+	w->numpending = 0;
+}
+
+static void watch_add_pending(watch_t *w, const char *var)
+{
+	char	*name;
+
+	if (!w->pending_idx) {
+		w->pending_idx = strmap_create(STRMAP_NOCASE);
+	}
+
+	/* coalesce: a variable changed again is sent once, with its
+	 * latest value (or as deleted) */
+	if (strmap_get(w->pending_idx, var)) {
+		return;
+	}
+
+	if (w->numpending == w->maxpending) {
+		w->maxpending = w->maxpending ? w->maxpending * 2 : 16;
+		w->pending = xrealloc(w->pending, w->maxpending * sizeof(*w->pending));
+	}
+
+	name = xstrdup(var);
+	w->pending[w->numpending++] = name;
+	strmap_put(w->pending_idx, name, name);
+}
+
+/* the availability of a UPS, as reported by ups_available() */
+static const char *watch_state(const upstype_t *ups)
+{
+	if (!ups) {
+		return NUT_ERR_UNKNOWN_UPS;
+	}
+
+	if (INVALID_FD(ups->sock_fd)) {
+		return NUT_ERR_DRIVER_NOT_CONNECTED;
+	}
+
+	if (ups->stale) {
+		return NUT_ERR_DATA_STALE;
+	}
+
+	return "OK";
+}
+
+static int watch_send_var(nut_ctype_t *client, const upstype_t *ups, const char *var)
+{
+	const char	*val = sstate_getinfo(ups, var);
+
+	if (!val) {
+		return sendback(client, "NOTIFY DELVAR %s %s\n", ups->name, var);
+	}
+
+	/* status is always a special case */
+	if ((ups->fsd == 1) && (!strcasecmp(var, "ups.status"))) {
+		return sendback(client, "NOTIFY VAR %s %s \"FSD %s\"\n", ups->name, var, val);
+	}
+
+	return sendback(client, "NOTIFY VAR %s %s \"%s\"\n", ups->name, var, val);
+}
+
+static int watch_dump(const st_tree_t *node, nut_ctype_t *client,
+	const upstype_t *ups, const watch_t *w)
+{
+	if (!node) {
+		return 1;	/* not an error */
+	}
+
+	if (!watch_dump(node->left, client, ups, w)) {
+		return 0;	/* write failed in child */
+	}
+
+	if (watch_match(w, node->var) && !watch_send_var(client, ups, node->var)) {
+		return 0;
+	}
+
+	return watch_dump(node->right, client, ups, w);
+}
+
+/* the state of the UPS and, if it is available, all watched variables */
+static int watch_snapshot(nut_ctype_t *client, const upstype_t *ups, watch_t *w)
+{
+	const char	*state = watch_state(ups);
+
+	/* everything is sent anyway */
+	watch_clear(w);
+	w->status_pending = 0;
+
+	if (!sendback(client, "NOTIFY STATUS %s %s\n", w->upsname, state)) {
+		return 0;
+	}
+
+	if (strcmp(state, "OK")) {
+		return 1;
+	}
+
+	return watch_dump(ups->inforoot, client, ups, w);
+}
+
+static void watch_destroy(watch_t *w)
+{
+	size_t	i;
+
+	watch_clear(w);
+
+	for (i = 0; i < w->numpatterns; i++) {
+		free(w->patterns[i]);
+	}
+
+	free(w->patterns);
+	free(w->pending);
+	strmap_destroy(w->pending_idx, NULL);
+	free(w->upsname);
+	free(w);
+}
+
+static void watch_del(nut_ctype_t *client, const char *upsname)
+{
+	watch_t	*w, **wp;
+
+	for (wp = &client->watches; (w = *wp) != NULL; wp = &w->next) {
+		if (!strcasecmp(w->upsname, upsname)) {
+			*wp = w->next;
+			watch_destroy(w);
+			return;
+		}
+	}
+}
+
+void net_watch(nut_ctype_t *client, size_t numarg, const char **arg)
+{
+	const	upstype_t	*ups;
+	watch_t	*w;
+	size_t	i;
+	int	had_watches;
+
+	if (numarg < 1) {
+		send_err(client, NUT_ERR_INVALID_ARGUMENT);
+		return;
+	}
+
+	ups = get_ups_ptr(arg[0]);
+
+	if (!ups) {
+		send_err(client, NUT_ERR_UNKNOWN_UPS);
+		return;
+	}
+
+	/* WATCH <ups> [pattern...] again replaces the patterns; this may
+	 * remove the only watch of the client, which still counts as one */
+	had_watches = (client->watches != NULL);
+	if (had_watches) {
+		watch_del(client, ups->name);
+	} else {
+		watch_clients++;
+	}
+
+	w = xcalloc(1, sizeof(*w));
+	w->upsname = xstrdup(ups->name);
+	w->numpatterns = numarg - 1;
+	w->patterns = xcalloc(numarg, sizeof(*w->patterns));
+
+	for (i = 0; i < w->numpatterns; i++) {
+		w->patterns[i] = xstrdup(arg[i + 1]);
+	}
+
+	w->next = client->watches;
+	client->watches = w;
+
+	upsdebugx(2, "%s: %s watches UPS [%s] (%" PRIuSIZE " patterns)",
+		__func__, client->addr, ups->name, w->numpatterns);
+
+	if (!sendback(client, "OK\n")) {
+		return;
+	}
+
+	/* start from the current state, changes follow */
+	watch_snapshot(client, ups, w);
+}
+
+void net_unwatch(nut_ctype_t *client, size_t numarg, const char **arg)
+{
+	if (numarg != 1) {
+		send_err(client, NUT_ERR_INVALID_ARGUMENT);
+		return;
+	}
+
+	if (client->watches) {
+		watch_del(client, arg[0]);
+
+		if (!client->watches) {
+			watch_clients--;
+		}
+	}
+
+	sendback(client, "OK\n");
+}
+
+void watch_notify(const upstype_t *ups, const char *var)
+{
+	nut_ctype_t	*client;
+	watch_t	*w;
+
+	if (!watch_clients) {
+		return;
+	}
+
+	for (client = firstclient; client; client = client->next) {
+		for (w = client->watches; w; w = w->next) {
+			if (strcasecmp(w->upsname, ups->name) || !watch_match(w, var)) {
+				continue;
+			}
+
+			watch_add_pending(w, var);
+			watch_mark(client);
+		}
+	}
+}
+
+void watch_notify_status(const upstype_t *ups)
+{
+	nut_ctype_t	*client;
+	watch_t	*w;
+
+	if (!watch_clients) {
+		return;
+	}
+
+	for (client = firstclient; client; client = client->next) {
+		for (w = client->watches; w; w = w->next) {
+			if (strcasecmp(w->upsname, ups->name)) {
+				continue;
+			}
+
+			w->status_pending = 1;
+			watch_mark(client);
+		}
+	}
+}
+
+size_t watch_pending(void)
+{
+	return watch_clients_pending;
+}
+
+int watch_flush(nut_ctype_t *client)
+{
+	const	upstype_t	*ups;
+	watch_t	*w;
+	int	queued = 0;
+	size_t	i;
+
+	if (!client->watch_pending) {
+		return 0;
+	}
+
+	client->watch_pending = 0;
+	watch_clients_pending--;
+
+	for (w = client->watches; w; w = w->next) {
+
+		if (!w->status_pending && !w->numpending) {
+			continue;
+		}
+
+		ups = get_ups_ptr(w->upsname);
+
+		/* after a change of state, values may have changed in
+		 * the meantime without our noticing: resend them all */
+		if (w->status_pending) {
+			queued = 1;
+			if (!watch_snapshot(client, ups, w)) {
+				break;
+			}
+			continue;
+		}
+
+		/* the status change which made it unavailable was sent */
+		if (!ups || strcmp(watch_state(ups), "OK")) {
+			watch_clear(w);
+			continue;
+		}
+
+		queued = 1;
+		for (i = 0; i < w->numpending; i++) {
+			if (!watch_send_var(client, ups, w->pending[i])) {
+				break;
+			}
+		}
+
+		watch_clear(w);
+	}
+
+	return queued;
+}
+
+void watch_free(nut_ctype_t *client)
+{
+	if (client->watch_pending) {
+		client->watch_pending = 0;
+		watch_clients_pending--;
+	}
+
+	if (!client->watches) {
+		return;
+	}
+
+	while (client->watches) {
+		watch_t	*w = client->watches;
+
+		client->watches = w->next;
+		watch_destroy(w);
+	}
+
+	watch_clients--;
+}
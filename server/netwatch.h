@@ -0,0 +1,54 @@
+/* netwatch.h - WATCH handlers and change notifications for upsd
+
+   Copyright (C)
+	2026	Network UPS Tools team
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef NUT_NETWATCH_H_SEEN
+#define NUT_NETWATCH_H_SEEN 1
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+extern "C" {
+/* *INDENT-ON* */
+#endif
+
+void net_watch(nut_ctype_t *client, size_t numarg, const char **arg);
+void net_unwatch(nut_ctype_t *client, size_t numarg, const char **arg);
+
+/* record a change for the clients watching <ups>: variable <var> was
+ * set or deleted, or the UPS became (un)available */
+void watch_notify(const upstype_t *ups, const char *var);
+void watch_notify_status(const upstype_t *ups);
+
+/* number of clients with recorded changes which were not sent yet */
+size_t watch_pending(void);
+
+/* queue the recorded changes of <client> with sendback(), coalesced to
+ * the latest state of each variable; returns 1 if anything was queued */
+int watch_flush(nut_ctype_t *client);
+
+/* drop all subscriptions of a client which goes away */
+void watch_free(nut_ctype_t *client);
+
+#ifdef __cplusplus
+/* *INDENT-OFF* */
+}
+/* *INDENT-ON* */
+#endif
+
+#endif /* NUT_NETWATCH_H_SEEN */
@@ -68,6 +68,19 @@ typedef struct nut_ctype_s {
 
 	PCONF_CTX_t	ctx;
 
+	/* replies queued by sendback() until the socket is writable,
+	 * kept as a ring buffer of outbuf_size bytes, outbuf_len of
+	 * which are used starting at offset outbuf_head */
+	char	*outbuf;
+	size_t	outbuf_size;
+	size_t	outbuf_head;
+	size_t	outbuf_len;
+
+	/* WATCH subscriptions (see netwatch.c), and whether any of
+	 * them has changes which were not sent yet */
+	struct watch_s	*watches;
+	int	watch_pending;
+
 	/* doubly linked list */
 	struct nut_ctype_s	*prev;
 	struct nut_ctype_s	*next;
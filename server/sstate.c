@@ -28,6 +28,8 @@
 #include "upsd.h"
 #include "upstype.h"
 #include "nut_stdint.h"
+#include "dsproto.h"
+#include "netwatch.h"
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -52,6 +54,16 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 	if (!strcasecmp(arg[0], "DUMPDONE")) {
 		upsdebugx(3, "%s: UPS [%s]: dump is done", __func__, ups->name);
 		ups->dumpdone = 1;
+
+		if (nut_debug_level >= 2) {
+			st_tree_memstats_t	ms;
+
+			state_get_memstats(&ms);
+			upsdebugx(2, "State of all UPSes: %" PRIuSIZE " variables "
+				"(%" PRIuSIZE " distinct names, %" PRIuSIZE
+				" values stored separately) in %" PRIuSIZE " bytes",
+				ms.nodes, ms.names, ms.heap_values, ms.bytes);
+		}
 		return 1;
 	}
 
@@ -70,6 +82,13 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 	if (numargs < 2)
 		return 0;
 
+	/* PROTOCOL BINARY: the driver accepted our handshake */
+	if (!strcasecmp(arg[0], "PROTOCOL") && !strcasecmp(arg[1], "BINARY")) {
+		upsdebugx(2, "%s: UPS [%s]: driver switched to binary records", __func__, ups->name);
+		ups->binary = 1;
+		return 1;
+	}
+
 	/* FIXME: all these should return their state_...() value! */
 	/* ADDCMD <cmdname> */
 	if (!strcasecmp(arg[0], "ADDCMD")) {
@@ -85,7 +104,9 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 
 	/* DELINFO <var> */
 	if (!strcasecmp(arg[0], "DELINFO")) {
-		state_delinfo(&ups->inforoot, arg[1]);
+		if (state_delinfo(&ups->inforoot, arg[1]) == 1) {
+			watch_notify(ups, arg[1]);
+		}
 		return 1;
 	}
 
@@ -100,7 +121,9 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 
 	/* SETINFO <varname> <value> */
 	if (!strcasecmp(arg[0], "SETINFO")) {
-		state_setinfo(&ups->inforoot, arg[1], arg[2]);
+		if (state_setinfo(&ups->inforoot, arg[1], arg[2]) == 1) {
+			watch_notify(ups, arg[1]);
+		}
 		return 1;
 	}
 
@@ -152,6 +175,106 @@ static int parse_args(upstype_t *ups, size_t numargs, char **arg)
 	return 0;
 }
 
+/* handle one record of the binary driver protocol */
+static int parse_frame(upstype_t *ups, const dsproto_frame_t *frame)
+{
+	char	value[ST_MAX_VALUE_LEN], *arg[3];
+	size_t	i, len;
+
+	switch (frame->op)
+	{
+	case DSPROTO_OP_TEXT:
+		/* the record holds one line, without its newline */
+		for (i = 0; i <= frame->len; i += len) {
+			int	ret = (i < frame->len)
+				? pconf_feed(&ups->sock_ctx, frame->payload + i, frame->len - i, &len)
+				: pconf_feed(&ups->sock_ctx, "\n", 1, &len);
+
+			if (ret == 1)
+				return parse_args(ups, ups->sock_ctx.numargs, ups->sock_ctx.arglist);
+
+			if (ret < 0) {
+				upslogx(LOG_NOTICE, "Parse error on sock: %s", ups->sock_ctx.errmsg);
+				return 0;
+			}
+		}
+		return 0;
+
+	case DSPROTO_OP_DEFINE:
+		if (frame->id < 1 || frame->len < 1)
+			return 0;
+
+		if (frame->id >= ups->numvarnames) {
+			ups->varnames = xrealloc(ups->varnames, (frame->id + 1) * sizeof(*ups->varnames));
+			memset(ups->varnames + ups->numvarnames, 0,
+				(frame->id + 1 - ups->numvarnames) * sizeof(*ups->varnames));
+			ups->numvarnames = frame->id + 1;
+		}
+
+		free(ups->varnames[frame->id]);
+		ups->varnames[frame->id] = xcalloc(1, frame->len + 1);
+		memcpy(ups->varnames[frame->id], frame->payload, frame->len);
+		return 1;
+
+	case DSPROTO_OP_SETINFO:
+		if (frame->id >= ups->numvarnames || !ups->varnames[frame->id]) {
+			upsdebugx(1, "%s: UPS [%s]: value for unknown variable id %u",
+				__func__, ups->name, frame->id);
+			return 0;
+		}
+
+		len = (frame->len < sizeof(value)) ? frame->len : sizeof(value) - 1;
+		memcpy(value, frame->payload, len);
+		value[len] = '\0';
+
+		arg[0] = "SETINFO";
+		arg[1] = ups->varnames[frame->id];
+		arg[2] = value;
+		return parse_args(ups, 3, arg);
+
+	default:
+		upsdebugx(1, "%s: UPS [%s]: unknown record type %d",
+			__func__, ups->name, frame->op);
+		return 0;
+	}
+}
+
+/* process the binary records in data, keeping an incomplete one for later */
+static void sstate_feed_binary(upstype_t *ups, const char *data, size_t len)
+{
+	dsproto_frame_t	frame;
+	const char	*buf = data;
+	size_t	pos = 0, used;
+
+	if (ups->binlen > 0) {
+		if (ups->binlen + len > ups->binsize) {
+			ups->binsize = ups->binlen + len;
+			ups->binbuf = xrealloc(ups->binbuf, ups->binsize);
+		}
+		memcpy(ups->binbuf + ups->binlen, data, len);
+		buf = ups->binbuf;
+		len += ups->binlen;
+	}
+
+	while ((used = dsproto_decode(buf + pos, len - pos, &frame)) > 0) {
+		pos += used;
+
+		if (parse_frame(ups, &frame)) {
+			/* set the 'last heard' time to now for later staleness checks */
+			time(&ups->last_heard);
+		}
+	}
+
+	if (pos < len) {
+		if (len - pos > ups->binsize) {
+			ups->binsize = len - pos;
+			ups->binbuf = xrealloc(ups->binbuf, ups->binsize);
+		}
+		memmove(ups->binbuf, buf + pos, len - pos);
+	}
+	ups->binlen = len - pos;
+}
+
 /* nothing fancy - just make the driver say something back to us */
 static void sendping(upstype_t *ups)
 {
@@ -195,8 +318,11 @@ static void sendping(upstype_t *ups)
 TYPE_FD sstate_connect(upstype_t *ups)
 {
 	TYPE_FD	fd;
+	/* with the handshake, a driver which does not know it just
+	 * complains about an unknown command and goes on with text */
+	const char	*dumpcmd = driver_binary_protocol
+		? DSPROTO_HANDSHAKE "\nDUMPALL\n" : "DUMPALL\n";
 #ifndef WIN32
-	const char	*dumpcmd = "DUMPALL\n";
 	size_t	dumpcmdlen = strlen(dumpcmd);
 	ssize_t	ret;
 	struct sockaddr_un	sa;
@@ -276,7 +402,6 @@ TYPE_FD sstate_connect(upstype_t *ups)
 
 #else	/* WIN32 */
 	char pipename[NUT_PATH_MAX];
-	const char	*dumpcmd = "DUMPALL\n";
 	BOOL  result = FALSE;
 	DWORD bytesWritten;
 
@@ -329,12 +454,15 @@ TYPE_FD sstate_connect(upstype_t *ups)
 
 	ups->dumpdone = 0;
 	ups->stale = 0;
+	ups->binary = 0;
+	ups->binlen = 0;
 
 	/* now is the last time we heard something from the driver */
 	time(&ups->last_heard);
 
 	/* set ups.status to "WAIT" while waiting for the driver response to dumpcmd */
 	state_setinfo(&ups->inforoot, "ups.status", "WAIT");
+	watch_notify_status(ups);
 
 	upslogx(LOG_INFO, "Connected to UPS [%s]: %s", ups->name, ups->fn);
 
@@ -352,6 +480,8 @@ void sstate_disconnect(upstype_t *ups)
 
 	pconf_finish(&ups->sock_ctx);
 
+	ups_unwatch_fd(ups);
+
 #ifndef WIN32
 	close(ups->sock_fd);
 #else	/* WIN32 */
@@ -359,11 +489,13 @@ void sstate_disconnect(upstype_t *ups)
 #endif	/* WIN32 */
 
 	ups->sock_fd = ERROR_FD;
+	watch_notify_status(ups);
 }
 
 void sstate_readline(upstype_t *ups)
 {
-	ssize_t	i, ret;
+	ssize_t	ret;
+	size_t	i, used;
 
 #ifndef WIN32
 	char	buf[SMALLBUF];
@@ -399,15 +531,26 @@ void sstate_readline(upstype_t *ups)
 	ret = bytesRead;
 #endif	/* WIN32 */
 
-	for (i = 0; i < ret; i++) {
+	if (ups->binary && ret > 0) {
+		sstate_feed_binary(ups, buf, (size_t)ret);
+		ret = 0;
+	}
+
+	for (i = 0; ret > 0 && i < (size_t)ret; i += used) {
 
-		switch (pconf_char(&ups->sock_ctx, buf[i]))
+		switch (pconf_feed(&ups->sock_ctx, buf + i, (size_t)ret - i, &used))
 		{
 		case 1:
 			/* set the 'last heard' time to now for later staleness checks */
 			if (parse_args(ups, ups->sock_ctx.numargs, ups->sock_ctx.arglist)) {
 				time(&ups->last_heard);
 			}
+
+			/* the rest comes after the handshake reply */
+			if (ups->binary) {
+				sstate_feed_binary(ups, buf + i + used, (size_t)ret - i - used);
+				ret = 0;	/* done with this buffer */
+			}
 			continue;
 
 		case 0:
@@ -496,9 +639,24 @@ int sstate_dead(upstype_t *ups, int arg_maxage)
 /* release all info(tree) data used by <ups> */
 void sstate_infofree(upstype_t *ups)
 {
+	size_t	i;
+
 	state_infofree(ups->inforoot);
 
 	ups->inforoot = NULL;
+
+	/* the variable ids of the binary protocol refer to this data */
+	for (i = 0; i < ups->numvarnames; i++) {
+		free(ups->varnames[i]);
+	}
+	free(ups->varnames);
+	ups->varnames = NULL;
+	ups->numvarnames = 0;
+
+	free(ups->binbuf);
+	ups->binbuf = NULL;
+	ups->binlen = 0;
+	ups->binsize = 0;
 }
 
 void sstate_cmdfree(upstype_t *ups)
@@ -36,6 +36,7 @@
 #ifndef WIN32
 # include <sys/un.h>
 # include <sys/socket.h>
+# include <sys/uio.h>
 # include <netdb.h>
 
 # ifdef HAVE_SYS_SIGNAL_H
@@ -65,6 +66,8 @@
 #include "sstate.h"
 #include "desc.h"
 #include "neterr.h"
+#include "evloop.h"
+#include "strmap.h"
 
 #ifdef HAVE_WRAP
 #include <tcpd.h>
@@ -97,6 +100,13 @@ int allow_not_all_listeners = 0;
 /* preloaded to {OPEN_MAX} in main, can be overridden via upsd.conf */
 nfds_t	maxconn = 0;
 
+/* limit of unsent reply data per client, can be overridden via upsd.conf */
+size_t	maxsendqueue = 4 * 1024 * 1024;
+
+/* ask drivers for binary framed updates (DRIVER_BINARY_PROTOCOL in
+ * upsd.conf); defaults to disabled, the text protocol is used then */
+int	driver_binary_protocol = 0;
+
 /* preloaded to STATEPATH in main, can be overridden via upsd.conf */
 char	*statepath = NULL;
 
@@ -107,7 +117,8 @@ char	*datapath = NULL;
 static const char	*progname;
 
 nut_ctype_t	*firstclient = NULL;
-/* static nut_ctype_t	*lastclient = NULL; */
+/* least recently active client, for shedding idle connections */
+static nut_ctype_t	*lastclient = NULL;
 
 /* default is to listen on all local interfaces */
 static stype_t	*firstaddr = NULL;
@@ -124,10 +135,22 @@ typedef enum {
 
 } handler_type_t;
 
+#ifdef WIN32
 typedef struct {
 	handler_type_t	type;
 	void		*data;
 } handler_t;
+#endif	/* WIN32 */
+
+/* shed clients after this many seconds of inactivity */
+/* FIXME: create an upsd.conf parameter (CLIENT_INACTIVITY_DELAY) */
+#define CLIENT_INACTIVITY_DELAY	60
+
+/* retry interval for driver sockets that are not connected */
+#define DRIVER_RECONNECT_DELAY	2
+
+/* upper bound for sleeping in the main loop when no timer is due */
+#define MAINLOOP_MAX_SLEEP	60
 
 /* Commands and settings status tracking */
 
@@ -150,13 +173,16 @@ typedef struct tracking_s {
 static tracking_t	*tracking_list = NULL;
 
 #ifndef WIN32
-	/* pollfd  */
-static struct pollfd	*fds = NULL;
+	/* drivers, clients and listeners stay registered while connected */
+static evloop_t		*mainloop_evloop = NULL;
+
+	/* when to next check drivers for staleness, pings and reconnects */
+static time_t		next_driver_check = 0;
 #else	/* WIN32 */
 static HANDLE		*fds = NULL;
 static HANDLE		mutex = INVALID_HANDLE_VALUE;
-#endif	/* WIN32 */
 static handler_t	*handler = NULL;
+#endif	/* WIN32 */
 
 	/* pid file */
 static char	pidfn[NUT_PATH_MAX];
@@ -172,6 +198,29 @@ static int	reload_flag = 0, exit_flag = 0;
 # define SERVICE_UNIT_NAME "nut-server.service"
 #endif
 
+/* index of firstups by (case-insensitive) name, see ups_index_add() */
+static strmap_t	*ups_index = NULL;
+
+/* index of netcmds[] by (case-insensitive) command word */
+static strmap_t	*netcmd_index = NULL;
+
+void ups_index_add(upstype_t *ups)
+{
+	if (!ups_index) {
+		ups_index = strmap_create(STRMAP_NOCASE);
+	}
+
+	strmap_put(ups_index, ups->name, ups);
+}
+
+void ups_index_del(upstype_t *ups)
+{
+	/* only forget the entry if it is still this UPS */
+	if (strmap_get(ups_index, ups->name) == ups) {
+		strmap_del(ups_index, ups->name);
+	}
+}
+
 /* return a pointer to the named ups if possible */
 upstype_t *get_ups_ptr(const char *name)
 {
@@ -183,10 +232,9 @@ upstype_t *get_ups_ptr(const char *name)
 		return NULL;
 	}
 
-	for (tmp = firstups; tmp; tmp = tmp->next) {
-		if (!strcasecmp(tmp->name, name)) {
-			return tmp;
-		}
+	tmp = strmap_get(ups_index, name);
+	if (tmp) {
+		return tmp;
 	}
 
 	upsdebugx(3, "%s: not a valid UPS: %s",
@@ -203,6 +251,7 @@ static void ups_data_stale(upstype_t *ups)
 	}
 
 	ups->stale = 1;
+	watch_notify_status(ups);
 
 	upslogx(LOG_NOTICE, "Data for UPS [%s] is stale - check driver", ups->name);
 }
@@ -215,6 +264,7 @@ static void ups_data_ok(upstype_t *ups)
 	}
 
 	ups->stale = 0;
+	watch_notify_status(ups);
 
 	upslogx(LOG_NOTICE, "UPS [%s] data is no longer stale", ups->name);
 }
@@ -253,6 +303,9 @@ void listen_add(const char *addr, const char *port)
 static void stype_free(stype_t *server)
 {
 	if (VALID_FD_SOCK(server->sock_fd)) {
+#ifndef WIN32
+		evloop_del(mainloop_evloop, server->sock_fd);
+#endif	/* !WIN32 */
 		close(server->sock_fd);
 	}
 
@@ -557,6 +610,10 @@ static void client_disconnect(nut_ctype_t *client)
 
 	upsdebugx(2, "Disconnect from %s", client->addr);
 
+#ifndef WIN32
+	evloop_del(mainloop_evloop, client->sock_fd);
+#endif	/* !WIN32 */
+
 	shutdown(client->sock_fd, 2);
 	close(client->sock_fd);
 
@@ -572,6 +629,8 @@ static void client_disconnect(nut_ctype_t *client)
 
 	pconf_finish(&client->ctx);
 
+	watch_free(client);
+
 	if (client->prev) {
 		client->prev->next = client->next;
 	} else {
@@ -583,24 +642,222 @@ static void client_disconnect(nut_ctype_t *client)
 		client->next->prev = client->prev;
 	} else {
 		/* deleting last entry */
-		/* lastclient = client->prev; */
+		lastclient = client->prev;
 	}
 
 	free(client->addr);
 	free(client->loginups);
 	free(client->password);
 	free(client->username);
+	free(client->outbuf);
 	free(client);
 
 	return;
 }
 
-/* send the buffer <sendbuf> of length <sendlen> to host <dest>
- * returns effectively a boolean: 0 = failed, 1 = sent ok
+/* note client activity: the list is kept ordered from the most recently
+ * active client (firstclient) to the least recently active (lastclient),
+ * so idle clients can be shed without scanning the whole list */
+static void client_touch(nut_ctype_t *client)
+{
+	time(&client->last_heard);
+
+	if (client == firstclient) {
+		return;
+	}
+
+	/* unlink... */
+	client->prev->next = client->next;
+	if (client->next) {
+		client->next->prev = client->prev;
+	} else {
+		lastclient = client->prev;
+	}
+
+	/* ...and move to the front */
+	client->prev = NULL;
+	client->next = firstclient;
+	firstclient->prev = client;
+	firstclient = client;
+}
+
+/* append <len> bytes to the output queue of <client>
+ * returns effectively a boolean: 0 = queue limit exceeded, 1 = queued ok
+ */
+static int client_queue(nut_ctype_t *client, const char *buf, size_t len)
+{
+	size_t	tail, first;
+
+	if (client->outbuf_len + len > maxsendqueue) {
+		upslogx(LOG_NOTICE, "Client %s is not reading replies "
+			"(%" PRIuSIZE " bytes queued), disconnecting",
+			client->addr, client->outbuf_len);
+		client->last_heard = 0;
+		return 0;
+	}
+
+	if (client->outbuf_len + len > client->outbuf_size) {
+		/* grow, and move the queued data to the start */
+		size_t	newsize = client->outbuf_size ? client->outbuf_size : LARGEBUF;
+		char	*newbuf;
+
+		while (newsize < client->outbuf_len + len) {
+			newsize *= 2;
+		}
+
+		newbuf = xmalloc(newsize);
+
+		if (client->outbuf_len) {
+			first = client->outbuf_size - client->outbuf_head;
+			if (first > client->outbuf_len) {
+				first = client->outbuf_len;
+			}
+			memcpy(newbuf, client->outbuf + client->outbuf_head, first);
+			memcpy(newbuf + first, client->outbuf, client->outbuf_len - first);
+		}
+
+		free(client->outbuf);
+		client->outbuf = newbuf;
+		client->outbuf_size = newsize;
+		client->outbuf_head = 0;
+	}
+
+	tail = (client->outbuf_head + client->outbuf_len) % client->outbuf_size;
+	first = client->outbuf_size - tail;
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(client->outbuf + tail, buf, first);
+	memcpy(client->outbuf, buf + first, len - first);
+	client->outbuf_len += len;
+
+	return 1;
+}
+
+/* write as much of the output queue as the socket takes right now
+ * returns -1 on error, 0 if some data remains queued, 1 if all was sent
+ */
+static int client_flush(nut_ctype_t *client)
+{
+	while (client->outbuf_len) {
+		ssize_t	res;
+		size_t	first = client->outbuf_size - client->outbuf_head;
+
+		if (first > client->outbuf_len) {
+			first = client->outbuf_len;
+		}
+
+#ifdef WITH_SSL
+		if (client->ssl) {
+			res = ssl_write(client, client->outbuf + client->outbuf_head, first);
+		} else
+#endif /* WITH_SSL */
+		{
+#ifndef WIN32
+			/* both parts of a wrapped ring buffer in one go */
+			struct iovec	iov[2];
+			int	iovcnt = 1;
+
+			iov[0].iov_base = client->outbuf + client->outbuf_head;
+			iov[0].iov_len = first;
+			if (client->outbuf_len > first) {
+				iov[1].iov_base = client->outbuf;
+				iov[1].iov_len = client->outbuf_len - first;
+				iovcnt = 2;
+			}
+
+			res = writev(client->sock_fd, iov, iovcnt);
+#else	/* WIN32 */
+			res = write(client->sock_fd, client->outbuf + client->outbuf_head, first);
+#endif	/* WIN32 */
+		}
+
+		upsdebugx(5, "%s: [destfd=%d] wrote %" PRIiSIZE " of %" PRIuSIZE " queued bytes",
+			__func__, client->sock_fd, res, client->outbuf_len);
+
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+#ifndef WIN32
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+#endif	/* !WIN32 */
+			upslog_with_errno(LOG_NOTICE, "write() failed for %s", client->addr);
+			client->last_heard = 0;
+			return -1;
+		}
+
+		if (res == 0) {
+			break;
+		}
+
+		client->outbuf_head = (client->outbuf_head + (size_t)res) % client->outbuf_size;
+		client->outbuf_len -= (size_t)res;
+	}
+
+	if (!client->outbuf_len) {
+		client->outbuf_head = 0;
+	}
+
+#ifndef WIN32
+	/* only ask to be woken up for writing while something is queued */
+	evloop_mod(mainloop_evloop, client->sock_fd,
+		client->outbuf_len ? (EVLOOP_READ | EVLOOP_WRITE) : EVLOOP_READ);
+#endif	/* !WIN32 */
+
+	return client->outbuf_len ? 0 : 1;
+}
+
+/* send out the changes recorded for WATCH subscriptions; a client which
+ * did not take the previous ones yet gets them later, coalesced */
+static void watch_send(void)
+{
+	nut_ctype_t	*client, *cnext;
+
+	if (!watch_pending()) {
+		return;
+	}
+
+	for (client = firstclient; client; client = cnext) {
+
+		cnext = client->next;
+
+		if (!client->watch_pending || client->outbuf_len) {
+			continue;
+		}
+
+		if (watch_flush(client) && client_flush(client) < 0) {
+			client_disconnect(client);
+		}
+	}
+}
+
+int sendback_drain(nut_ctype_t *client)
+{
+#ifndef WIN32
+	int	v;
+
+	if ((v = fcntl(client->sock_fd, F_GETFL, 0)) == -1
+	 || fcntl(client->sock_fd, F_SETFL, v & ~O_NDELAY) == -1
+	) {
+		upslog_with_errno(LOG_NOTICE, "fcntl() failed for %s", client->addr);
+		client->last_heard = 0;
+		return 0;
+	}
+#endif	/* !WIN32 */
+
+	return (client_flush(client) == 1);
+}
+
+/* queue a reply for the client, it is sent out by client_flush() after
+ * the current batch of commands is processed or the socket is writable
+ * returns effectively a boolean: 0 = failed, 1 = queued ok
  */
 int sendback(nut_ctype_t *client, const char *fmt, ...)
 {
-	ssize_t	res;
 	size_t	len;
 	char	ans[NUT_NET_ANSWER_MAX+1];
 	va_list	ap;
@@ -609,6 +866,11 @@ int sendback(nut_ctype_t *client, const char *fmt, ...)
 		return 0;
 	}
 
+	/* already failed, about to be disconnected */
+	if (!client->last_heard) {
+		return 0;
+	}
+
 	va_start(ap, fmt);
 	vsnprintf(ans, sizeof(ans), fmt, ap);
 	va_end(ap);
@@ -620,26 +882,15 @@ int sendback(nut_ctype_t *client, const char *fmt, ...)
 	 */
 	assert(len < SSIZE_MAX);
 
-#ifdef WITH_SSL
-	if (client->ssl) {
-		res = ssl_write(client, ans, len);
-	} else
-#endif /* WITH_SSL */
-	{
-		res = write(client->sock_fd, ans, len);
+	if (!client_queue(client, ans, len)) {
+		return 0;	/* failed */
 	}
 
-	{ /* scoping */
+	if (nut_debug_level >= 2) {
 		char * s = str_rtrim(ans, '\n');
 		upsdebugx(2, "write: [destfd=%d] [len=%" PRIuSIZE "] [%s]", client->sock_fd, len, s);
 	}
 
-	if (res < 0 || len != (size_t)res) {
-		upslog_with_errno(LOG_NOTICE, "write() failed for %s", client->addr);
-		client->last_heard = 0;
-		return 0;	/* failed */
-	}
-
 	return 1;	/* OK */
 }
 
@@ -702,7 +953,7 @@ int ups_available(const upstype_t *ups, nut_ctype_t *client)
 }
 
 /* check flags and access for an incoming command from the network */
-static void check_command(int cmdnum, nut_ctype_t *client, size_t numarg,
+static void check_command(size_t cmdnum, nut_ctype_t *client, size_t numarg,
 	const char **arg)
 {
 	char	*cmdstr = (numarg > 0 ? (char*)arg[0] : "<>");
@@ -779,7 +1030,8 @@ static void check_command(int cmdnum, nut_ctype_t *client, size_t numarg,
 /* parse requests from the network */
 static void parse_net(nut_ctype_t *client)
 {
-	int	i;
+	size_t	i;
+	const	netcmds_t	*cmd;
 
 	/* shouldn't happen */
 	if (client->ctx.numargs < 1) {
@@ -787,13 +1039,20 @@ static void parse_net(nut_ctype_t *client)
 		return;
 	}
 
-	for (i = 0; netcmds[i].name; i++) {
-		if (!strcasecmp(netcmds[i].name, client->ctx.arglist[0])) {
-			check_command(i, client, client->ctx.numargs, (const char **) client->ctx.arglist);
-			return;
+	if (!netcmd_index) {
+		netcmd_index = strmap_create(STRMAP_NOCASE);
+
+		for (i = 0; netcmds[i].name; i++) {
+			strmap_put(netcmd_index, netcmds[i].name, &netcmds[i]);
 		}
 	}
 
+	cmd = strmap_get(netcmd_index, client->ctx.arglist[0]);
+	if (cmd) {
+		check_command((size_t)(cmd - netcmds), client, client->ctx.numargs, (const char **) client->ctx.arglist);
+		return;
+	}
+
 	/* fallthrough = not matched by any entry in netcmds */
 
 	send_err(client, NUT_ERR_UNKNOWN_COMMAND);
@@ -818,10 +1077,38 @@ static void client_connect(stype_t *server)
 		return;
 	}
 
+#ifndef WIN32
+	if (evloop_count(mainloop_evloop) >= maxconn) {
+		upslogx(LOG_NOTICE, "Rejecting connection from %s: "
+			"MAXCONN (%" PRIdMAX ") reached",
+			inet_ntopSS(&csock), (intmax_t)maxconn);
+		close(fd);
+		return;
+	}
+#endif	/* !WIN32 */
+
 	client = xcalloc(1, sizeof(*client));
 
 	client->sock_fd = fd;
 
+#ifndef WIN32
+	/* replies are queued and flushed as the socket accepts them,
+	 * so a client that stops reading can not block the server */
+	{
+		int	v;
+
+		if ((v = fcntl(fd, F_GETFL, 0)) == -1
+		 || fcntl(fd, F_SETFL, v | O_NDELAY) == -1
+		) {
+			upslog_with_errno(LOG_ERR, "Can't set up connection from %s",
+				inet_ntopSS(&csock));
+			close(fd);
+			free(client);
+			return;
+		}
+	}
+#endif	/* !WIN32 */
+
 	time(&client->last_heard);
 
 	client->addr = xstrdup(inet_ntopSS(&csock));
@@ -840,21 +1127,24 @@ static void client_connect(stype_t *server)
 
 	pconf_init(&client->ctx, NULL);
 
+	/* newest client is the most recently active one */
 	if (firstclient) {
 		firstclient->prev = client;
 		client->next = firstclient;
+	} else {
+		lastclient = client;
 	}
 
 	firstclient = client;
 
-/*
-	if (lastclient) {
-		client->prev = lastclient;
-		lastclient->next = client;
+#ifndef WIN32
+	if (evloop_add(mainloop_evloop, client->sock_fd, EVLOOP_READ, CLIENT, client) < 0) {
+		upslog_with_errno(LOG_ERR, "Can't watch connection from %s", client->addr);
+		client_disconnect(client);
+		return;
 	}
+#endif	/* !WIN32 */
 
-	lastclient = client;
- */
 	upsdebugx(2, "Connect from %s", client->addr);
 }
 
@@ -862,7 +1152,7 @@ static void client_connect(stype_t *server)
 static void client_readline(nut_ctype_t *client)
 {
 	char	buf[SMALLBUF];
-	int	i;
+	size_t	i, used;
 	ssize_t	ret;
 
 #ifdef WITH_SSL
@@ -875,6 +1165,11 @@ static void client_readline(nut_ctype_t *client)
 	}
 
 	if (ret < 0) {
+#ifndef WIN32
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return;
+		}
+#endif	/* !WIN32 */
 		upsdebug_with_errno(2, "Disconnect %s (read failure)", client->addr);
 		client_disconnect(client);
 		return;
@@ -887,14 +1182,22 @@ static void client_readline(nut_ctype_t *client)
 	}
 
 	/* fragment handling code */
-	for (i = 0; i < ret; i++) {
+	for (i = 0; i < (size_t)ret; i += used) {
 
-		/* add to the receive queue one by one */
-		switch (pconf_char(&client->ctx, buf[i]))
+		/* add to the receive queue up to the end of the next line */
+		switch (pconf_feed(&client->ctx, buf + i, (size_t)ret - i, &used))
 		{
 		case 1:
-			time(&client->last_heard);	/* command received */
+			client_touch(client);	/* command received */
 			parse_net(client);
+
+			/* logged out, or a reply could not be sent */
+			if (!client->last_heard) {
+				/* best effort to deliver the goodbye */
+				client_flush(client);
+				client_disconnect(client);
+				return;
+			}
 			continue;
 
 		case 0:
@@ -903,11 +1206,19 @@ static void client_readline(nut_ctype_t *client)
 		default:
 			/* parse error */
 			upslogx(LOG_NOTICE, "Parse error on sock: %s", client->ctx.errmsg);
+
+			/* drop the rest of this batch, but answer what came before it */
+			if (client_flush(client) < 0) {
+				client_disconnect(client);
+			}
 			return;
 		}
 	}
 
-	return;
+	/* send out the replies to everything received in this batch */
+	if (client_flush(client) < 0) {
+		client_disconnect(client);
+	}
 }
 
 void server_load(void)
@@ -924,6 +1235,17 @@ void server_load(void)
 		listenersValidLocalhostIPv4 = 0,
 		listenersValidLocalhostIPv6 = 0;
 
+#ifndef WIN32
+	if (!mainloop_evloop) {
+		mainloop_evloop = evloop_create(EVLOOP_BACKEND_DEFAULT);
+		if (!mainloop_evloop) {
+			fatal_with_errno(EXIT_FAILURE, "Can't set up the event loop");
+		}
+		upsdebugx(1, "%s: using %s event loop",
+			__func__, evloop_backend_name(mainloop_evloop));
+	}
+#endif	/* !WIN32 */
+
 	/* default behaviour if no LISTEN address has been specified */
 	if (!firstaddr) {
 		/* Note: default opt_af==AF_UNSPEC so not constrained to only one protocol */
@@ -942,6 +1264,18 @@ void server_load(void)
 		setuptcp(server);
 	}
 
+#ifndef WIN32
+	/* Register after setuptcp() is done editing the list */
+	for (server = firstaddr; server; server = server->next) {
+		if (VALID_FD_SOCK(server->sock_fd)
+		 && evloop_add(mainloop_evloop, server->sock_fd, EVLOOP_READ, SERVER, server) < 0
+		) {
+			fatal_with_errno(EXIT_FAILURE, "Can't watch listener on %s port %s",
+				server->addr, server->port);
+		}
+	}
+#endif	/* !WIN32 */
+
 	/* Account separately from setuptcp() because it can edit the list,
 	 * e.g. when handling `LISTEN *` lines.
 	 */
@@ -1089,6 +1423,7 @@ static void driver_free(void)
 
 		if (VALID_FD(ups->sock_fd)) {
 #ifndef WIN32
+			ups_unwatch_fd(ups);
 			close(ups->sock_fd);
 #else	/* WIN32 */
 			DisconnectNamedPipe(ups->sock_fd);
@@ -1107,6 +1442,11 @@ static void driver_free(void)
 		free(ups->desc);
 		free(ups);
 	}
+
+	strmap_destroy(ups_index, NULL);
+	ups_index = NULL;
+	strmap_destroy(netcmd_index, NULL);
+	netcmd_index = NULL;
 }
 
 static void upsd_cleanup(void)
@@ -1133,10 +1473,13 @@ static void upsd_cleanup(void)
 	free(certname);
 	free(certpasswd);
 
+#ifndef WIN32
+	evloop_destroy(mainloop_evloop);
+	mainloop_evloop = NULL;
+#else	/* WIN32 */
 	free(fds);
 	free(handler);
 
-#ifdef WIN32
 	if (mutex != INVALID_HANDLE_VALUE) {
 		ReleaseMutex(mutex);
 		CloseHandle(mutex);
@@ -1175,9 +1518,8 @@ static void poll_reload(void)
 			"The server won't start until this problem is resolved.\n", (intmax_t)maxconn, maxalloc);
 	}
 
-	/* The checks above effectively limit that maxconn is in size_t range */
-	fds = xrealloc(fds, (size_t)maxconn * sizeof(*fds));
-	handler = xrealloc(handler, (size_t)maxconn * sizeof(*handler));
+	/* Nothing to allocate here: the event loop grows as descriptors
+	 * are registered, and client_connect() enforces maxconn */
 #else	/* WIN32 */
 	fds = xrealloc(fds, (size_t)MAXIMUM_WAIT_OBJECTS * sizeof(*fds));
 	handler = xrealloc(handler, (size_t)MAXIMUM_WAIT_OBJECTS * sizeof(*handler));
@@ -1411,41 +1753,60 @@ static void set_reload_flag(int sig)
 	reload_flag = 1;
 }
 
-/* service requests and check on new data */
-static void mainloop(void)
-{
 #ifndef WIN32
-	int	ret;
-	nfds_t	i;
-#else	/* WIN32 */
-	DWORD	ret;
-	pipe_conn_t * conn;
-#endif	/* WIN32 */
+void ups_watch_fd(upstype_t *ups)
+{
+	if (!mainloop_evloop || !ups || INVALID_FD(ups->sock_fd)) {
+		return;
+	}
 
-	nfds_t	nfds = 0;
-	upstype_t	*ups;
-	nut_ctype_t		*client, *cnext;
-	stype_t		*server;
-	time_t	now;
+	if (evloop_add(mainloop_evloop, ups->sock_fd, EVLOOP_READ, DRIVER, ups) < 0) {
+		upslog_with_errno(LOG_ERR, "Can't watch socket of UPS [%s]", ups->name);
+	}
+}
 
-	upsnotify(NOTIFY_STATE_WATCHDOG, NULL);
+void ups_unwatch_fd(upstype_t *ups)
+{
+	if (!mainloop_evloop || !ups || INVALID_FD(ups->sock_fd)) {
+		return;
+	}
 
-	time(&now);
+	evloop_del(mainloop_evloop, ups->sock_fd);
 
-	if (reload_flag) {
-		upsnotify(NOTIFY_STATE_RELOADING, NULL);
-		conf_reload();
-		poll_reload();
-		reload_flag = 0;
-		upsnotify(NOTIFY_STATE_READY, NULL);
+	/* try to reconnect on the next pass */
+	next_driver_check = 0;
+}
+
+/* when sstate_dead() would next have something to say about this UPS */
+static time_t driver_deadline(const upstype_t *ups)
+{
+	time_t	ping, dead;
+
+	ping = (ups->last_ping > ups->last_heard) ? ups->last_ping : ups->last_heard;
+	ping += maxage / 3 + 1;
+	dead = ups->last_heard + maxage + 1;
+
+	return (ping < dead) ? ping : dead;
+}
+
+/* throw some warnings if it's not feeding us data any more */
+static void check_driver(upstype_t *ups)
+{
+	if (sstate_dead(ups, maxage)) {
+		ups_data_stale(ups);
+	} else {
+		ups_data_ok(ups);
 	}
+}
 
-	/* cleanup instcmd/setvar status tracking entries if needed */
-	tracking_cleanup();
+/* (re)connect driver sockets and check the connected ones for staleness,
+ * then schedule the next check for whichever UPS needs attention first */
+static void check_drivers(time_t now)
+{
+	upstype_t	*ups;
+	time_t	next = now + MAINLOOP_MAX_SLEEP, t;
 
-#ifndef WIN32
-	/* scan through driver sockets */
-	for (ups = firstups; ups && (nfds < maxconn); ups = ups->next) {
+	for (ups = firstups; ups; ups = ups->next) {
 
 		/* see if we need to (re)connect to the socket */
 		if (INVALID_FD(ups->sock_fd)) {
@@ -1456,74 +1817,131 @@ static void mainloop(void)
 			if (INVALID_FD(ups->sock_fd)) {
 				upsdebugx(1, "%s: UPS [%s] is still not connected (FD %d)",
 					__func__, ups->name, ups->sock_fd);
+				t = now + DRIVER_RECONNECT_DELAY;
 			} else {
 				upsdebugx(1, "%s: UPS [%s] is now connected as FD %d",
 					__func__, ups->name, ups->sock_fd);
+				ups_watch_fd(ups);
+				t = driver_deadline(ups);
+			}
+
+			if (t < next) {
+				next = t;
 			}
 			continue;
 		}
 
-		/* throw some warnings if it's not feeding us data any more */
-		if (sstate_dead(ups, maxage)) {
-			ups_data_stale(ups);
-		} else {
-			ups_data_ok(ups);
+		check_driver(ups);
+
+		/* sstate_dead() may have found the socket broken */
+		t = INVALID_FD(ups->sock_fd) ? now : driver_deadline(ups);
+		if (t <= now) {
+			t = now + 1;
 		}
 
-		fds[nfds].fd = ups->sock_fd;
-		fds[nfds].events = POLLIN;
+		if (t < next) {
+			next = t;
+		}
+	}
 
-		handler[nfds].type = DRIVER;
-		handler[nfds].data = ups;
+	next_driver_check = next;
+}
 
-		nfds++;
+/* milliseconds until the earliest timer is due */
+static int mainloop_timeout(time_t now)
+{
+	time_t	deadline = next_driver_check;
+
+	if (lastclient) {
+		time_t	idle = lastclient->last_heard + CLIENT_INACTIVITY_DELAY + 1;
+
+		if (idle < deadline) {
+			deadline = idle;
+		}
 	}
 
-	/* scan through client sockets */
-	for (client = firstclient; client; client = cnext) {
+	if (deadline <= now) {
+		return 0;
+	}
 
-		cnext = client->next;
+	if (difftime(deadline, now) > MAINLOOP_MAX_SLEEP) {
+		return MAINLOOP_MAX_SLEEP * 1000;
+	}
 
-		if (difftime(now, client->last_heard) > 60) {
-			/* shed clients after 1 minute of inactivity */
-			/* FIXME: create an upsd.conf parameter (CLIENT_INACTIVITY_DELAY) */
-			client_disconnect(client);
-			continue;
-		}
+	return (int)difftime(deadline, now) * 1000;
+}
+#else	/* WIN32 */
+/* WIN32 rebuilds the handle array on every pass of mainloop() */
+void ups_watch_fd(upstype_t *ups)
+{
+	NUT_UNUSED_VARIABLE(ups);
+}
 
-		if (nfds >= maxconn) {
-			/* ignore clients that we are unable to handle */
-			continue;
-		}
+void ups_unwatch_fd(upstype_t *ups)
+{
+	NUT_UNUSED_VARIABLE(ups);
+}
+#endif	/* WIN32 */
 
-		fds[nfds].fd = client->sock_fd;
-		fds[nfds].events = POLLIN;
+/* service requests and check on new data */
+static void mainloop(void)
+{
+#ifndef WIN32
+	int	ret, timeout;
+	evloop_event_t	ev;
+#else	/* WIN32 */
+	DWORD	ret;
+	pipe_conn_t * conn;
+	nfds_t	nfds = 0;
+	nut_ctype_t		*client, *cnext;
+	stype_t		*server;
+#endif	/* WIN32 */
 
-		handler[nfds].type = CLIENT;
-		handler[nfds].data = client;
+	upstype_t	*ups;
+	time_t	now;
 
-		nfds++;
+	upsnotify(NOTIFY_STATE_WATCHDOG, NULL);
+
+	time(&now);
+
+	if (reload_flag) {
+		upsnotify(NOTIFY_STATE_RELOADING, NULL);
+		conf_reload();
+		poll_reload();
+		reload_flag = 0;
+		upsnotify(NOTIFY_STATE_READY, NULL);
 	}
 
-	/* scan through server sockets */
-	for (server = firstaddr; server && (nfds < maxconn); server = server->next) {
+#ifndef WIN32
+	/* timers: drivers (reconnects, pings, staleness) and idle clients */
+	if (now >= next_driver_check) {
+		/* cleanup instcmd/setvar status tracking entries if needed */
+		tracking_cleanup();
 
-		if (server->sock_fd < 0) {
+		check_drivers(now);
+	}
+
+	while (lastclient
+	 && difftime(now, lastclient->last_heard) > CLIENT_INACTIVITY_DELAY
+	) {
+		/* watching clients just listen, keep them around */
+		if (lastclient->watches && lastclient->last_heard) {
+			client_touch(lastclient);
 			continue;
 		}
 
-		fds[nfds].fd = server->sock_fd;
-		fds[nfds].events = POLLIN;
+		client_disconnect(lastclient);
+	}
 
-		handler[nfds].type = SERVER;
-		handler[nfds].data = server;
+	/* changes from the previous batch of driver updates */
+	watch_send();
 
-		nfds++;
-	}
+	timeout = mainloop_timeout(now);
 
-	upsdebugx(2, "%s: polling %" PRIdMAX " filedescriptors", __func__, (intmax_t)nfds);
+	upsdebugx(2, "%s: waiting on %" PRIuSIZE " filedescriptors for up to %d ms",
+		__func__, evloop_count(mainloop_evloop), timeout);
 
-	ret = poll(fds, nfds, 2000);
+	ret = evloop_wait(mainloop_evloop, timeout);
 
 	if (ret == 0) {
 		upsdebugx(2, "%s: no data available", __func__);
@@ -1531,21 +1949,23 @@ static void mainloop(void)
 	}
 
 	if (ret < 0) {
-		upslog_with_errno(LOG_ERR, "%s", __func__);
+		if (errno != EINTR) {
+			upslog_with_errno(LOG_ERR, "%s", __func__);
+		}
 		return;
 	}
 
-	for (i = 0; i < nfds; i++) {
+	while (evloop_next(mainloop_evloop, &ev)) {
 
-		if (fds[i].revents & (POLLHUP|POLLERR|POLLNVAL)) {
+		if (ev.events & EVLOOP_ERROR) {
 
-			switch(handler[i].type)
+			switch((handler_type_t)ev.type)
 			{
 			case DRIVER:
-				sstate_disconnect((upstype_t *)handler[i].data);
+				sstate_disconnect((upstype_t *)ev.data);
 				break;
 			case CLIENT:
-				client_disconnect((nut_ctype_t *)handler[i].data);
+				client_disconnect((nut_ctype_t *)ev.data);
 				break;
 			case SERVER:
 				upsdebugx(2, "%s: server disconnected", __func__);
@@ -1585,18 +2005,32 @@ static void mainloop(void)
 			continue;
 		}
 
-		if (fds[i].revents & POLLIN) {
+		/* queued replies can be sent now */
+		if ((ev.events & EVLOOP_WRITE) && ev.type == CLIENT) {
+			if (client_flush((nut_ctype_t *)ev.data) < 0) {
+				client_disconnect((nut_ctype_t *)ev.data);
+				continue;
+			}
+		}
+
+		if (ev.events & EVLOOP_READ) {
 
-			switch(handler[i].type)
+			switch((handler_type_t)ev.type)
 			{
 			case DRIVER:
-				sstate_readline((upstype_t *)handler[i].data);
+				ups = (upstype_t *)ev.data;
+				sstate_readline(ups);
+
+				/* report DATASTALE/DATAOK right away */
+				if (VALID_FD(ups->sock_fd)) {
+					check_driver(ups);
+				}
 				break;
 			case CLIENT:
-				client_readline((nut_ctype_t *)handler[i].data);
+				client_readline((nut_ctype_t *)ev.data);
 				break;
 			case SERVER:
-				client_connect((stype_t *)handler[i].data);
+				client_connect((stype_t *)ev.data);
 				break;
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
@@ -1633,6 +2067,9 @@ static void mainloop(void)
 		}
 	}
 #else	/* WIN32 */
+	/* cleanup instcmd/setvar status tracking entries if needed */
+	tracking_cleanup();
+
 	/* scan through driver sockets */
 	for (ups = firstups; ups && (nfds < maxconn); ups = ups->next) {
 
@@ -1670,15 +2107,23 @@ static void mainloop(void)
 		}
 	}
 
+	/* changes from the previous pass */
+	watch_send();
+
 	/* scan through client sockets */
 	for (client = firstclient; client; client = cnext) {
 
 		cnext = client->next;
 
-		if (difftime(now, client->last_heard) > 60) {
-			/* shed clients after 1 minute of inactivity */
-			client_disconnect(client);
-			continue;
+		if (difftime(now, client->last_heard) > CLIENT_INACTIVITY_DELAY) {
+			if (client->watches && client->last_heard) {
+				/* watching clients just listen, keep them around */
+				client_touch(client);
+			} else {
+				/* shed clients after 1 minute of inactivity */
+				client_disconnect(client);
+				continue;
+			}
 		}
 
 		if (nfds >= maxconn) {
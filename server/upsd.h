@@ -61,15 +61,29 @@ extern "C" {
 /* prototypes from upsd.c */
 
 upstype_t *get_ups_ptr(const char *upsname);
+
+/* keep the UPS name index used by get_ups_ptr() in sync with firstups */
+void ups_index_add(upstype_t *ups);
+void ups_index_del(upstype_t *ups);
 int ups_available(const upstype_t *ups, nut_ctype_t *client);
 
 void listen_add(const char *addr, const char *port);
 
 void kick_login_clients(const char *upsname);
+
+/* (un)register a driver socket with the main loop; call ups_unwatch_fd()
+ * before closing ups->sock_fd and ups_watch_fd() after (re)connecting */
+void ups_watch_fd(upstype_t *ups);
+void ups_unwatch_fd(upstype_t *ups);
 int sendback(nut_ctype_t *client, const char *fmt, ...)
 	__attribute__ ((__format__ (__printf__, 2, 3)));
 int send_err(nut_ctype_t *client, const char *errtype);
 
+/* write out everything sendback() has queued for the client, switching
+ * its socket to blocking mode (as needed before handing it to the SSL
+ * library, which then keeps it that way); returns 0 on failure */
+int sendback_drain(nut_ctype_t *client);
+
 void server_load(void);
 void server_free(void);
 
@@ -100,6 +114,8 @@ int tracking_is_enabled(void);
 /* declarations from upsd.c */
 extern int		maxage, tracking_delay, allow_no_device, allow_not_all_listeners;
 extern nfds_t		maxconn;
+extern size_t		maxsendqueue;
+extern int		driver_binary_protocol;
 extern char		*statepath, *datapath;
 extern upstype_t	*firstups;
 extern nut_ctype_t	*firstclient;
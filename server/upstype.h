@@ -51,6 +51,13 @@ typedef struct upstype_s {
 	struct st_tree_s	*inforoot;
 	struct cmdlist_s	*cmdlist;
 
+	/* binary framed driver protocol (see dsproto.h), if negotiated */
+	int			binary;
+	char			*binbuf;	/* incomplete record */
+	size_t			binlen, binsize;
+	char			**varnames;	/* indexed by variable id */
+	size_t			numvarnames;
+
 	int	numlogins;
 	int	fsd;		/* forced shutdown in effect? */
 
@@ -1409,6 +1409,159 @@ testcases_sandbox_python() {
     testcase_sandbox_python_with_upsmon_credentials
 }
 
+testcase_sandbox_upsmon_stalled_upsd() {
+    # upsmon polls all MONITORed devices at once, so a data server which
+    # accepts the connection and login but never answers the queries must
+    # not hold up the status of the dummy device served by our upsd.
+    # The fake data server is a small Python script, so we need that.
+    isTestablePython || return 0
+    log_separator
+    log_info "[testcase_sandbox_upsmon_stalled_upsd] Check that a stalled data server does not delay upsmon polling of others"
+
+    PY_INTERP="`echo "${PY_SHEBANG}" | sed 's,^#! *,,'`"
+    STALL_PORT="`expr $NUT_PORT + 1`"
+    cat > "$NUT_STATEPATH/stalled-upsd.py" << EOF
+import socket, sys, threading
+
+def serve(conn):
+    for line in conn.makefile("rb"):
+        words = line.split()
+        if not words or words[0] == b"GET":
+            continue	# stall: never answer a query
+        if words[0] == b"STARTTLS":
+            conn.sendall(b"ERR FEATURE-NOT-CONFIGURED\\n")
+        else:
+            conn.sendall(b"OK\\n")
+
+srv = socket.socket()
+srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+srv.bind(("127.0.0.1", int(sys.argv[1])))
+srv.listen(5)
+while True:
+    threading.Thread(target=serve, args=(srv.accept()[0],), daemon=True).start()
+EOF
+    ${PY_INTERP} "$NUT_STATEPATH/stalled-upsd.py" "$STALL_PORT" &
+    PID_STALLED_UPSD="$!"
+
+    # Keep the sandbox upsmon.conf for other test cases
+    rm -f "$NUT_CONFPATH/upsmon.conf.stalled-bak"
+    if [ -e "$NUT_CONFPATH/upsmon.conf" ]; then
+        cp -pf "$NUT_CONFPATH/upsmon.conf" "$NUT_CONFPATH/upsmon.conf.stalled-bak" \
+        || die "Failed to back up the NIT upsmon.conf"
+    fi
+
+    (   echo 'MINSUPPLIES 0' || exit
+        echo 'SHUTDOWNCMD "echo TESTING_DUMMY_SHUTDOWN_NOW"' || exit
+        echo 'POLLFREQ 2' || exit
+        # Listed first, so that a sequential poll would hit it first
+        echo "MONITOR \"stalled@127.0.0.1:$STALL_PORT\" 0 \"dummy-admin\" \"${TESTPASS_UPSMON_PRIMARY}\" primary" || exit
+        echo "MONITOR \"dummy@localhost:$NUT_PORT\" 0 \"dummy-admin\" \"${TESTPASS_UPSMON_PRIMARY}\" primary" || exit
+    ) > "$NUT_CONFPATH/upsmon.conf" \
+    || die "Failed to populate temporary FS structure for the NIT: upsmon.conf"
+    if [ "`id -u`" = 0 ]; then
+        chmod 644 "$NUT_CONFPATH/upsmon.conf"
+    else
+        chmod 640 "$NUT_CONFPATH/upsmon.conf"
+    fi
+
+    # Queries time out after 3 seconds (-W)
+    sleep 1
+    rm -f "$NUT_STATEPATH/upsmon-stalled.log"
+    NUT_DEBUG_LEVEL=2 upsmon -F -W 3 > "$NUT_STATEPATH/upsmon-stalled.log" 2>&1 &
+    PID_UPSMON_STALLED="$!"
+    sleep 5
+    kill -15 $PID_UPSMON_STALLED $PID_STALLED_UPSD 2>/dev/null
+    wait $PID_UPSMON_STALLED $PID_STALLED_UPSD 2>/dev/null || true
+
+    if [ -e "$NUT_CONFPATH/upsmon.conf.stalled-bak" ]; then
+        mv -f "$NUT_CONFPATH/upsmon.conf.stalled-bak" "$NUT_CONFPATH/upsmon.conf" \
+        || die "Failed to restore the NIT upsmon.conf"
+    else
+        rm -f "$NUT_CONFPATH/upsmon.conf"
+    fi
+
+    # The dummy status must be handled before the stalled one times out
+    LINE_STATUS="`grep -n 'parse_status: \[' "$NUT_STATEPATH/upsmon-stalled.log" | head -1 | cut -d: -f1`"
+    LINE_STALLED="`grep -n 'stalled@.*did not answer in time' "$NUT_STATEPATH/upsmon-stalled.log" | head -1 | cut -d: -f1`"
+    if [ -n "$LINE_STATUS" ] && [ -n "$LINE_STALLED" ] && [ "$LINE_STATUS" -lt "$LINE_STALLED" ] ; then
+        log_info "[testcase_sandbox_upsmon_stalled_upsd] PASSED: dummy status was handled while the stalled server was still pending"
+        PASSED="`expr $PASSED + 1`"
+    else
+        log_error "[testcase_sandbox_upsmon_stalled_upsd] dummy status was not handled before the stalled server timed out, see upsmon log below"
+        cat "$NUT_STATEPATH/upsmon-stalled.log" >&2
+        FAILED="`expr $FAILED + 1`"
+        FAILED_FUNCS="$FAILED_FUNCS testcase_sandbox_upsmon_stalled_upsd"
+    fi
+}
+
+testcase_sandbox_upsd_stalled_client() {
+    # upsd queues replies for each client and sends them as the socket
+    # takes them, so a client which sends requests but stops reading the
+    # answers must neither hold up other clients, nor grow its queue past
+    # MAXSENDQUEUE (4 MiB by default): then it is disconnected.
+    # The misbehaving client is a small Python script, so we need that.
+    isTestablePython || return 0
+    log_separator
+    log_info "[testcase_sandbox_upsd_stalled_client] Check that a client which does not read replies does not stall upsd"
+
+    PY_INTERP="`echo "${PY_SHEBANG}" | sed 's,^#! *,,'`"
+    rm -f "$NUT_STATEPATH/stalled-client.flooded"
+    cat > "$NUT_STATEPATH/stalled-client.py" << EOF
+import socket, sys, time
+
+conn = socket.create_connection(("localhost", int(sys.argv[1])))
+conn.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+
+# learn the size of one reply
+conn.sendall(b"LIST VAR dummy\n")
+reply = b""
+while not reply.endswith(b"END LIST VAR dummy\n"):
+    reply += conn.recv(65536)
+
+# ask for well over MAXSENDQUEUE worth of replies, read none of them
+count = (8 * 1024 * 1024) // len(reply) + 1
+try:
+    conn.sendall(b"LIST VAR dummy\n" * count)
+except socket.error:
+    pass
+open(sys.argv[2], "w").close()
+time.sleep(5)
+
+received = 0
+try:
+    while True:
+        data = conn.recv(65536)
+        if not data:
+            break
+        received += len(data)
+except socket.error:
+    pass
+print("DROPPED" if received < count * len(reply) else "NOT DROPPED", received, count * len(reply))
+EOF
+    ${PY_INTERP} "$NUT_STATEPATH/stalled-client.py" "$NUT_PORT" "$NUT_STATEPATH/stalled-client.flooded" > "$NUT_STATEPATH/stalled-client.log" 2>&1 &
+    PID_STALLED_CLIENT="$!"
+
+    COUNTDOWN=30
+    while [ ! -e "$NUT_STATEPATH/stalled-client.flooded" ] && [ "$COUNTDOWN" -gt 0 ] ; do
+        sleep 1
+        COUNTDOWN="`expr $COUNTDOWN - 1`"
+    done
+
+    # Other clients are still served while that one is not reading
+    runcmd upsc dummy@localhost:$NUT_PORT device.model
+    RES_UPSC="$?"
+    wait $PID_STALLED_CLIENT || true
+
+    if [ "$RES_UPSC" = 0 ] && [ x"$CMDOUT" = x"Dummy UPS" ]     && grep '^DROPPED ' "$NUT_STATEPATH/stalled-client.log" >/dev/null     ; then
+        log_info "[testcase_sandbox_upsd_stalled_client] PASSED: upsd kept serving others and dropped the client which did not read"
+        PASSED="`expr $PASSED + 1`"
+    else
+        log_error "[testcase_sandbox_upsd_stalled_client] upsc got ($RES_UPSC): '$CMDOUT'; stalled client reported: `cat "$NUT_STATEPATH/stalled-client.log"`"
+        FAILED="`expr $FAILED + 1`"
+        FAILED_FUNCS="$FAILED_FUNCS testcase_sandbox_upsd_stalled_client"
+    fi
+}
+
 ####################################
 
 isTestableCppNIT() {
@@ -1679,6 +1832,8 @@ testgroup_sandbox() {
     testcase_sandbox_upsc_query_bogus
     testcase_sandbox_upsc_query_timer
     testcases_sandbox_python
+    testcase_sandbox_upsd_stalled_client
+    testcase_sandbox_upsmon_stalled_upsd
     testcases_sandbox_cppnit
     testcases_sandbox_nutscanner
 
@@ -67,6 +67,29 @@ static int report_0_means_pass(int i) {
 	return i;
 }
 
+#ifndef WIN32
+static int watched_calls = 0;
+
+static int watched_handler(TYPE_FD fd, void *arg) {
+	char	c;
+
+	NUT_UNUSED_VARIABLE(arg);
+
+	if (read(fd, &c, 1) == 1) {
+		watched_calls++;
+	}
+
+	return 0;
+}
+
+static int waking_handler(TYPE_FD fd, void *arg) {
+	NUT_UNUSED_VARIABLE(fd);
+
+	(*(int *)arg)++;
+	return 1;
+}
+#endif	/* !WIN32 */
+
 int main(int argc, char **argv) {
 	const char	*valueStr = NULL;
 
@@ -367,6 +390,82 @@ int main(int argc, char **argv) {
 	report_0_means_pass(strcmp(valueStr, "OB LB FSD"));
 	printf(" test for ups.status with FSD token set and now committed: '%s'; got OB LB FSD?\n", NUT_STRARG(valueStr));
 
+#ifndef WIN32
+	/* Test cases #21+#22+#23 (from scratch)
+	 * We test that a descriptor watched with dstate_watch_fd() (as done
+	 * for asynchronous USB interrupt reads) is handled by dstate_poll_fds()
+	 * as soon as it is readable, rather than at the end of the interval.
+	 */
+	{
+		int	pipefd[2];
+		struct timeval	start, deadline, end;
+		double	latency;
+
+		if (pipe(pipefd) == 0) {
+			dstate_watch_fd(pipefd[0], 0, watched_handler, NULL);
+
+			gettimeofday(&start, NULL);
+			deadline = start;
+			deadline.tv_sec += 2;
+			if (write(pipefd[1], "x", 1) == 1) {
+				while (!watched_calls && !dstate_poll_fds(deadline, ERROR_FD))
+					;
+			}
+			gettimeofday(&end, NULL);
+			latency = difftimeval(end, start);
+
+			/* #21 */
+			report_0_means_pass(!(watched_calls == 1 && latency < 1.0));
+			printf(" test for watched fd handled when readable: %d call(s) after %.6f sec (poll interval 2 sec)\n",
+				watched_calls, latency);
+
+			dstate_unwatch_fd(pipefd[0]);
+
+			gettimeofday(&deadline, NULL);
+			deadline.tv_usec += 200000;
+			if (deadline.tv_usec >= 1000000) {
+				deadline.tv_sec++;
+				deadline.tv_usec -= 1000000;
+			}
+			if (write(pipefd[1], "x", 1) == 1) {
+				while (!dstate_poll_fds(deadline, ERROR_FD))
+					;
+			}
+
+			/* #22 */
+			report_0_means_pass(watched_calls != 1);
+			printf(" test for unwatched fd no longer handled: %d call(s)\n", watched_calls);
+
+			/* #23: the write end is writable right away, and its
+			 * handler asks dstate_poll_fds() to return early */
+			{
+				int	waking_calls = 0, ret;
+
+				dstate_watch_fd(pipefd[1], 1, waking_handler, &waking_calls);
+
+				gettimeofday(&start, NULL);
+				deadline = start;
+				deadline.tv_sec += 2;
+				ret = dstate_poll_fds(deadline, ERROR_FD);
+				gettimeofday(&end, NULL);
+				latency = difftimeval(end, start);
+
+				dstate_unwatch_fd(pipefd[1]);
+
+				report_0_means_pass(!(ret == 1 && waking_calls == 1 && latency < 1.0));
+				printf(" test for writable fd waking up the caller: returned %d, %d call(s) after %.6f sec\n",
+					ret, waking_calls, latency);
+			}
+
+			close(pipefd[0]);
+			close(pipefd[1]);
+		} else {
+			report_fail();
+			printf(" test for watched fd: could not create a pipe\n");
+		}
+	}
+#endif	/* !WIN32 */
+
 	/* Clear testing state before finishing. */
 	alarm_init();
 	alarm_commit();
@@ -0,0 +1,102 @@
+/*  nutdsprototest.c - test the binary driver socket records (common/dsproto.c)
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This runs functional checks of the record encoding and decoding.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "dsproto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int check_records(void)
+{
+	char	buf[64], big[DSPROTO_MAX_PAYLOAD + 1];
+	dsproto_frame_t	frame;
+	size_t	len, len2;
+	int	res = 0;
+
+	printf("=== %s:\t", __func__);
+
+	/* round trip of two records in one buffer */
+	len = dsproto_encode(buf, sizeof(buf), DSPROTO_OP_DEFINE, 513, "ups.load", 8);
+	len2 = dsproto_encode(buf + len, sizeof(buf) - len, DSPROTO_OP_SETINFO, 513, "42", 2);
+	if (len != DSPROTO_HEADER_LEN + 8 || len2 != DSPROTO_HEADER_LEN + 2) {
+		printf(" encode (FAIL)");
+		res++;
+	}
+
+	if (dsproto_decode(buf, len + len2, &frame) != len
+	 || frame.op != DSPROTO_OP_DEFINE || frame.id != 513
+	 || frame.len != 8 || memcmp(frame.payload, "ups.load", 8)
+	) {
+		printf(" decode-1 (FAIL)");
+		res++;
+	}
+
+	if (dsproto_decode(buf + len, len2, &frame) != len2
+	 || frame.op != DSPROTO_OP_SETINFO || frame.id != 513
+	 || frame.len != 2 || memcmp(frame.payload, "42", 2)
+	) {
+		printf(" decode-2 (FAIL)");
+		res++;
+	}
+
+	/* incomplete header or payload */
+	if (dsproto_decode(buf, DSPROTO_HEADER_LEN - 1, &frame) != 0
+	 || dsproto_decode(buf, len - 1, &frame) != 0
+	) {
+		printf(" partial (FAIL)");
+		res++;
+	}
+
+	/* empty payload */
+	len = dsproto_encode(buf, sizeof(buf), DSPROTO_OP_TEXT, 0, NULL, 0);
+	if (len != DSPROTO_HEADER_LEN || dsproto_decode(buf, len, &frame) != len
+	 || frame.op != DSPROTO_OP_TEXT || frame.len != 0
+	) {
+		printf(" empty (FAIL)");
+		res++;
+	}
+
+	/* out of range */
+	memset(big, 'x', sizeof(big));
+	if (dsproto_encode(buf, sizeof(buf), DSPROTO_OP_SETINFO, 1, big, sizeof(buf))
+	 || dsproto_encode(buf, sizeof(buf), DSPROTO_OP_SETINFO, DSPROTO_MAX_ID + 1, "1", 1)
+	 || dsproto_encode(big, sizeof(big), DSPROTO_OP_SETINFO, 1, big, sizeof(big))
+	) {
+		printf(" limits (FAIL)");
+		res++;
+	}
+
+	printf(" %s\n", res ? "FAIL" : "OK");
+
+	return res;
+}
+
+int main(void)
+{
+	int	ret = check_records();
+
+	return (ret != 0);
+}
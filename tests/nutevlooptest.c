@@ -0,0 +1,174 @@
+/*  nutevlooptest.c - test the NUT event loop (common/evloop.c) backends
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This runs functional checks of each available backend.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "evloop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+
+static const evloop_backend_t backends[] = {
+	EVLOOP_BACKEND_POLL,
+#ifdef HAVE_SYS_EPOLL_H
+	EVLOOP_BACKEND_EPOLL,
+#endif
+};
+
+#define NBACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+static int check_backend(evloop_backend_t backend)
+{
+	evloop_t	*loop;
+	evloop_event_t	ev;
+	int	sv1[2], sv2[2], res = 0, n, seen;
+	char	buf[16];
+
+	loop = evloop_create(backend);
+	if (!loop) {
+		printf("=== %s(%d):\tSKIP: backend not available\n", __func__, backend);
+		return 0;
+	}
+
+	printf("=== %s(%s):\t", __func__, evloop_backend_name(loop));
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv1) < 0
+	 || socketpair(AF_UNIX, SOCK_STREAM, 0, sv2) < 0
+	) {
+		printf("FAIL: socketpair\n");
+		evloop_destroy(loop);
+		return 1;
+	}
+
+	if (evloop_add(loop, sv1[0], EVLOOP_READ, 1, &sv1[0]) < 0
+	 || evloop_add(loop, sv2[0], EVLOOP_READ, 2, &sv2[0]) < 0
+	) {
+		printf(" add (FAIL)");
+		res++;
+	}
+
+	/* duplicate registration is refused */
+	if (evloop_add(loop, sv1[0], EVLOOP_READ, 1, NULL) == 0) {
+		printf(" dup-add (FAIL)");
+		res++;
+	}
+
+	/* nothing ready yet */
+	n = evloop_wait(loop, 0);
+	printf(" idle=%d (%s)", n, n == 0 ? "OK" : "FAIL");
+	if (n != 0)
+		res++;
+
+	/* one ready, with our tag and data */
+	if (write(sv2[1], "x", 1) != 1)
+		res++;
+	n = evloop_wait(loop, 1000);
+	seen = 0;
+	while (evloop_next(loop, &ev)) {
+		if (ev.fd == sv2[0] && ev.type == 2 && ev.data == &sv2[0]
+		 && (ev.events & EVLOOP_READ)
+		) {
+			seen++;
+		} else {
+			res++;
+		}
+	}
+	printf(" ready=%d/%d (%s)", n, seen, (n == 1 && seen == 1) ? "OK" : "FAIL");
+	if (n != 1 || seen != 1)
+		res++;
+
+	/* both ready, but the first handler removes the other one:
+	 * its pending event must not be delivered */
+	if (write(sv1[1], "y", 1) != 1)
+		res++;
+	n = evloop_wait(loop, 1000);
+	seen = 0;
+	while (evloop_next(loop, &ev)) {
+		seen++;
+		evloop_del(loop, (ev.fd == sv1[0]) ? sv2[0] : sv1[0]);
+	}
+	printf(" del-pending=%d/%d (%s)", n, seen, (n == 2 && seen == 1) ? "OK" : "FAIL");
+	if (n != 2 || seen != 1)
+		res++;
+
+	if (evloop_count(loop) != 1) {
+		printf(" count=%" PRIuSIZE " (FAIL)", evloop_count(loop));
+		res++;
+	}
+
+	/* write interest */
+	evloop_del(loop, sv1[0]);
+	evloop_del(loop, sv2[0]);
+	evloop_add(loop, sv1[0], EVLOOP_READ | EVLOOP_WRITE, 1, NULL);
+	n = evloop_wait(loop, 1000);
+	seen = (evloop_next(loop, &ev) && (ev.events & EVLOOP_WRITE)) ? 1 : 0;
+	evloop_mod(loop, sv1[0], 0);
+	n += evloop_wait(loop, 0);
+	printf(" write/mod (%s)", (n == 1 && seen) ? "OK" : "FAIL");
+	if (n != 1 || !seen)
+		res++;
+
+	/* hangup of the peer */
+	evloop_mod(loop, sv1[0], EVLOOP_READ);
+	if (read(sv1[0], buf, sizeof(buf)) < 1)
+		res++;
+	close(sv1[1]);
+	n = evloop_wait(loop, 1000);
+	seen = (evloop_next(loop, &ev) && (ev.events & (EVLOOP_READ | EVLOOP_ERROR))) ? 1 : 0;
+	printf(" hangup (%s)\n", (n == 1 && seen) ? "OK" : "FAIL");
+	if (n != 1 || !seen)
+		res++;
+
+	close(sv1[0]);
+	close(sv2[0]);
+	close(sv2[1]);
+	evloop_destroy(loop);
+
+	return res;
+}
+
+int main(void)
+{
+	int	ret = 0;
+	size_t	b;
+
+	for (b = 0; b < NBACKENDS; b++) {
+		ret += check_backend(backends[b]);
+	}
+
+	return (ret != 0);
+}
+
+#else	/* WIN32 */
+
+int main(void)
+{
+	printf("SKIP: evloop is not implemented for WIN32\n");
+	return 0;
+}
+
+#endif	/* WIN32 */
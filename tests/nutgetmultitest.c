@@ -0,0 +1,197 @@
+/*  nutgetmultitest.c - test upscli_get_multi() of clients/upsclient.c
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This runs a scripted data server in a child process, and checks that
+ *  upscli_get_multi() collects the GET VARS answers, fails the call (but
+ *  stays in sync with the server) when an answer is longer than the
+ *  library buffer, and falls back to GET VAR with servers which do not
+ *  know GET VARS.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "upsclient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define LONG_VALUE_LEN	(UPSCLI_NETBUF_LEN * 2)
+
+static void reply(int fd, const char *line)
+{
+	size_t	len = strlen(line);
+
+	while (len > 0) {
+		ssize_t	ret = write(fd, line, len);
+		if (ret < 1) {
+			exit(EXIT_FAILURE);
+		}
+		line += ret;
+		len -= (size_t)ret;
+	}
+}
+
+/* answer the requests of one client, until it disconnects */
+static void fake_upsd(int lfd)
+{
+	char	line[LARGEBUF], longval[LONG_VALUE_LEN + 1];
+	size_t	len = 0;
+	int	fd = accept(lfd, NULL, NULL);
+
+	if (fd < 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	memset(longval, 'x', LONG_VALUE_LEN);
+	longval[LONG_VALUE_LEN] = '\0';
+
+	for (;;) {
+		if (read(fd, line + len, 1) != 1) {
+			exit(EXIT_SUCCESS);
+		}
+
+		if (line[len] != '\n') {
+			if (++len >= sizeof(line) - 1) {
+				exit(EXIT_FAILURE);
+			}
+			continue;
+		}
+		line[len] = '\0';
+		len = 0;
+
+		if (!strcmp(line, "GET VARS ups1 a b c")) {
+			reply(fd, "BEGIN GET VARS ups1\n"
+				"VAR ups1 a \"1\"\n"
+				"VAR ups1 b \"2\"\n"
+				"END GET VARS ups1\n");
+		} else if (!strcmp(line, "GET VARS ups2 long x")) {
+			reply(fd, "BEGIN GET VARS ups2\nVAR ups2 long \"");
+			reply(fd, longval);
+			reply(fd, "\"\nVAR ups2 x \"3\"\nEND GET VARS ups2\n");
+		} else if (!strcmp(line, "GET VAR ups1 a")) {
+			reply(fd, "VAR ups1 a \"1\"\n");
+		} else if (!strncmp(line, "GET VARS old ", 13)) {
+			reply(fd, "ERR INVALID-ARGUMENT\n");
+		} else if (!strcmp(line, "GET VAR old a")) {
+			reply(fd, "VAR old a \"9\"\n");
+		} else {
+			reply(fd, "ERR VAR-NOT-SUPPORTED\n");
+		}
+	}
+}
+
+static int check(const char *what, int ok)
+{
+	printf("=== %s:\t%s\n", what, ok ? "OK" : "FAIL");
+	return !ok;
+}
+
+int main(void)
+{
+	UPSCONN_t	ups;
+	struct sockaddr_in	sa;
+	socklen_t	salen = sizeof(sa);
+	pid_t	pid;
+	int	lfd, ret, res = 0, wstat;
+	size_t	numa;
+	char	*values[3], **answer;
+	const char	*names1[] = { "ups1", "ups1", "ups1" },
+		*vars1[] = { "a", "b", "c" },
+		*names2[] = { "ups2", "ups2" },
+		*vars2[] = { "long", "x" },
+		*names3[] = { "old", "old" },
+		*vars3[] = { "a", "b" },
+		*query[] = { "VAR", "ups1", "a" };
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (lfd < 0
+	 || bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) < 0
+	 || listen(lfd, 1) < 0
+	 || getsockname(lfd, (struct sockaddr *)&sa, &salen) < 0
+	) {
+		printf("SKIP: can not listen on the loopback interface\n");
+		return 0;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		printf("=== fork: FAIL\n");
+		return 1;
+	}
+	if (pid == 0) {
+		fake_upsd(lfd);
+	}
+	close(lfd);
+
+	if (upscli_connect(&ups, "127.0.0.1", ntohs(sa.sin_port), UPSCLI_CONN_INET) < 0) {
+		printf("=== connect: FAIL (%s)\n", upscli_strerror(&ups));
+		kill(pid, SIGTERM);
+		return 1;
+	}
+
+	ret = upscli_get_multi(&ups, 3, names1, vars1, values);
+	res += check("GET VARS answers", ret == 2
+		&& values[0] && !strcmp(values[0], "1")
+		&& values[1] && !strcmp(values[1], "2")
+		&& !values[2]);
+	free(values[0]);
+	free(values[1]);
+
+	ret = upscli_get_multi(&ups, 2, names2, vars2, values);
+	res += check("answer too long for the buffer fails the call", ret == -1
+		&& upscli_upserror(&ups) == UPSCLI_ERR_PROTOCOL
+		&& !values[0] && !values[1]);
+
+	ret = upscli_get(&ups, 3, query, &numa, &answer);
+	res += check("connection still in sync after that", ret == 0
+		&& numa >= 4 && !strcmp(answer[3], "1"));
+
+	ret = upscli_get_multi(&ups, 2, names3, vars3, values);
+	res += check("GET VAR fallback for older servers", ret == 1
+		&& values[0] && !strcmp(values[0], "9")
+		&& !values[1]);
+	free(values[0]);
+
+	upscli_disconnect(&ups);
+	waitpid(pid, &wstat, 0);
+
+	return (res != 0);
+}
+
+#else	/* WIN32 */
+
+int main(void)
+{
+	printf("SKIP: this test forks a data server, not implemented for WIN32\n");
+	return 0;
+}
+
+#endif	/* WIN32 */
@@ -0,0 +1,249 @@
+/*  nuthidparsertest.c - test the item indexes of drivers/hidparser.c
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This parses a large report descriptor, laid out like those of
+ *  ePDUs (a power summary, and an outlet system with many outlets),
+ *  and checks that the FindObject*() methods find the same items with
+ *  the indexes built by Parse_ReportDesc() as by scanning the items.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "hidparser.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DESC_OUTLETS	24
+#define DESC_USAGES	9	/* per outlet and report type */
+#define DESC_SUMMARY	10	/* power summary usages */
+
+static unsigned char	desc[4096];
+static size_t	desclen = 0;
+
+static void put(int n, ...)
+{
+	va_list	ap;
+
+	va_start(ap, n);
+	while (n-- > 0) {
+		desc[desclen++] = (unsigned char)va_arg(ap, int);
+	}
+	va_end(ap);
+}
+
+/* power summary: Input report 1 and Feature report 2; outlet N:
+ * Input report 0x10+N and Feature report 0x40+N */
+static void build_desc(void)
+{
+	int	o, k;
+
+	put(2, 0x05, 0x84);		/* Usage Page (Power Device) */
+	put(2, 0x09, 0x04);		/* Usage (UPS) */
+	put(2, 0xA1, 0x01);		/* Collection (Application) */
+	put(2, 0x75, 0x08);		/* Report Size (8) */
+	put(2, 0x95, 0x01);		/* Report Count (1) */
+	put(2, 0x15, 0x00);		/* Logical Minimum (0) */
+	put(3, 0x26, 0xFF, 0x00);	/* Logical Maximum (255) */
+
+	put(4, 0x09, 0x24, 0xA1, 0x00);	/* PowerSummary */
+	put(2, 0x85, 0x01);
+	for (k = 0; k < DESC_SUMMARY; k++) {
+		put(4, 0x09, 0x30 + k, 0x81, 0x02);	/* Input */
+	}
+	put(2, 0x85, 0x02);
+	for (k = 0; k < DESC_SUMMARY; k++) {
+		put(4, 0x09, 0x30 + k, 0xB1, 0x02);	/* Feature */
+	}
+	put(1, 0xC0);
+
+	put(4, 0x09, 0x1F, 0xA1, 0x00);	/* OutletSystem */
+	for (o = 0; o < DESC_OUTLETS; o++) {
+		put(4, 0x09, 0x20, 0xA1, 0x81 + o);	/* Outlet, indexed */
+		put(2, 0x85, 0x10 + o);
+		for (k = 0; k < DESC_USAGES; k++) {
+			put(4, 0x09, 0x30 + k, 0x81, 0x02);
+		}
+		put(2, 0x85, 0x40 + o);
+		for (k = 0; k < DESC_USAGES; k++) {
+			put(4, 0x09, 0x30 + k, 0xB1, 0x02);
+		}
+		put(1, 0xC0);
+	}
+	put(1, 0xC0);
+
+	put(1, 0xC0);
+}
+
+/* the scans which the indexes replace */
+static HIDData_t *scan_path(HIDDesc_t *pDesc, HIDPath_t *Path, uint8_t Type)
+{
+	size_t	i;
+
+	for (i = 0; i < pDesc->nitems; i++) {
+		HIDData_t	*pData = &pDesc->item[i];
+
+		if (pData->Type == Type
+		 && !memcmp(pData->Path.Node, Path->Node, Path->Size * sizeof(HIDNode_t))
+		) {
+			return pData;
+		}
+	}
+
+	return NULL;
+}
+
+static HIDData_t *scan_id(HIDDesc_t *pDesc, uint8_t ReportID, uint8_t Offset, uint8_t Type)
+{
+	size_t	i;
+
+	for (i = 0; i < pDesc->nitems; i++) {
+		HIDData_t	*pData = &pDesc->item[i];
+
+		if (pData->ReportID == ReportID && pData->Type == Type
+		 && pData->Offset == Offset
+		) {
+			return pData;
+		}
+	}
+
+	return NULL;
+}
+
+static HIDData_t *scan_id_node(HIDDesc_t *pDesc, uint8_t ReportID, HIDNode_t Node)
+{
+	size_t	i;
+
+	for (i = 0; i < pDesc->nitems; i++) {
+		HIDData_t	*pData = &pDesc->item[i];
+
+		if (pData->ReportID == ReportID && pData->Path.Size > 0
+		 && pData->Path.Node[pData->Path.Size - 1] == Node
+		) {
+			return pData;
+		}
+	}
+
+	return NULL;
+}
+
+static int check_indexes(HIDDesc_t *pDesc)
+{
+	size_t	i, j, n, count;
+	HIDData_t	**items;
+	HIDPath_t	path;
+	int	res = 0;
+
+	printf("=== %s:\t", __func__);
+
+	if (pDesc->nitems != 2 * (DESC_SUMMARY + DESC_OUTLETS * DESC_USAGES)) {
+		printf(" nitems=%" PRIuSIZE " (FAIL)", pDesc->nitems);
+		res++;
+	}
+
+	for (i = 0; i < pDesc->nitems; i++) {
+		HIDData_t	*pData = &pDesc->item[i];
+
+		/* each item by its Path, and its collection by prefix */
+		path = pData->Path;
+		if (FindObject_with_Path(pDesc, &path, pData->Type) != pData) {
+			printf(" path %" PRIuSIZE " (FAIL)", i);
+			res++;
+		}
+
+		path.Size--;
+		if (FindObject_with_Path(pDesc, &path, pData->Type)
+			!= scan_path(pDesc, &path, pData->Type)
+		) {
+			printf(" prefix %" PRIuSIZE " (FAIL)", i);
+			res++;
+		}
+
+		if (FindObject_with_ID(pDesc, pData->ReportID, pData->Offset, pData->Type)
+			!= scan_id(pDesc, pData->ReportID, pData->Offset, pData->Type)
+		) {
+			printf(" id %" PRIuSIZE " (FAIL)", i);
+			res++;
+		}
+
+		if (FindObject_with_ID_Node(pDesc, pData->ReportID, pData->Path.Node[pData->Path.Size - 1])
+			!= scan_id_node(pDesc, pData->ReportID, pData->Path.Node[pData->Path.Size - 1])
+		) {
+			printf(" node %" PRIuSIZE " (FAIL)", i);
+			res++;
+		}
+	}
+
+	/* misses */
+	path = pDesc->item[0].Path;
+	path.Node[path.Size - 1] = 0x008400FF;
+	if (FindObject_with_Path(pDesc, &path, ITEM_INPUT) != NULL
+	 || FindObject_with_ID(pDesc, 0x01, 0xF0, ITEM_INPUT) != NULL
+	 || FindObject_with_ID(pDesc, 0x03, 0x00, ITEM_INPUT) != NULL
+	 || FindObject_with_ID_Node(pDesc, 0x01, 0x008400FF) != NULL
+	) {
+		printf(" miss (FAIL)");
+		res++;
+	}
+
+	/* items of each report, in descriptor order */
+	for (i = 0; i < 256; i++) {
+		items = FindObjects_with_ID(pDesc, (uint8_t)i, &count);
+		for (j = 0, n = 0; j < pDesc->nitems; j++) {
+			if (pDesc->item[j].ReportID != i) {
+				continue;
+			}
+			if (n >= count || items[n] != &pDesc->item[j]) {
+				break;
+			}
+			n++;
+		}
+		if (j < pDesc->nitems || n != count) {
+			printf(" report %" PRIuSIZE " (FAIL)", i);
+			res++;
+		}
+	}
+
+	printf(" %s\n", res ? "FAIL" : "OK");
+
+	return res;
+}
+
+int main(void)
+{
+	HIDDesc_t	*pDesc;
+	int	ret;
+
+	build_desc();
+	pDesc = Parse_ReportDesc((usb_ctrl_charbuf)desc, (usb_ctrl_charbufsize)desclen);
+	if (!pDesc) {
+		printf("=== could not parse the report descriptor: FAIL\n");
+		return 1;
+	}
+
+	ret = check_indexes(pDesc);
+
+	Free_ReportDesc(pDesc);
+
+	return (ret != 0);
+}
@@ -0,0 +1,151 @@
+/*  nutparseconftest.c - test the bulk parseconf tokenizer (pconf_feed)
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This checks that pconf_feed() splits the same words as pconf_char()
+ *  does, for tricky input cut into chunks of all sizes.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "parseconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the lines as seen by the caller: words separated by '|', lines by '\n',
+ * "!" for parse errors */
+static char *collect_char(const char *input, size_t len)
+{
+	PCONF_CTX_t	ctx;
+	char	*out = xcalloc(1, 4 * len + 16);
+	size_t	i, j;
+
+	pconf_init(&ctx, NULL);
+	ctx.wordlen_limit = 8;
+	ctx.arg_limit = 4;
+
+	for (i = 0; i < len; i++) {
+		switch (pconf_char(&ctx, input[i])) {
+		case 1:
+			for (j = 0; j < ctx.numargs; j++) {
+				strcat(out, ctx.arglist[j]);
+				strcat(out, "|");
+			}
+			strcat(out, "\n");
+			break;
+		case 0:
+			break;
+		default:
+			strcat(out, "!\n");
+			break;
+		}
+	}
+
+	pconf_finish(&ctx);
+	return out;
+}
+
+static char *collect_feed(const char *input, size_t len, size_t chunk)
+{
+	PCONF_CTX_t	ctx;
+	char	*out = xcalloc(1, 4 * len + 16);
+	size_t	pos = 0, j;
+
+	pconf_init(&ctx, NULL);
+	ctx.wordlen_limit = 8;
+	ctx.arg_limit = 4;
+
+	while (pos < len) {
+		size_t	n = (len - pos < chunk) ? len - pos : chunk, i, used;
+
+		for (i = 0; i < n; i += used) {
+			switch (pconf_feed(&ctx, input + pos + i, n - i, &used)) {
+			case 1:
+				for (j = 0; j < ctx.numargs; j++) {
+					strcat(out, ctx.arglist[j]);
+					strcat(out, "|");
+				}
+				strcat(out, "\n");
+				break;
+			case 0:
+				break;
+			default:
+				strcat(out, "!\n");
+				break;
+			}
+		}
+		pos += n;
+	}
+
+	pconf_finish(&ctx);
+	return out;
+}
+
+static int check_feed(void)
+{
+	static const char	input[] =
+		"SETINFO ups.status \"OL CHRG\"\n"
+		"  \tSETINFO   battery.charge 100  \r\n"
+		"SETINFO device.model \"Back-UPS \\\"XS\\\" 700\"\n"
+		"# a comment \"with quotes\n"
+		"word# comment right after\n"
+		"key=value key = value =\n"
+		"escaped\\ space back\\\\slash\\\ncontinued\n"
+		"\"quoted\\\nnewline\" \"= sign\" \"tab\there\"\n"
+		"too many words on this line\n"
+		"averyveryverylongword \"and a long quoted one\"\n"
+		"\"unbalanced # in quotes\" after error\n"
+		"ctrl\001char high\300char\n"
+		"\"\" empty\n"
+		"last line without newline";
+	char	*ref, *got;
+	size_t	chunk, len = sizeof(input) - 1;
+	int	res = 0;
+
+	printf("=== %s:\t", __func__);
+
+	ref = collect_char(input, len);
+
+	for (chunk = 1; chunk <= len; chunk++) {
+		got = collect_feed(input, len, chunk);
+		if (strcmp(ref, got)) {
+			printf(" chunk=%" PRIuSIZE " (FAIL)\n--- expected:\n%s--- got:\n%s",
+				chunk, ref, got);
+			res++;
+		}
+		free(got);
+
+		if (res)
+			break;
+	}
+
+	printf(" %s\n", res ? "FAIL" : "OK");
+
+	free(ref);
+	return res;
+}
+
+int main(void)
+{
+	int	ret = check_feed();
+
+	return (ret != 0);
+}
@@ -0,0 +1,162 @@
+/*  nutserialtest.c - test the buffered ser_rbuf_*() readers of drivers/serial.c
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This feeds a pipe standing in for a serial port, in one write or in
+ *  pieces, and checks that the ser_rbuf_*() methods keep what they read
+ *  ahead for the next call: lines which arrived together, a line split
+ *  by a timeout, peeked bytes, and what follows an expected string.
+ */
+
+#include "config.h"
+#include "main.h"
+#include "serial.h"
+#include "nut_stdint.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* driver description structure */
+upsdrv_info_t upsdrv_info = {
+	"Mock driver for serial unit tests",
+	"0.01",
+	"Network UPS Tools team",
+	DRV_EXPERIMENTAL,
+	{ NULL }
+};
+
+void upsdrv_cleanup(void) {}
+void upsdrv_shutdown(void) {}
+
+#ifndef WIN32
+
+/* short enough for the test, long enough for the pipe */
+#define WAIT_USEC	100000
+
+static int	pipefd[2];
+static int	alerts = 0;
+
+static void feed(const char *str)
+{
+	if (write(pipefd[1], str, strlen(str)) != (ssize_t)strlen(str)) {
+		printf("=== write to the pipe: FAIL\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void alert_handler(char ch)
+{
+	if (ch == '!') {
+		alerts++;
+	}
+}
+
+static int check(const char *what, int ok)
+{
+	printf("=== %s:\t%s\n", what, ok ? "OK" : "FAIL");
+	return !ok;
+}
+
+int main(void)
+{
+	char	buf[SMALLBUF], ch;
+	ssize_t	ret, ret2;
+	int	res = 0;
+
+	if (pipe(pipefd) < 0) {
+		printf("=== pipe: FAIL\n");
+		return 1;
+	}
+
+	/* two lines in one read(): the second one is kept */
+	feed("AB\r\nCD\r\n");
+	ret = ser_rbuf_get_line(pipefd[0], buf, sizeof(buf), '\n', "\r", 0, WAIT_USEC);
+	res += check("first of two lines", ret == 2 && !strcmp(buf, "AB"));
+	ret = ser_rbuf_get_line(pipefd[0], buf, sizeof(buf), '\n', "\r", 0, WAIT_USEC);
+	res += check("second line, read ahead", ret == 2 && !strcmp(buf, "CD"));
+
+	/* a line which the timeout cut is completed by the next call */
+	feed("EF");
+	ret = ser_rbuf_get_line(pipefd[0], buf, sizeof(buf), '\n', "\r", 0, WAIT_USEC);
+	res += check("line cut by a timeout", ret == 0 && buf[0] == '\0');
+	feed("GH\r\n");
+	ret = ser_rbuf_get_line(pipefd[0], buf, sizeof(buf), '\n', "\r", 0, WAIT_USEC);
+	res += check("...kept for the next call", ret == 4 && !strcmp(buf, "EFGH"));
+
+	/* alert characters are handled once, even around a timeout */
+	feed("!I");
+	ret = ser_rbuf_get_line_alert(pipefd[0], buf, sizeof(buf), '\n', "\r", "!",
+		alert_handler, 0, WAIT_USEC);
+	feed("J!\n");
+	ret2 = ser_rbuf_get_line_alert(pipefd[0], buf, sizeof(buf), '\n', "\r", "!",
+		alert_handler, 0, WAIT_USEC);
+	res += check("alerts in a split line", ret == 0 && ret2 == 2
+		&& !strcmp(buf, "IJ") && alerts == 2);
+
+	/* fixed length reads and peeks share the buffer */
+	feed("0123456789");
+	ret = ser_rbuf_get_buf_len(pipefd[0], buf, 4, 0, WAIT_USEC);
+	res += check("fixed length read", ret == 4 && !memcmp(buf, "0123", 4));
+	ret = ser_rbuf_peek(pipefd[0], buf, 3, 0, WAIT_USEC);
+	res += check("peek", ret == 3 && !memcmp(buf, "456", 3));
+	ret = ser_rbuf_get_char(pipefd[0], &ch, 0, WAIT_USEC);
+	res += check("peeked bytes are still there", ret == 1 && ch == '4');
+	ret = ser_rbuf_get_buf_len(pipefd[0], buf, 8, 0, WAIT_USEC);
+	res += check("short read times out", ret == 0);
+	ret = ser_rbuf_get_buf_len(pipefd[0], buf, 5, 0, WAIT_USEC);
+	res += check("...and keeps what it got", ret == 5 && !memcmp(buf, "56789", 5));
+
+	/* expect: what follows the string stays buffered */
+	feed("xxOKyy");
+	ret = ser_rbuf_expect(pipefd[0], "OK", 2, 0, WAIT_USEC);
+	ret2 = ser_rbuf_get_buf_len(pipefd[0], buf, 2, 0, WAIT_USEC);
+	res += check("expect", ret == 1 && ret2 == 2 && !memcmp(buf, "yy", 2));
+
+	/* ...also when the string arrives in two pieces */
+	feed("zzO");
+	ret = ser_rbuf_expect(pipefd[0], "OK", 2, 0, WAIT_USEC);
+	feed("Kww");
+	ret2 = ser_rbuf_expect(pipefd[0], "OK", 2, 0, WAIT_USEC);
+	res += check("expect across reads", ret == 0 && ret2 == 1);
+	ret = ser_rbuf_get_buf_len(pipefd[0], buf, 2, 0, WAIT_USEC);
+	res += check("...and what follows it", ret == 2 && !memcmp(buf, "ww", 2));
+
+	/* ser_flush_in() takes the buffered bytes too */
+	feed("abc");
+	ret = ser_rbuf_get_char(pipefd[0], &ch, 0, WAIT_USEC);
+	ret2 = ser_flush_in(pipefd[0], "", 0);
+	res += check("flush buffered input", ret == 1 && ch == 'a' && ret2 == 2);
+	ret = ser_rbuf_get_char(pipefd[0], &ch, 0, WAIT_USEC);
+	res += check("nothing left", ret == 0);
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	return (res != 0);
+}
+
+#else	/* WIN32 */
+
+int main(void)
+{
+	printf("SKIP: serial ports are HANDLEs on WIN32, not pipe descriptors\n");
+	return 0;
+}
+
+#endif	/* WIN32 */
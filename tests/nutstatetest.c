@@ -0,0 +1,248 @@
+/*  nutstatetest.c - test the st_tree_t state tree (common/state.c)
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This checks that the tree stays ordered and balanced while variables
+ *  are added, updated and removed in sorted order (as in a DUMPALL
+ *  replay), for 50 and 5000 variables (the latter being a PDU with
+ *  hundreds of outlets), and checks the state memory accounting.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "state.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* names like a PDU would report, in the order a DUMPALL sends them */
+static char **make_names(size_t count)
+{
+	static const char	*fields[] = {
+		"current", "delay.shutdown", "desc", "power", "realpower",
+		"status", "switchable", "voltage", "id", "name"
+	};
+	char	**names = xcalloc(count, sizeof(*names));
+	size_t	i;
+
+	for (i = 0; i < count; i++) {
+		char	buf[SMALLBUF];
+
+		snprintf(buf, sizeof(buf), "outlet.%" PRIuSIZE ".%s",
+			i / 10 + 1, fields[i % 10]);
+		names[i] = xstrdup(buf);
+	}
+
+	return names;
+}
+
+static int cmp_names(const void *a, const void *b)
+{
+	return strcasecmp(*(char * const *)a, *(char * const *)b);
+}
+
+static void free_names(char **names, size_t count)
+{
+	size_t	i;
+
+	for (i = 0; i < count; i++) {
+		free(names[i]);
+	}
+	free(names);
+}
+
+/* returns the height, or -1 if the subtree is not a valid AVL tree */
+static int check_subtree(const st_tree_t *node, const char **prev, size_t *count)
+{
+	int	lh, rh;
+
+	if (!node) {
+		return 0;
+	}
+
+	if ((lh = check_subtree(node->left, prev, count)) < 0) {
+		return -1;
+	}
+
+	if (*prev && strcasecmp(*prev, node->var) >= 0) {
+		return -1;	/* out of order */
+	}
+	*prev = node->var;
+	(*count)++;
+
+	if ((rh = check_subtree(node->right, prev, count)) < 0) {
+		return -1;
+	}
+
+	if (lh - rh > 1 || rh - lh > 1 || node->height != 1 + (lh > rh ? lh : rh)) {
+		return -1;	/* unbalanced */
+	}
+
+	return node->height;
+}
+
+static int check_tree(const char *what, const st_tree_t *root, size_t expected)
+{
+	const char	*prev = NULL;
+	size_t	count = 0;
+	int	height = check_subtree(root, &prev, &count);
+
+	printf("=== %s:\tcount=%" PRIuSIZE " height=%d", what, count, height);
+	if (height < 0 || count != expected) {
+		printf(" (FAIL)\n");
+		return 1;
+	}
+
+	printf(" (OK)\n");
+	return 0;
+}
+
+static int check_state_tree(size_t count)
+{
+	st_tree_t	*root = NULL;
+	char	**names = make_names(count);
+	size_t	i;
+	int	res = 0;
+	const char	*val;
+
+	qsort(names, count, sizeof(*names), cmp_names);
+
+	for (i = 0; i < count; i++) {
+		if (state_setinfo(&root, names[i], "0") != 1) {
+			res++;
+		}
+	}
+	res += check_tree("sorted insert", root, count);
+
+	/* updates: changed, unchanged, escaped */
+	if (state_setinfo(&root, names[0], "1") != 1
+	 || state_setinfo(&root, names[0], "1") != 0
+	 || state_setinfo(&root, names[1], "a \"quoted\" value") != 1
+	) {
+		printf("=== update (FAIL)\n");
+		res++;
+	}
+
+	val = state_getinfo(root, names[1]);
+	if (!val || strcmp(val, "a \\\"quoted\\\" value")) {
+		printf("=== escaped value [%s] (FAIL)\n", NUT_STRARG(val));
+		res++;
+	}
+
+	/* case-insensitive lookups */
+	val = state_getinfo(root, "OUTLET.1.ID");
+	if (!val || strcmp(val, "0")) {
+		printf("=== case-insensitive lookup (FAIL)\n");
+		res++;
+	}
+
+	/* immutable variables survive deletion */
+	state_tree_find(root, names[2])->flags |= ST_FLAG_IMMUTABLE;
+	if (state_delinfo(&root, names[2]) != 0) {
+		printf("=== immutable delete (FAIL)\n");
+		res++;
+	}
+
+	/* remove every other one, including the immutable one */
+	state_tree_find(root, names[2])->flags &= ~ST_FLAG_IMMUTABLE;
+	for (i = 0; i < count; i += 2) {
+		if (state_delinfo(&root, names[i]) != 1) {
+			res++;
+		}
+	}
+	if (state_delinfo(&root, names[0]) != 0) {
+		printf("=== double delete (FAIL)\n");
+		res++;
+	}
+	res += check_tree("delete half", root, count / 2);
+
+	for (i = 1; i < count; i += 2) {
+		if (!state_getinfo(root, names[i])) {
+			res++;
+		}
+	}
+
+	state_infofree(root);
+	free_names(names, count);
+
+	return res;
+}
+
+static int check_memstats(void)
+{
+	st_tree_t	*ups1 = NULL, *ups2 = NULL;
+	st_tree_memstats_t	ms;
+	char	longval[ST_INLINE_VALUE_LEN * 2];
+	int	res = 0;
+
+	printf("=== %s:\t", __func__);
+
+	memset(longval, 'x', sizeof(longval) - 1);
+	longval[sizeof(longval) - 1] = '\0';
+
+	/* same names in two trees (UPSes) are stored once */
+	state_setinfo(&ups1, "ups.status", "OL");
+	state_setinfo(&ups1, "ups.model", longval);
+	state_setinfo(&ups2, "ups.status", "OB");
+	state_setinfo(&ups2, "ups.mfr", "a \"quoted\" value");
+
+	if (state_tree_find(ups1, "ups.status")->var != state_tree_find(ups2, "ups.status")->var) {
+		printf(" interned (FAIL)");
+		res++;
+	}
+
+	state_get_memstats(&ms);
+	printf(" nodes=%" PRIuSIZE " names=%" PRIuSIZE " heap_values=%" PRIuSIZE " bytes=%" PRIuSIZE,
+		ms.nodes, ms.names, ms.heap_values, ms.bytes);
+	if (ms.nodes != 4 || ms.names != 3 || ms.heap_values != 2 || !ms.bytes) {
+		printf(" (FAIL)");
+		res++;
+	}
+
+	/* short values go back to the (kept) heap buffer */
+	state_setinfo(&ups1, "ups.model", "short");
+	if (strcmp(state_getinfo(ups1, "ups.model"), "short")) {
+		printf(" shrink (FAIL)");
+		res++;
+	}
+
+	state_infofree(ups1);
+	state_infofree(ups2);
+
+	state_get_memstats(&ms);
+	if (ms.nodes || ms.names || ms.heap_values || ms.bytes) {
+		printf(" leftover (FAIL)\n");
+		return res + 1;
+	}
+
+	printf(" (%s)\n", res ? "FAIL" : "OK");
+	return res;
+}
+
+int main(void)
+{
+	int	ret = 0;
+
+	ret += check_state_tree(50);
+	ret += check_state_tree(5000);
+	ret += check_memstats();
+
+	return (ret != 0);
+}
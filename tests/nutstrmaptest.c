@@ -0,0 +1,133 @@
+/*  nutstrmaptest.c - test the string keyed hash index (common/strmap.c)
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This checks adding, replacing, finding and removing keys, with and
+ *  without case sensitivity, and that everything is still found after
+ *  the table grew.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "strmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int check_map(void)
+{
+	strmap_t	*map;
+	char	key[SMALLBUF];
+	static int	a, b, c;
+	size_t	i;
+	int	res = 0;
+
+	printf("=== %s:\t", __func__);
+
+	/* case-insensitive map: put, get, replace, delete */
+	map = strmap_create(STRMAP_NOCASE);
+
+	if (strmap_put(map, "ups1", &a) != NULL
+	 || strmap_put(map, "UPS2", &b) != NULL
+	 || strmap_count(map) != 2
+	) {
+		printf(" put (FAIL)");
+		res++;
+	}
+
+	if (strmap_get(map, "UPS1") != &a || strmap_get(map, "ups2") != &b
+	 || strmap_get(map, "ups3") != NULL || strmap_get(map, "ups") != NULL
+	) {
+		printf(" get (FAIL)");
+		res++;
+	}
+
+	if (strmap_put(map, "Ups1", &c) != &a || strmap_get(map, "ups1") != &c
+	 || strmap_count(map) != 2
+	) {
+		printf(" replace (FAIL)");
+		res++;
+	}
+
+	if (strmap_del(map, "UPS1") != &c || strmap_get(map, "ups1") != NULL
+	 || strmap_del(map, "ups1") != NULL || strmap_count(map) != 1
+	) {
+		printf(" del (FAIL)");
+		res++;
+	}
+
+	strmap_destroy(map, NULL);
+
+	/* case-sensitive map */
+	map = strmap_create(0);
+	strmap_put(map, "battery.charge", &a);
+	if (strmap_get(map, "battery.charge") != &a
+	 || strmap_get(map, "BATTERY.CHARGE") != NULL
+	) {
+		printf(" case (FAIL)");
+		res++;
+	}
+	strmap_destroy(map, NULL);
+
+	/* growth: everything is still found after the table was resized */
+	map = strmap_create(STRMAP_NOCASE);
+	for (i = 0; i < 5000; i++) {
+		snprintf(key, sizeof(key), "ups%" PRIuSIZE, i);
+		strmap_put(map, key, xstrdup(key));
+	}
+	for (i = 0; i < 5000; i += 2) {
+		snprintf(key, sizeof(key), "UPS%" PRIuSIZE, i);
+		free(strmap_del(map, key));
+	}
+	for (i = 0; i < 5000; i++) {
+		const char	*val;
+
+		snprintf(key, sizeof(key), "Ups%" PRIuSIZE, i);
+		val = strmap_get(map, key);
+		if ((i % 2) ? (!val || strcasecmp(val, key)) : (val != NULL)) {
+			printf(" growth at %" PRIuSIZE " (FAIL)", i);
+			res++;
+			break;
+		}
+	}
+	if (strmap_count(map) != 2500) {
+		printf(" count (FAIL)");
+		res++;
+	}
+	strmap_destroy(map, free);
+
+	/* NULL maps behave as empty ones */
+	if (strmap_get(NULL, "x") != NULL || strmap_del(NULL, "x") != NULL
+	 || strmap_count(NULL) != 0
+	) {
+		printf(" null (FAIL)");
+		res++;
+	}
+	strmap_destroy(NULL, NULL);
+
+	printf(" %s\n", res ? "FAIL" : "OK");
+
+	return res;
+}
+
+int main(void)
+{
+	return (check_map() != 0);
+}
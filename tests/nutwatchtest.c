@@ -0,0 +1,204 @@
+/*  nutwatchtest.c - test upscli_watch() of clients/upsclient.c
+ *
+ *  Copyright (C)
+ *      2026            Network UPS Tools team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *  This runs a scripted data server in a child process, which sends
+ *  notifications of an earlier subscription before the replies to WATCH
+ *  and UNWATCH, and checks that upscli_watch_next() returns them in
+ *  order before the ones which follow the reply.
+ */
+
+#include "config.h"
+#include "common.h"
+#include "nut_stdint.h"
+#include "upsclient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static void reply(int fd, const char *line)
+{
+	size_t	len = strlen(line);
+
+	while (len > 0) {
+		ssize_t	ret = write(fd, line, len);
+		if (ret < 1) {
+			exit(EXIT_FAILURE);
+		}
+		line += ret;
+		len -= (size_t)ret;
+	}
+}
+
+/* answer the requests of one client, until it disconnects */
+static void fake_upsd(int lfd)
+{
+	char	line[LARGEBUF];
+	size_t	len = 0;
+	int	fd = accept(lfd, NULL, NULL);
+
+	if (fd < 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	for (;;) {
+		if (read(fd, line + len, 1) != 1) {
+			exit(EXIT_SUCCESS);
+		}
+
+		if (line[len] != '\n') {
+			if (++len >= sizeof(line) - 1) {
+				exit(EXIT_FAILURE);
+			}
+			continue;
+		}
+		line[len] = '\0';
+		len = 0;
+
+		if (!strcmp(line, "WATCH ups1 a")) {
+			reply(fd, "OK\n"
+				"NOTIFY STATUS ups1 OK\n"
+				"NOTIFY VAR ups1 a \"1\"\n");
+		} else if (!strcmp(line, "WATCH ups2")) {
+			/* ups1 changed meanwhile */
+			reply(fd, "NOTIFY VAR ups1 a \"2\"\n"
+				"NOTIFY DELVAR ups1 a\n"
+				"OK\n"
+				"NOTIFY STATUS ups2 OK\n");
+		} else if (!strcmp(line, "UNWATCH ups2")) {
+			reply(fd, "NOTIFY STATUS ups1 DATA-STALE\n"
+				"OK\n");
+		} else {
+			reply(fd, "ERR UNKNOWN-COMMAND\n");
+		}
+	}
+}
+
+static int check(const char *what, int ok)
+{
+	printf("=== %s:\t%s\n", what, ok ? "OK" : "FAIL");
+	return !ok;
+}
+
+/* read the next notification, expecting it to be what[0..num-1] */
+static int next_is(UPSCONN_t *ups, size_t num, const char **what)
+{
+	size_t	numa, i;
+	char	**answer;
+
+	if (upscli_watch_next(ups, 5, &numa, &answer) != 1 || numa != num) {
+		return 0;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (strcmp(answer[i], what[i]) != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int main(void)
+{
+	UPSCONN_t	ups;
+	struct sockaddr_in	sa;
+	socklen_t	salen = sizeof(sa);
+	pid_t	pid;
+	int	lfd, ret, res = 0, wstat;
+	size_t	numa;
+	char	**answer;
+	const char	*pat1[] = { "a" },
+		*status1[] = { "STATUS", "ups1", "OK" },
+		*var1[] = { "VAR", "ups1", "a", "1" },
+		*var2[] = { "VAR", "ups1", "a", "2" },
+		*delvar[] = { "DELVAR", "ups1", "a" },
+		*status2[] = { "STATUS", "ups2", "OK" },
+		*stale[] = { "STATUS", "ups1", "DATA-STALE" };
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (lfd < 0
+	 || bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) < 0
+	 || listen(lfd, 1) < 0
+	 || getsockname(lfd, (struct sockaddr *)&sa, &salen) < 0
+	) {
+		printf("SKIP: can not listen on the loopback interface\n");
+		return 0;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		printf("=== fork: FAIL\n");
+		return 1;
+	}
+	if (pid == 0) {
+		fake_upsd(lfd);
+	}
+	close(lfd);
+
+	if (upscli_connect(&ups, "127.0.0.1", ntohs(sa.sin_port), UPSCLI_CONN_INET) < 0) {
+		printf("=== connect: FAIL (%s)\n", upscli_strerror(&ups));
+		kill(pid, SIGTERM);
+		return 1;
+	}
+
+	res += check("WATCH", upscli_watch(&ups, "ups1", 1, pat1) == 0);
+	res += check("notifications after the reply",
+		next_is(&ups, 3, status1) && next_is(&ups, 4, var1));
+
+	res += check("WATCH with notifications before its reply",
+		upscli_watch(&ups, "ups2", 0, NULL) == 0);
+	res += check("notifications before the reply are kept, in order",
+		next_is(&ups, 4, var2) && next_is(&ups, 3, delvar));
+	res += check("then those read from the connection",
+		next_is(&ups, 3, status2));
+
+	res += check("UNWATCH with a notification before its reply",
+		upscli_unwatch(&ups, "ups2") == 0);
+	res += check("notification before the UNWATCH reply is kept",
+		next_is(&ups, 3, stale));
+
+	ret = upscli_watch_next(&ups, 0, &numa, &answer);
+	res += check("nothing more", ret == 0);
+
+	upscli_disconnect(&ups);
+	waitpid(pid, &wstat, 0);
+
+	return (res != 0);
+}
+
+#else	/* WIN32 */
+
+int main(void)
+{
+	printf("SKIP: this test forks a data server, not implemented for WIN32\n");
+	return 0;
+}
+
+#endif	/* WIN32 */